@@ -0,0 +1,30 @@
+#ifndef OZZ_GAME_ADDITIVE_H_
+#define OZZ_GAME_ADDITIVE_H_
+
+#include "ozz/base/platform.h"
+
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/skeleton.h"
+
+namespace game
+{
+
+// Reference pose additive animations are the difference to.
+enum AdditiveReference {
+    // Animation first frame.
+    kFirstFrameReference,
+    // Skeleton rest pose.
+    kRestPoseReference,
+};
+
+// Builds _additive, the difference of _animation to a reference pose, for
+// BlendingJob additive layers. This is done once at load time, so that only
+// the additive blend is left to runtime, instead of sampling both animations
+// and differencing them every frame. Tracks are resampled at _sample_rate (in
+// hertz, 0 to match _animation, see ResampleAnimation) and optimized again.
+bool BuildAdditiveAnimation(const ozz::animation::Animation& _animation,
+                            const ozz::animation::Skeleton& _skeleton,
+                            AdditiveReference _reference, float _sample_rate,
+                            ozz::animation::Animation* _additive);
+}  // namespace game
+#endif  // OZZ_GAME_ADDITIVE_H_
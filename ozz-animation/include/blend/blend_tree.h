@@ -0,0 +1,377 @@
+#ifndef OZZ_GAME_BLEND_TREE_H_
+#define OZZ_GAME_BLEND_TREE_H_
+
+#include <string>
+
+#include "ozz/base/containers/vector.h"
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/maths/vec_float.h"
+#include "ozz/base/memory/unique_ptr.h"
+#include "ozz/base/platform.h"
+#include "ozz/base/span.h"
+
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/blending_job.h"
+#include "ozz/animation/runtime/sampling_job.h"
+#include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/track.h"
+
+#include "blend/inertializer.h"
+#include "blend/mirror.h"
+#include "controller/controller.h"
+
+namespace game
+{
+
+// Blending weights of 4 joints. SimdFloat4 is wrapped, as its alignment
+// attributes are ignored when it's a container template argument.
+struct SoaWeight {
+    ozz::math::SimdFloat4 value;
+};
+
+// Per joint blending weights, as SoA (see BlendingJob::Layer::joint_weights).
+// inverse_weights are 1 - weights, for the pose blended under the mask.
+struct JointMask {
+    ozz::vector<SoaWeight> weights;
+    ozz::vector<SoaWeight> inverse_weights;
+};
+
+// Builds _mask from _root joint subtree, other joints weight is 0. Weights
+// ramp up over _falloff joints, _root weight being 1 / (_falloff + 1), so that
+// the masked pose fades in along the hierarchy.
+bool BuildJointMask(const ozz::animation::Skeleton& _skeleton, int _root,
+                    int _falloff, JointMask* _mask);
+
+// Builds clip sync markers (see BlendTree::SetClipMarkers) from a float track
+// authored alongside the clip. A marker is set every time the track rises
+// above .5, typically at every foot down. Only the [_begin, _end] ratio range
+// of the track is used, for sub-clips (see BlendTree::AddSubClip).
+bool BuildSyncMarkers(const ozz::animation::FloatTrack& _track, float _begin,
+                      float _end, ozz::vector<float>* _markers);
+
+// State machine transition condition, comparing a parameter to a value.
+struct BlendCondition {
+    enum Comparison {
+        kLess,
+        kGreater,
+        kEqual,
+        kNotEqual,
+    };
+
+    int parameter;
+    Comparison comparison;
+    float value;
+};
+
+// State machine transition, from one state (child) to another.
+struct BlendTransition {
+    BlendTransition();
+
+    // Source state, or -1 to transition from any state.
+    int from;
+
+    // Destination state.
+    int to;
+
+    // Crossfade duration, in seconds.
+    float duration;
+
+    // Inertializes instead of crossfading, so that only the destination state
+    // is sampled during the transition (see Inertializer).
+    bool inertialize;
+
+    // If positive, transition can only happen once the source state leading
+    // clip time ratio is past exit_ratio.
+    float exit_ratio;
+
+    // Destination state starts in phase with the source state, matching their
+    // leading clips sync markers (see BlendTree::SetClipMarkers). Otherwise
+    // destination state clips restart from the beginning.
+    bool sync;
+
+    // Conditions that must all be met.
+    ozz::vector<BlendCondition> conditions;
+};
+
+// Blend tree node. Nodes are set once, then evaluated every update with the
+// current value of their parameters.
+struct BlendNode {
+    enum Type {
+        // Samples clip.
+        kClip,
+        // Blends children[0] to children[1], by parameter in [0,1].
+        kLerp,
+        // Adds children[1] to children[0], weighted by parameter in [0,1].
+        // children[1] must be a kClip node playing an additive clip.
+        kAdditive,
+        // Blends the two children whose positions surround parameter.
+        // positions are sorted in ascending order.
+        kBlend1D,
+        // Blends the three children of the positions triangle that contains
+        // (parameter, parameter_y), using its barycentric coordinates. Out of
+        // the triangulation, blends the two children of the nearest edge.
+        kBlend2D,
+        // Plays one child (state) at a time, crossfading to another one when
+        // a transition conditions are met.
+        kStateMachine,
+    };
+
+    BlendNode();
+
+    Type type;
+
+    // Clip index, for kClip nodes.
+    int clip;
+
+    // Samples kClip nodes clip mirrored (see BlendTree::set_mirror_table), so
+    // that it plays on the other side. Additive clips can't be mirrored.
+    bool mirror;
+
+    // Parameter indices, see BlendTree::AddParameter.
+    int parameter;
+    int parameter_y;
+
+    // Joint mask index (see BlendTree::set_joint_masks) of kLerp and kAdditive
+    // nodes, or -1. children[1] then only affects masked joints, according to
+    // their weight.
+    int mask;
+
+    // Children node indices. Children must follow their parent, which
+    // guarantees the tree has no cycle.
+    ozz::vector<int> children;
+
+    // Blend space position of every child, only x is used by kBlend1D.
+    ozz::vector<ozz::math::Float2> positions;
+
+    // State machine transitions, tested in order. The first one whose
+    // conditions are met is taken. Transitions aren't interrupted.
+    ozz::vector<BlendTransition> transitions;
+
+    // Synchronizes kLerp, kBlend1D and kBlend2D children, whatever their
+    // duration: the node cycle duration is blended from its children ones,
+    // and all its clips are kept in phase with the leading one, matching their
+    // sync markers.
+    bool sync;
+};
+
+// Data-driven blend tree, whose root is nodes[0]. Every update, blend weights
+// are computed top-down from parameters, and subtrees whose weight is zero are
+// culled before anything is sampled. Every node output is cached, and reused
+// as long as its inputs don't change: clip time ratio, children weights and
+// outputs. Evaluation thus only costs the contributing clips that moved, and
+// the blends they feed. Idle poses, fixed parameters and paused clips are free.
+class BlendTree {
+ public:
+    BlendTree();
+
+    // Adds a clip playing _animation, at _speed and looped. Returns its index.
+    // _additive clips are deltas (see BuildAdditiveAnimation), for kAdditive
+    // nodes. Like masks, animations are shared by all the trees of a skeleton,
+    // and must outlive the tree. Only sampling contexts belong to the tree.
+    int AddClip(const ozz::animation::Animation& _animation, float _speed,
+                bool _additive);
+
+    // Adds sub-clip _name, the [_begin, _end] time ratio range of _clip, played
+    // at _speed and looped inside the range. Returns its index, or -1 if the
+    // range is empty. Sub-clips share _clip animation, so that moves of a long
+    // take don't need copies. Each one has its own sampling context though, so
+    // that sub-clips playing at once (blended or crossfading) don't keep
+    // seeking a shared one.
+    int AddSubClip(int _clip, const char* _name, float _begin, float _end,
+                   float _speed);
+
+    // Returns the index of sub-clip _name, or -1 if it doesn't exist.
+    int FindClip(const char* _name) const;
+
+    // Sets _clip sync markers, as sorted time ratios. Synchronized clips are
+    // matched marker to marker (foot down to foot down...), whatever their
+    // duration and markers placement.
+    void SetClipMarkers(int _clip, const ozz::vector<float>& _markers);
+
+    // Returns the index of parameter _name, adding it if needed.
+    int AddParameter(const char* _name);
+
+    // Returns the index of parameter _name, or -1 if it doesn't exist.
+    int FindParameter(const char* _name) const;
+
+    // Sets parameter _index value.
+    void set_parameter(int _index, float _value);
+
+    // Sets the joint masks nodes refer to. Masks are shared by all the trees
+    // of a skeleton, and must outlive the tree.
+    void set_joint_masks(const ozz::vector<JointMask>* _masks) {
+        masks_ = _masks;
+    }
+
+    // Sets the mirror table mirrored clip nodes use. Like masks, the table is
+    // shared by all the trees of a skeleton, and must outlive the tree. The
+    // track mask given to Evaluate must then include counterparts tracks.
+    // Changing the table content requires InvalidateCaches.
+    void set_mirror_table(const MirrorTable* _mirror) { mirror_ = _mirror; }
+
+    // Discards cached outputs, so that the next evaluation samples all clips
+    // again, after shared data they were built with changed.
+    void InvalidateCaches();
+
+    // Replaces tree nodes. Returns false and leaves the tree empty if a node
+    // refers to an invalid clip, parameter or child, or if its children or
+    // positions don't match its type, including a kAdditive node whose delta
+    // isn't an additive clip.
+    bool SetNodes(const ozz::vector<BlendNode>& _nodes);
+
+    // Advances all clips playback time by _dt, including culled ones so that
+    // they stay in phase. Clips of synchronized nodes follow their leading
+    // clip instead. Then updates state machines crossfades, and takes
+    // transitions whose conditions are met.
+    void Update(float _dt);
+
+    // Evaluates the tree to _output. _track_mask is forwarded to clips
+    // sampling (see SamplingJob::track_mask), masked tracks are set to
+    // _skeleton rest pose. Changing _track_mask or _skeleton invalidates
+    // cached outputs.
+    bool Evaluate(const ozz::animation::Skeleton& _skeleton,
+                  const ozz::span<const ozz::byte>& _track_mask,
+                  const ozz::span<ozz::math::SoaTransform>& _output);
+
+    // Returns false if the last evaluation output is the same as the previous
+    // one, reused from cache.
+    bool changed() const { return changed_; }
+
+    // Returns true if the tree has no node, and thus can't be evaluated.
+    bool empty() const { return nodes_.empty(); }
+
+    int num_clips() const { return static_cast<int>(clips_.size()); }
+
+    // Returns the animation played by clip _clip, shared by its sub-clips.
+    const ozz::animation::Animation& clip_animation(int _clip) const {
+        return *clips_[_clip]->animation;
+    }
+
+    // Number of clips sampled by the last evaluation, excluding the ones
+    // reused from cache.
+    int num_sampled_clips() const { return num_sampled_clips_; }
+
+    // Returns _node current state, or -1 if _node isn't a state machine.
+    int state(int _node) const;
+
+ private:
+    // Clip playback state, whose controller range is the part of animation
+    // the clip plays. animation is shared by a clip and its sub-clips, while
+    // every clip samples it with its own context. synced clips are played by
+    // their synchronized node (see BlendNode::sync).
+    struct Clip {
+        explicit Clip(const ozz::animation::Animation& _animation);
+
+        // Played range duration, in seconds.
+        float duration() const;
+
+        const ozz::animation::Animation* animation;
+        ozz::animation::SamplingJob::Context context;
+        std::string name;
+        PlaybackController controller;
+        bool additive;
+        bool synced;
+        ozz::vector<float> markers;
+    };
+
+    // Node output of the last evaluation, and the inputs it was computed
+    // from: clip time ratio, or children weights and output stamps. stamp
+    // identifies the output, and changes every time it's recomputed.
+    struct NodeCache {
+        NodeCache() : valid(false), ratio(0.f), stamp(0) {}
+        bool valid;
+        float ratio;
+        unsigned int stamp;
+        ozz::vector<float> weights;
+        ozz::vector<unsigned int> stamps;
+        ozz::vector<ozz::math::SoaTransform> pose;
+    };
+
+    // State machine runtime state. previous is the state being faded out, or
+    // -1 if no transition is in progress.
+    struct Machine {
+        int state;
+        int previous;
+        float fade_time;
+        float fade_duration;
+    };
+
+    // Takes _node first transition whose conditions are met.
+    void UpdateStateMachine(int _node, float _dt);
+
+    // Advances synchronized _node leading clip at _node blended cycle
+    // duration, and keeps its other clips in phase.
+    void UpdateSyncedNode(int _node, float _dt);
+
+    // Returns the clip contributing the most to _node, as of the last
+    // evaluation.
+    int LeadingClip(int _node) const;
+
+    // Sets the time ratio of all clips of _node subtree.
+    void SetTimeRatio(int _node, float _ratio);
+
+    // Maps _ratio of clip _from to clip _to, according to their sync markers.
+    float SyncRatio(int _from, float _ratio, int _to) const;
+
+    // Sets the time ratio of all clips of _node subtree in phase with clip
+    // _from _ratio, see SyncRatio.
+    void SyncTimeRatio(int _node, int _from, float _ratio);
+
+    // Evaluates _node, reusing cached outputs whose inputs didn't change.
+    // Returns the node whose cached pose is _node output, which is a
+    // descendant if _node has a single contributing child, or -1 on failure.
+    int EvaluateNode(int _node, const ozz::animation::Skeleton& _skeleton,
+                     const ozz::span<const ozz::byte>& _track_mask);
+
+    // Evaluates and blends _node children, see EvaluateNode.
+    int EvaluateChildren(int _node, const ozz::animation::Skeleton& _skeleton,
+                         const ozz::span<const ozz::byte>& _track_mask);
+
+    // Computes _node children weights, culling the ones that don't
+    // contribute. Returns the number of contributing children.
+    int ComputeWeights(int _node);
+
+    ozz::vector<ozz::unique_ptr<Clip>> clips_;
+    ozz::vector<std::string> parameter_names_;
+    ozz::vector<float> parameters_;
+    ozz::vector<BlendNode> nodes_;
+    const ozz::vector<JointMask>* masks_;
+    const MirrorTable* mirror_;
+
+    // Per node children weights, and the nodes holding children outputs (see
+    // EvaluateNode), valid while the node is evaluated.
+    ozz::vector<ozz::vector<float>> weights_;
+    ozz::vector<ozz::vector<int>> child_poses_;
+    ozz::vector<Machine> machines_;
+
+    // Per node positions triangulation of kBlend2D nodes, as triplets of
+    // children indices, and the edges parameters out of it are projected on,
+    // as pairs of children indices.
+    ozz::vector<ozz::vector<int>> triangles_;
+    ozz::vector<ozz::vector<int>> edges_;
+
+    // Synchronized nodes that aren't part of another synchronized subtree.
+    ozz::vector<int> synced_nodes_;
+
+    // Per node inertializer, only allocated for state machines with
+    // inertialized transitions. last_dt_ is the last Update time step.
+    ozz::vector<ozz::unique_ptr<Inertializer>> inertializers_;
+    float last_dt_;
+
+    // Per node cached outputs, valid for track_mask_ and num_soa_joints_.
+    // stamp_ is the last output stamp, output_stamp_ the one of the tree
+    // output.
+    ozz::vector<NodeCache> caches_;
+    ozz::vector<ozz::byte> track_mask_;
+    int num_soa_joints_;
+    unsigned int stamp_;
+    unsigned int output_stamp_;
+    bool changed_;
+
+    ozz::vector<ozz::animation::BlendingJob::Layer> layers_;
+
+    int num_sampled_clips_;
+};
+}  // namespace game
+#endif  // OZZ_GAME_BLEND_TREE_H_
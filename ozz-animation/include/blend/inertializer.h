@@ -0,0 +1,89 @@
+#ifndef OZZ_GAME_INERTIALIZER_H_
+#define OZZ_GAME_INERTIALIZER_H_
+
+#include "ozz/base/containers/vector.h"
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/base/maths/soa_float.h"
+#include "ozz/base/maths/soa_quaternion.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/platform.h"
+#include "ozz/base/span.h"
+
+namespace game
+{
+
+// Inertialization transition, a cheaper alternative to crossfades. Instead of
+// sampling both source and target for the whole transition, the offset from
+// the target to the last source pose is recorded at transition time, and
+// decayed to zero while only the target is sampled.
+// Every joint translation, rotation and scale offset decays along its own
+// quintic polynomial, which matches the offset initial value and velocity
+// (computed from the last two source poses), and reaches zero with zero
+// velocity and acceleration. Offsets and polynomials are processed as SoA, 4
+// joints at a time.
+// The source pose must be recorded every update. A source that skipped
+// updates, typically a blend tree node culled by its parent, resets the
+// inertializer instead: poses recorded before the gap are forgotten, so that
+// a transition beginning right after it starts without offset rather than from
+// a stale pose.
+class Inertializer {
+ public:
+    Inertializer();
+
+    // Records _pose, the latest output of the source pose. _dt is the time
+    // since the previous recorded pose, which is forgotten if it wasn't
+    // recorded during the previous update.
+    void Record(const ozz::span<const ozz::math::SoaTransform>& _pose,
+                float _dt);
+
+    // Starts a transition of _duration seconds. Offsets are computed by the
+    // next Apply, from the last two recorded poses to the target pose. Does
+    // nothing if no pose was recorded since the previous update.
+    void Begin(float _duration);
+
+    // Advances transition time. Called every update, transition or not.
+    void Update(float _dt);
+
+    // Adds decaying offsets to target _pose. Does nothing if no transition is
+    // in progress.
+    void Apply(const ozz::span<ozz::math::SoaTransform>& _pose);
+
+    // Returns true while a transition is in progress.
+    bool active() const { return active_; }
+
+ private:
+    // Offset decay polynomial coefficients, normalized so that initial offset
+    // is 1: f(t) = ((((a.t + b).t + c).t + d).t + v).t + 1, for t < t1.
+    struct Decay {
+        ozz::math::SimdFloat4 a, b, c, d, v, t1;
+    };
+
+    // Computes the decay of offset _x, whose value at the previous recorded
+    // pose was _x_prev.
+    Decay ComputeDecay(ozz::math::_SimdFloat4 _x,
+                       ozz::math::_SimdFloat4 _x_prev) const;
+
+    // Computes offsets and their decay from recorded poses to target _pose.
+    void ComputeOffsets(const ozz::span<const ozz::math::SoaTransform>& _pose);
+
+    // Last two recorded poses, poses_[latest_] is the latest.
+    ozz::vector<ozz::math::SoaTransform> poses_[2];
+    int num_poses_;
+    int latest_;
+    float dt_;
+
+    // Number of updates since the latest recorded pose.
+    int updates_;
+
+    // Per SoA joint offsets, and their translation, rotation and scale
+    // decays.
+    ozz::vector<ozz::math::SoaTransform> offsets_;
+    ozz::vector<Decay> decays_;
+
+    bool active_;
+    bool pending_;
+    float duration_;
+    float time_;
+};
+}  // namespace game
+#endif  // OZZ_GAME_INERTIALIZER_H_
@@ -0,0 +1,60 @@
+#ifndef OZZ_GAME_MIRROR_H_
+#define OZZ_GAME_MIRROR_H_
+
+#include "ozz/base/containers/vector.h"
+#include "ozz/base/maths/soa_quaternion.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/platform.h"
+#include "ozz/base/span.h"
+
+#include "ozz/animation/runtime/skeleton.h"
+
+namespace game
+{
+
+// Model-space axis the mirror plane is normal to. The plane goes through the
+// origin.
+enum MirrorAxis {
+    kMirrorX,
+    kMirrorY,
+    kMirrorZ,
+};
+
+// Skeleton mirror table, mapping every joint to its counterpart on the other
+// side of the mirror plane, so that a single clip can be played on both sides
+// instead of importing a mirrored copy.
+struct MirrorTable {
+    MirrorAxis axis;
+
+    // Counterpart of every joint, the joint itself if it's on the mirror
+    // plane.
+    ozz::vector<int16_t> joints;
+
+    // Joints exchanged by mirroring, as pairs of counterparts.
+    ozz::vector<int16_t> pairs;
+
+    // Per SoA joint rotations that map a joint reflected rest pose onto its
+    // counterpart one, and conjugate rotations of their parent. Empty if
+    // counterparts local axes are already mirror images, which only needs a
+    // reflection.
+    ozz::vector<ozz::math::SoaQuaternion> corrections;
+    ozz::vector<ozz::math::SoaQuaternion> parent_corrections;
+};
+
+// Builds _table from _skeleton joint names: the counterpart of a joint whose
+// name contains _left is the joint whose name has _left replaced by _right,
+// and conversely. Other joints are their own counterpart. Returns false if a
+// counterpart is missing, or if counterparts parents aren't counterparts.
+bool BuildMirrorTable(const ozz::animation::Skeleton& _skeleton,
+                      MirrorAxis _axis, const char* _left, const char* _right,
+                      MirrorTable* _table);
+
+// Mirrors _pose in place, a local-space pose of _table skeleton sampled from
+// any clip. Counterparts transforms are exchanged, then reflected through the
+// mirror plane, for a few SoA operations per joint. Only the tracks of
+// counterparts of sampled joints need to be sampled (see
+// SamplingJob::track_mask).
+bool MirrorPose(const MirrorTable& _table,
+                const ozz::span<ozz::math::SoaTransform>& _pose);
+}  // namespace game
+#endif  // OZZ_GAME_MIRROR_H_
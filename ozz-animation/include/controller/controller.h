@@ -47,12 +47,26 @@ class PlaybackController {
     // Gets loop mode.
     bool loop() const { return loop_; }
 
+    // Restricts playback to the [_begin, _end] time ratio range of the
+    // animation, clamped to the unit interval. Time ratio is then relative to
+    // this range, so looping and clamping happen at its bounds.
+    void set_range(float _begin, float _end);
+
+    // Gets playback range bounds.
+    float range_begin() const { return range_begin_; }
+    float range_end() const { return range_end_; }
+
+    // Gets the animation time ratio to sample, the current time ratio mapped
+    // to the playback range.
+    float animation_ratio() const;
+
     // Updates animation time if in "play" state, according to playback speed and
     // given frame time _dt.
     // Returns true if animation has looped during update
     void Update(const ozz::animation::Animation& _animation, float _dt);
 
-    // Resets all parameters to their default value.
+    // Resets all playback parameters to their default value. The playback
+    // range isn't reset, as it defines the clip (see set_range).
     void Reset();
 
  private:
@@ -71,6 +85,10 @@ class PlaybackController {
 
     // Animation loop mode.
     bool loop_;
+
+    // Playback range, as animation time ratios.
+    float range_begin_;
+    float range_end_;
 };
 
 }
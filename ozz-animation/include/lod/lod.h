@@ -0,0 +1,75 @@
+#ifndef OZZ_GAME_LOD_H_
+#define OZZ_GAME_LOD_H_
+
+#include "ozz/base/containers/vector.h"
+#include "ozz/base/maths/simd_float3x4.h"
+#include "ozz/base/platform.h"
+
+#include "ozz/base/span.h"
+
+#include "ozz/animation/offline/raw_animation.h"
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/skeleton.h"
+
+#include "mesh/mesh.h"
+
+namespace game
+{
+
+// Reduced joint set of a skeleton, used to animate distant characters for a
+// cost proportional to their number of joints. Leaf chains (fingers, toes,
+// helpers...) are collapsed into their closest surviving ancestor. As joints
+// are only removed from the leaves, surviving joints keep their parent and
+// local transforms, so the reduced skeleton is animated by a subset of the
+// original animation tracks.
+struct SkeletonLod {
+    // Reduced skeleton.
+    ozz::animation::Skeleton skeleton;
+
+    // Original skeleton joint, aka animation track, of every reduced skeleton
+    // joint.
+    ozz::vector<int16_t> tracks;
+
+    // Reduced skeleton joint of every original skeleton joint, which is the
+    // joint itself or its closest surviving ancestor.
+    ozz::vector<int16_t> joints;
+};
+
+// Builds _lod from _skeleton, keeping at most _max_joints joints. Deepest
+// leaves are collapsed first, so leaf chains shrink from their tips. Roots are
+// never collapsed.
+bool BuildSkeletonLod(const ozz::animation::Skeleton& _skeleton,
+                      int _max_joints, SkeletonLod* _lod);
+
+// Samples _animation _tracks (all tracks if empty) at a constant _sample_rate
+// (in hertz), including first and last frames, to _raw_animation. Runtime
+// keyframes can't be extracted, so this is how runtime animations are
+// rebuilt. A _sample_rate of 0 matches _animation own rate, estimated from its
+// closest keyframes.
+bool ResampleAnimation(const ozz::animation::Animation& _animation,
+                       const ozz::span<const int16_t>& _tracks,
+                       float _sample_rate,
+                       ozz::animation::offline::RawAnimation* _raw_animation);
+
+// Builds _lod_animation from _animation tracks of _lod joints. Tracks are
+// resampled at _sample_rate (0 to match _animation, see ResampleAnimation) and
+// optimized again.
+bool BuildAnimationLod(const ozz::animation::Animation& _animation,
+                       const SkeletonLod& _lod, float _sample_rate,
+                       ozz::animation::Animation* _lod_animation);
+
+// Mesh skin rebound to skeleton LOD joints, see BuildSkinLod. Matches
+// Mesh::joint_remaps and Mesh::inverse_bind_poses.
+struct SkinLod {
+    Mesh::JointRemaps joint_remaps;
+    Mesh::InversBindPoses inverse_bind_poses;
+};
+
+// Rebinds _mesh skin to _lod joints. Vertices skinned by a collapsed joint
+// follow its closest surviving ancestor, as if collapsed joints were in their
+// _skeleton rest pose. Mesh vertices aren't modified, so the number of
+// skinning matrices is unchanged.
+bool BuildSkinLod(const Mesh& _mesh, const ozz::animation::Skeleton& _skeleton,
+                  const SkeletonLod& _lod, SkinLod* _skin);
+}  // namespace game
+#endif  // OZZ_GAME_LOD_H_
@@ -5,6 +5,7 @@
 #include "ozz/base/containers/vector.h"
 #include "ozz/base/containers/vector_archive.h"
 #include "ozz/base/io/archive_traits.h"
+#include "ozz/base/maths/simd_float3x4.h"
 #include "ozz/base/maths/simd_math.h"
 #include "ozz/base/maths/vec_float.h"
 #include "ozz/base/platform.h"
@@ -134,7 +135,9 @@ namespace game
     JointRemaps joint_remaps;
 
     // Inverse bind-pose matrices. These are only available for skinned meshes.
-    typedef ozz::vector<ozz::math::Float4x4> InversBindPoses;
+    // They are affine, so they're stored as Float3x4 at runtime, but archived
+    // as Float4x4 to keep mesh files compatible.
+    typedef ozz::vector<ozz::math::Float3x4> InversBindPoses;
     InversBindPoses inverse_bind_poses;
 
     // Used at runtime to set vert buffers - dont like this at all!
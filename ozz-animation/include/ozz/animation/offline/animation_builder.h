@@ -29,6 +29,7 @@
 #define OZZ_OZZ_ANIMATION_OFFLINE_ANIMATION_BUILDER_H_
 
 #include "ozz/animation/offline/export.h"
+#include "ozz/base/containers/vector.h"
 #include "ozz/base/memory/unique_ptr.h"
 
 namespace ozz {
@@ -44,12 +45,16 @@ struct RawAnimation;
 
 // Defines the class responsible of building runtime animation instances from
 // offline raw animations.
-// No optimization at all is performed on the raw animation.
+// No lossy optimization is performed on the raw animation, unless tolerances
+// are provided (see tolerances and spline). SoA tracks that are constant for
+// the whole animation are stored once in a constant table rather than as
+// keyframes, and scales are not stored at all if they're all 1.
 class OZZ_ANIMOFFLINE_DLL AnimationBuilder {
  public:
   // Creates an Animation based on _raw_animation and *this builder parameters.
   // Returns a valid Animation on success.
-  // See RawAnimation::Validate() for more details about failure reasons.
+  // See RawAnimation::Validate() for more details about failure reasons. Also
+  // fails if tolerances aren't empty and don't match animation's tracks count.
   // The animation is returned as an unique_ptr as ownership is given back to
   // the caller.
   unique_ptr<Animation> operator()(const RawAnimation& _raw_animation) const;
@@ -62,6 +67,33 @@ class OZZ_ANIMOFFLINE_DLL AnimationBuilder {
   // the interval between iframes, with a guaranted one at the end of the
   // animation if interval is bigger than animation duration.
   float iframe_interval = 0.f;
+
+  // Maximum error allowed when quantizing a track's keyframes.
+  struct Tolerance {
+    float translation;  // Distance, in translation units.
+    float rotation;     // Angle, in radians.
+    float scale;        // Scale factor difference.
+  };
+
+  // Per track tolerances, enabling variable bit-rate quantization.
+  // If empty (default), keyframes are stored with fixed precision: half floats
+  // for translations and scales, 15 bits per component for rotations.
+  // Otherwise there must be one tolerance per animation track. The builder
+  // then picks, for each track and transformation type, the smallest number
+  // of bits that keeps quantization error within tolerance.
+  // AnimationOptimizer::ComputeTolerances computes tolerances from joints
+  // hierarchical error.
+  ozz::vector<Tolerance> tolerances;
+
+  // Interpolates keyframes with cubic Hermite splines rather than linearly.
+  // Keyframes tangents are computed from raw animation keyframes (Catmull-Rom,
+  // see TangentTranslation...) and stored as half floats. If tolerances are
+  // provided, keyframes that splines reconstruct within tolerance are then
+  // removed. Smooth motions require far less keyframes than with linear
+  // interpolation, so the raw animation should be densely sampled rather than
+  // decimated by AnimationOptimizer. Note that spline fitting and quantization
+  // errors add up.
+  bool spline = false;
 };
 }  // namespace offline
 }  // namespace animation
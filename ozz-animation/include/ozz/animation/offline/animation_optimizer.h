@@ -28,8 +28,10 @@
 #ifndef OZZ_OZZ_ANIMATION_OFFLINE_ANIMATION_OPTIMIZER_H_
 #define OZZ_OZZ_ANIMATION_OFFLINE_ANIMATION_OPTIMIZER_H_
 
+#include "ozz/animation/offline/animation_builder.h"
 #include "ozz/animation/offline/export.h"
 #include "ozz/base/containers/map.h"
+#include "ozz/base/containers/vector.h"
 
 namespace ozz {
 namespace animation {
@@ -70,6 +72,17 @@ class OZZ_ANIMOFFLINE_DLL AnimationOptimizer {
   bool operator()(const RawAnimation& _input, const Skeleton& _skeleton,
                   RawAnimation* _output) const;
 
+  // Computes for each track of _input the error allowed on its translation,
+  // rotation and scale, according to *this settings and joints hierarchy.
+  // These tolerances are meant to drive AnimationBuilder variable bit-rate
+  // quantization (see AnimationBuilder::tolerances). Note that decimation and
+  // quantization errors add up.
+  // Returns false on failure, if _input isn't valid or doesn't match
+  // _skeleton, and clears _tolerances.
+  bool ComputeTolerances(
+      const RawAnimation& _input, const Skeleton& _skeleton,
+      ozz::vector<AnimationBuilder::Tolerance>* _tolerances) const;
+
   // Optimization settings.
   struct Setting {
     // Default settings
@@ -53,6 +53,43 @@ OZZ_ANIMOFFLINE_DLL math::Float3 LerpScale(const math::Float3& _a,
                                            const math::Float3& _b,
                                            float _alpha);
 
+// Cubic Hermite spline interpolation methods, used instead of Lerp methods by
+// animations built with AnimationBuilder::spline. _ta and _tb are _a and _b
+// tangents, scaled by the time interval from _a to _b.
+OZZ_ANIMOFFLINE_DLL math::Float3 HermiteTranslation(const math::Float3& _a,
+                                                    const math::Float3& _ta,
+                                                    const math::Float3& _b,
+                                                    const math::Float3& _tb,
+                                                    float _alpha);
+
+OZZ_ANIMOFFLINE_DLL math::Quaternion HermiteRotation(
+    const math::Quaternion& _a, const math::Quaternion& _ta,
+    const math::Quaternion& _b, const math::Quaternion& _tb, float _alpha);
+
+OZZ_ANIMOFFLINE_DLL math::Float3 HermiteScale(const math::Float3& _a,
+                                              const math::Float3& _ta,
+                                              const math::Float3& _b,
+                                              const math::Float3& _tb,
+                                              float _alpha);
+
+// Spline tangent methods. Computes _key tangent (derivative per time unit)
+// from its previous and next keyframes, aka Catmull-Rom tangent. The first and
+// last keyframes of a track are their own previous or next keyframe.
+OZZ_ANIMOFFLINE_DLL math::Float3 TangentTranslation(
+    const RawAnimation::TranslationKey& _prev,
+    const RawAnimation::TranslationKey& _key,
+    const RawAnimation::TranslationKey& _next);
+
+// Rotation tangent matches _key quaternion sign.
+OZZ_ANIMOFFLINE_DLL math::Quaternion TangentRotation(
+    const RawAnimation::RotationKey& _prev,
+    const RawAnimation::RotationKey& _key,
+    const RawAnimation::RotationKey& _next);
+
+OZZ_ANIMOFFLINE_DLL math::Float3 TangentScale(
+    const RawAnimation::ScaleKey& _prev, const RawAnimation::ScaleKey& _key,
+    const RawAnimation::ScaleKey& _next);
+
 // Samples a RawAnimation track. This function shall be used for offline
 // purpose. Use ozz::animation::Animation and ozz::animation::SamplingJob for
 // runtime purpose.
@@ -53,6 +53,13 @@ class OZZ_ANIMOFFLINE_DLL SkeletonBuilder {
   // caller.
   ozz::unique_ptr<ozz::animation::Skeleton> operator()(
       const RawSkeleton& _raw_skeleton) const;
+
+  // Stores joints in breadth-first order (sorted by depth, siblings next to
+  // each other) rather than depth-first. LocalToModelJob is faster with such
+  // skeletons, as consecutive joints rarely depend on each other. Joint indices
+  // differ from depth-first ones, so animations must be built against the
+  // resulting skeleton. See Skeleton::Ordering.
+  bool breadth_first = false;
 };
 }  // namespace offline
 }  // namespace animation
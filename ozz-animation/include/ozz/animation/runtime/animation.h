@@ -49,6 +49,9 @@ class AnimationBuilder;
 namespace internal {
 struct Float3Key;
 struct QuaternionKey;
+struct Float4Key;
+struct Float3Quantization;
+struct QuaternionQuantization;
 }  // namespace internal
 
 // Defines a runtime skeletal animation clip.
@@ -61,6 +64,16 @@ struct QuaternionKey;
 // joints order of the runtime skeleton structure. In order to optimize cache
 // coherency when sampling the animation, Keyframes in this array are sorted by
 // time, then by track number.
+// SoA tracks (groups of 4 tracks) that are constant for the whole animation
+// have no keyframe. Their value is stored once in a per-transformation type
+// constant table instead. Animations without any scale don't store scale data
+// at all.
+// Keyframe values are either stored with a fixed precision format, or with a
+// variable bit-rate format where the number of bits is chosen per track (see
+// AnimationBuilder::tolerances).
+// Keyframes are linearly interpolated, unless the animation stores keyframe
+// tangents, in which case they are interpolated with cubic Hermite splines
+// (see AnimationBuilder::spline).
 class OZZ_ANIMATION_DLL Animation {
  public:
   // Builds a default animation.
@@ -136,7 +149,129 @@ class OZZ_ANIMATION_DLL Animation {
   typedef TKeyframesCtrl<true> KeyframesCtrlConst;
   typedef TKeyframesCtrl<false> KeyframesCtrl;
 
-  // Gets the buffer of translations keys.
+  // Describes the SoA tracks of a transformation type that are constant for
+  // the whole animation. Keyframes are only stored for the other SoA tracks
+  // (named keyed SoA tracks), in the same order, so keyframes track indices are
+  // relative to keyed SoA tracks.
+  template <bool _Const>
+  struct TConstants {
+    size_t size_bytes() const {
+      return flags.size_bytes() + values.size_bytes();
+    }
+
+    // Implicit conversion to const.
+    operator TConstants<true>() const {
+      return {flags, values, num_keyed_soa_tracks};
+    }
+
+    // Tests if SoA track _soa_track is constant.
+    bool constant(size_t _soa_track) const {
+      return !flags.empty() &&
+             (flags[_soa_track / 8] & (1 << (_soa_track & 7))) != 0;
+    }
+
+    template <typename _Ty, bool>
+    struct ConstQualifier {
+      typedef const _Ty type;
+    };
+
+    template <typename _Ty>
+    struct ConstQualifier<_Ty, false> {
+      typedef _Ty type;
+    };
+
+    // One bit per SoA track (8 SoA tracks per byte, starting from the least
+    // significant bit), set if the SoA track is constant. Empty if no SoA track
+    // is constant.
+    span<typename ConstQualifier<byte, _Const>::type> flags;
+
+    // Values of constant SoA tracks, in SoA layout: 4 x 3 floats for
+    // translations and scales, 4 x 4 floats for rotations, per constant SoA
+    // track.
+    span<typename ConstQualifier<float, _Const>::type> values;
+
+    // Number of SoA tracks that have keyframes.
+    int num_keyed_soa_tracks;
+  };
+
+  typedef TConstants<true> ConstantsConst;
+  typedef TConstants<false> Constants;
+
+  // Number of floats stored per constant SoA track.
+  static constexpr int kFloat3ConstantSize = 4 * 3;
+  static constexpr int kQuaternionConstantSize = 4 * 4;
+
+  // Gets the constant SoA tracks of each transformation type.
+  ConstantsConst translations_constants() const {
+    return translations_constants_;
+  }
+  ConstantsConst rotations_constants() const { return rotations_constants_; }
+  ConstantsConst scales_constants() const { return scales_constants_; }
+
+  // Returns false if the animation has no scale, aka all scales are 1. In this
+  // case scale keyframes and constants are both empty.
+  bool has_scale() const {
+    return scales_constants_.num_keyed_soa_tracks != 0 ||
+           !scales_constants_.values.empty();
+  }
+
+  // Describes variable bit-rate keyframes of a transformation type. Keyframe
+  // values of each track are stored consecutively in a bit stream, with a
+  // number of bits per component chosen per track. In this case fixed
+  // precision keyframes (see translations_values()...) are empty.
+  template <typename _Quantization, bool _Const>
+  struct TQuantization {
+    size_t size_bytes() const {
+      return tracks.size_bytes() + stream.size_bytes();
+    }
+
+    // Implicit conversion to const.
+    operator TQuantization<_Quantization, true>() const {
+      return {tracks, stream};
+    }
+
+    // Tests if keyframes use variable bit-rate format.
+    bool variable() const { return !tracks.empty(); }
+
+    template <typename _Ty, bool>
+    struct ConstQualifier {
+      typedef const _Ty type;
+    };
+
+    template <typename _Ty>
+    struct ConstQualifier<_Ty, false> {
+      typedef _Ty type;
+    };
+
+    // Quantization parameters, one per keyed SoA track.
+    span<typename ConstQualifier<_Quantization, _Const>::type> tracks;
+
+    // Bit stream of quantized keyframes. It's padded with 8 bytes, so that 64
+    // bits can be read from any keyframe.
+    span<typename ConstQualifier<byte, _Const>::type> stream;
+  };
+
+  typedef TQuantization<internal::Float3Quantization, true>
+      Float3QuantizationConst;
+  typedef TQuantization<internal::Float3Quantization, false> Float3Quantization;
+  typedef TQuantization<internal::QuaternionQuantization, true>
+      QuaternionQuantizationConst;
+  typedef TQuantization<internal::QuaternionQuantization, false>
+      QuaternionQuantization;
+
+  // Gets variable bit-rate keyframes of each transformation type.
+  Float3QuantizationConst translations_quantization() const {
+    return translations_quantization_;
+  }
+  QuaternionQuantizationConst rotations_quantization() const {
+    return rotations_quantization_;
+  }
+  Float3QuantizationConst scales_quantization() const {
+    return scales_quantization_;
+  }
+
+  // Gets the buffer of translations keys. Values are empty if keyframes use
+  // variable bit-rate format.
   KeyframesCtrlConst translations_ctrl() const { return translations_ctrl_; }
   span<const internal::Float3Key> translations_values() const {
     return translations_values_;
@@ -154,6 +289,20 @@ class OZZ_ANIMATION_DLL Animation {
     return scales_values_;
   }
 
+  // Gets keyframes tangents of each transformation type, one per keyframe in
+  // the same order as keyframes. Tangents are derivatives relative to the
+  // animation ratio. They're empty unless keyframes are interpolated with cubic
+  // Hermite splines.
+  span<const internal::Float3Key> translations_tangents() const {
+    return translations_tangents_;
+  }
+  span<const internal::Float4Key> rotations_tangents() const {
+    return rotations_tangents_;
+  }
+  span<const internal::Float3Key> scales_tangents() const {
+    return scales_tangents_;
+  }
+
   // Get the estimated animation's size in bytes.
   size_t size() const;
 
@@ -183,6 +332,31 @@ class OZZ_ANIMATION_DLL Animation {
     IFrames translation_iframes;
     IFrames rotation_iframes;
     IFrames scale_iframes;
+
+    struct ConstantsSize {
+      size_t flags;
+      size_t values;
+    };
+
+    ConstantsSize translation_constants;
+    ConstantsSize rotation_constants;
+    ConstantsSize scale_constants;
+
+    // Keyframes values are stored in a bit stream instead of fixed precision
+    // keys if tracks isn't 0.
+    struct QuantizationSize {
+      size_t tracks;
+      size_t stream;
+    };
+
+    QuantizationSize translation_quantization;
+    QuantizationSize rotation_quantization;
+    QuantizationSize scale_quantization;
+
+    // Number of keyframes tangents, 0 for linearly interpolated keyframes.
+    size_t translation_tangents;
+    size_t rotation_tangents;
+    size_t scale_tangents;
   };
   void Allocate(const AllocateParams& _params);
   void Deallocate();
@@ -209,11 +383,26 @@ class OZZ_ANIMATION_DLL Animation {
   span<internal::Float3Key> translations_values_;
   span<internal::QuaternionKey> rotations_values_;
   span<internal::Float3Key> scales_values_;
+
+  // Constant SoA tracks.
+  Constants translations_constants_;
+  Constants rotations_constants_;
+  Constants scales_constants_;
+
+  // Variable bit-rate keyframes.
+  Float3Quantization translations_quantization_;
+  QuaternionQuantization rotations_quantization_;
+  Float3Quantization scales_quantization_;
+
+  // Keyframes tangents, for cubic Hermite splines interpolation.
+  span<internal::Float3Key> translations_tangents_;
+  span<internal::Float4Key> rotations_tangents_;
+  span<internal::Float3Key> scales_tangents_;
 };
 }  // namespace animation
 
 namespace io {
-OZZ_IO_TYPE_VERSION(7, animation::Animation)
+OZZ_IO_TYPE_VERSION(10, animation::Animation)
 OZZ_IO_TYPE_TAG("ozz-animation", animation::Animation)
 }  // namespace io
 }  // namespace ozz
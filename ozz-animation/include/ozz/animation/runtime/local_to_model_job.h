@@ -40,6 +40,7 @@ struct SoaTransform;
 }
 namespace math {
 struct Float4x4;
+struct Float3x4;
 }
 
 namespace animation {
@@ -56,6 +57,13 @@ class Skeleton;
 // ordered like skeleton's joints. Output are matrices, because the combination
 // of affine transformations can contain shearing or complex transformation
 // that cannot be represented as Transform object.
+// Output can alternatively be affine Float3x4 matrices, which are 25% smaller
+// and faster to compute.
+// Breadth-first skeletons (see Skeleton::Ordering) are faster to process, as
+// consecutive joints rarely depend on each other.
+// An optional dirty bitset restricts the update to the joints that changed
+// since the previous run, and their descendants. An optional joint mask
+// restricts the update to the joints the application needs.
 struct OZZ_ANIMATION_DLL LocalToModelJob {
   // Default constructor, initializes default values.
   LocalToModelJob();
@@ -66,6 +74,8 @@ struct OZZ_ANIMATION_DLL LocalToModelJob {
   // Note that this input has a SoA format.
   // -if the size of of the output is smaller than the skeleton's number of
   // joints.
+  // -if both output and output3x4 are provided.
+  // -if dirty or joint_mask aren't empty and are too small.
   bool Validate() const;
 
   // Runs job's local-to-model task.
@@ -111,10 +121,35 @@ struct OZZ_ANIMATION_DLL LocalToModelJob {
   // The input range that store local transforms.
   span<const ozz::math::SoaTransform> input;
 
+  // Optional per joint dirty bitset, one bit per joint, 8 joints per byte
+  // starting from the least significant bit (see SetJointBit). If not empty,
+  // only dirty joints and their descendants are updated. Other joints output
+  // matrices are left unchanged, as computed by a previous run.
+  // Bits are set by SamplingJob::dirty, and by the application for the joints
+  // it modifies (IK, procedural...). As BlendingJob output only changes where
+  // its layers change, layers sampling jobs can share the same bitset, as long
+  // as layers weights are unchanged. All bits must be set when output matrices
+  // or root matrix aren't up to date.
+  // Descendants of dirty joints are flagged during job execution, so that the
+  // bitset finally tells which output matrices were updated. Clearing it before
+  // the next update is the application responsibility.
+  span<byte> dirty;
+
+  // Optional per joint mask, using the same bitset layout as dirty. If not
+  // empty, only joints whose bit is set are updated, others output matrices
+  // are left unchanged. This allows to skip joints no mesh or attachment uses.
+  // The mask must include all the ancestors of the joints it contains (see
+  // SetAncestorBits).
+  span<const byte> joint_mask;
+
   // Job output.
 
   // The output range to be filled with model-space matrices.
   span<ozz::math::Float4x4> output;
+
+  // Alternative output range to be filled with model-space affine matrices.
+  // If not empty, it's used instead of output, which must then be empty.
+  span<ozz::math::Float3x4> output3x4;
 };
 }  // namespace animation
 }  // namespace ozz
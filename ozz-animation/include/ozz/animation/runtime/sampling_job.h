@@ -60,6 +60,7 @@ struct OZZ_ANIMATION_DLL SamplingJob {
   // Validates job parameters. Returns true for a valid job, or false otherwise:
   // -if any input pointer is nullptr
   // -if output range is invalid.
+  // -if track_mask, rest_pose or dirty are not empty and are too small.
   bool Validate() const;
 
   // Runs job's sampling task.
@@ -91,12 +92,36 @@ struct OZZ_ANIMATION_DLL SamplingJob {
   // If there are more joints in the animation, then the last joints are not
   // sampled.
   span<ozz::math::SoaTransform> output;
+
+  // Optional per SoA track mask, used to reduce sampling cost (animation LOD).
+  // It stores one bit per SoA track (aka 4 joints), 8 SoA tracks per byte
+  // starting from the least significant bit. SoA tracks whose bit is cleared
+  // are neither decompressed nor interpolated, and are output from rest_pose
+  // instead. Keyframe cache is still updated for all tracks, so the context
+  // remains valid whenever the mask changes.
+  // An empty mask (default) samples all tracks.
+  span<const byte> track_mask;
+
+  // Optional rest pose, usually Skeleton::joint_rest_poses(), used to output
+  // the SoA tracks masked out by track_mask. Masked out tracks are left
+  // unchanged if rest_pose is empty.
+  span<const ozz::math::SoaTransform> rest_pose;
+
+  // Optional per joint dirty bitset (see LocalToModelJob::dirty), one bit per
+  // joint. Bits of the joints whose output transform changed are set, other
+  // bits are left unchanged, so the bitset can be shared by multiple jobs.
+  // Changes are detected by comparing new and previous output values, so a
+  // paused animation or constant tracks don't flag any joint. Size must be at
+  // least (num_soa_tracks * 4 + 7) / 8 bytes.
+  span<byte> dirty;
 };
 
 namespace internal {
 // Soa hot data to interpolate.
 struct InterpSoaFloat3;
 struct InterpSoaQuaternion;
+struct TangentSoaFloat3;
+struct TangentSoaQuaternion;
 }  // namespace internal
 
 // Declares the context object used by the workload to take advantage of the
@@ -143,6 +168,11 @@ class OZZ_ANIMATION_DLL SamplingJob::Context {
     // ratio.
     span<uint32_t> entries;
 
+    // Index of the keys pointed by entries, within their own track. Only
+    // maintained for variable bit-rate animations, whose keyframe values are
+    // stored per track.
+    span<uint32_t> locals;
+
     // Outdated soa entries. One bit per soa entry (32 joints per byte).
     span<byte> outdated;
 
@@ -159,6 +189,10 @@ class OZZ_ANIMATION_DLL SamplingJob::Context {
   // Return previous ratio.
   float Step(const Animation& _animation, float _ratio);
 
+  // Allocates tangents buffers, the first time an animation interpolated with
+  // cubic Hermite splines is sampled.
+  void AllocateTangents();
+
   // The animation this context refers to. nullptr means that the context is
   // invalid.
   const Animation* animation_;
@@ -178,6 +212,16 @@ class OZZ_ANIMATION_DLL SamplingJob::Context {
   span<internal::InterpSoaFloat3> translations_;
   span<internal::InterpSoaQuaternion> rotations_;
   span<internal::InterpSoaFloat3> scales_;
+
+  // SoA decompressed keyframes tangents, only used by animations interpolated
+  // with cubic Hermite splines. Empty until such an animation is sampled.
+  span<internal::TangentSoaFloat3> translations_tangents_;
+  span<internal::TangentSoaQuaternion> rotations_tangents_;
+  span<internal::TangentSoaFloat3> scales_tangents_;
+
+  // SamplingJob::track_mask compacted to the keyed (non constant) SoA tracks
+  // of the transformation type being sampled.
+  span<byte> keyed_mask_;
 };
 }  // namespace animation
 }  // namespace ozz
@@ -55,9 +55,9 @@ class SkeletonBuilder;
 // arrays of data (as opposed to joint structures for the RawSkeleton), in order
 // to closely match with the way runtime algorithms use them. Joint hierarchy is
 // packed as an array of parent jont indices (16 bits), stored in depth-first
-// order. This is enough to traverse the whole joint hierarchy. See
-// IterateJointsDF() from skeleton_utils.h that implements a depth-first
-// traversal utility.
+// order by default, or breadth-first (see Ordering). This is enough to traverse
+// the whole joint hierarchy. See IterateJointsDF() from skeleton_utils.h that
+// implements a traversal utility.
 class OZZ_ANIMATION_DLL Skeleton {
  public:
   // Defines Skeleton constant values.
@@ -79,6 +79,19 @@ class OZZ_ANIMATION_DLL Skeleton {
     kNoParent = -1,
   };
 
+  // Defines the order joints are stored in. In both orders, parents are stored
+  // before their children.
+  enum Ordering {
+    // Every joint hierarchy is a contiguous range of joints, starting with its
+    // root. This is the default.
+    kDepthFirst,
+
+    // Joints are sorted by depth, siblings being stored next to each other.
+    // Consecutive joints rarely depend on each other, which breaks
+    // LocalToModelJob dependency chain from a joint to the next.
+    kBreadthFirst,
+  };
+
   // Builds a default skeleton.
   Skeleton();
 
@@ -100,6 +113,9 @@ class OZZ_ANIMATION_DLL Skeleton {
   // skeleton. This value is useful to allocate SoA runtime data structures.
   int num_soa_joints() const { return (num_joints() + 3) / 4; }
 
+  // Returns the order joints are stored in.
+  Ordering ordering() const { return ordering_; }
+
   // Returns joint's rest poses. Rest poses are stored in soa format.
   span<const math::SoaTransform> joint_rest_poses() const {
     return joint_rest_poses_;
@@ -127,8 +143,11 @@ class OZZ_ANIMATION_DLL Skeleton {
   // SkeletonBuilder class is allowed to instantiate an Skeleton.
   friend class offline::SkeletonBuilder;
 
-  // Buffers below store joint informations in joing depth first order. Their
-  // size is equal to the number of joints of the skeleton.
+  // Order of the joints stored in the buffers below.
+  Ordering ordering_;
+
+  // Buffers below store joint informations in ordering_ order. Their size is
+  // equal to the number of joints of the skeleton.
 
   // Rest pose of every joint in local space.
   span<math::SoaTransform> joint_rest_poses_;
@@ -142,7 +161,7 @@ class OZZ_ANIMATION_DLL Skeleton {
 }  // namespace animation
 
 namespace io {
-OZZ_IO_TYPE_VERSION(2, animation::Skeleton)
+OZZ_IO_TYPE_VERSION(3, animation::Skeleton)
 OZZ_IO_TYPE_TAG("ozz-skeleton", animation::Skeleton)
 }  // namespace io
 }  // namespace ozz
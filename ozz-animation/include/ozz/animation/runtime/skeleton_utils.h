@@ -28,6 +28,7 @@
 #ifndef OZZ_OZZ_ANIMATION_RUNTIME_SKELETON_UTILS_H_
 #define OZZ_OZZ_ANIMATION_RUNTIME_SKELETON_UTILS_H_
 
+#include <algorithm>
 #include <cassert>
 
 #include "ozz/animation/runtime/export.h"
@@ -42,20 +43,52 @@ OZZ_ANIMATION_DLL ozz::math::Transform GetJointLocalRestPose(
     const Skeleton& _skeleton, int _joint);
 
 // Test if a joint is a leaf. _joint number must be in range [0, num joints].
-// "_joint" is a leaf if it's the last joint, or next joint's parent isn't
-// "_joint".
+// For depth-first skeletons, "_joint" is a leaf if it's the last joint, or next
+// joint's parent isn't "_joint". Breadth-first skeletons parents are sorted, so
+// children are searched with a binary search.
 inline bool IsLeaf(const Skeleton& _skeleton, int _joint) {
   const int num_joints = _skeleton.num_joints();
   assert(_joint >= 0 && _joint < num_joints && "_joint index out of range");
   const span<const int16_t>& parents = _skeleton.joint_parents();
   const int next = _joint + 1;
+  if (_skeleton.ordering() == Skeleton::kBreadthFirst) {
+    const int16_t* child = std::lower_bound(parents.begin() + next,
+                                            parents.end(), _joint);
+    return child == parents.end() || *child != _joint;
+  }
   return next == num_joints || parents[next] != _joint;
 }
 
 // Finds joint index by name. Uses a case sensitive comparison.
 OZZ_ANIMATION_DLL int FindJoint(const Skeleton& _skeleton, const char* _name);
 
-// Applies a specified functor to each joint in a depth-first order.
+// Per joint bitsets (see LocalToModelJob::dirty) store one bit per joint, 8
+// joints per byte starting from the least significant bit. They must be at
+// least (num_joints + 7) / 8 bytes.
+
+// Sets _joint bit of bitset _bits.
+inline void SetJointBit(const span<byte>& _bits, int _joint) {
+  assert(_joint >= 0 && _joint / 8 < static_cast<int>(_bits.size()) &&
+         "_joint index out of range");
+  _bits[_joint / 8] |= static_cast<byte>(1 << (_joint & 7));
+}
+
+// Tests _joint bit of bitset _bits.
+inline bool TestJointBit(const span<const byte>& _bits, int _joint) {
+  assert(_joint >= 0 && _joint / 8 < static_cast<int>(_bits.size()) &&
+         "_joint index out of range");
+  return (_bits[_joint / 8] & (1 << (_joint & 7))) != 0;
+}
+
+// Sets bits of all the ancestors of the joints set in bitset _bits. The result
+// is the set of joints needed to compute model-space matrices of the initial
+// joints, which can be used as LocalToModelJob::joint_mask.
+OZZ_ANIMATION_DLL void SetAncestorBits(const Skeleton& _skeleton,
+                                       const span<byte>& _bits);
+
+// Applies a specified functor to each joint in a depth-first order, or in
+// skeleton order for breadth-first skeletons. In both cases parents are visited
+// before their children.
 // _Fct is of type void(int _current, int _parent) where the first argument
 // is the child of the second argument. _parent is kNoParent if the _current
 // joint is a root. _from indicates the joint from which the joint hierarchy
@@ -66,7 +99,23 @@ inline _Fct IterateJointsDF(const Skeleton& _skeleton, _Fct _fct,
                             int _from = Skeleton::kNoParent) {
   const span<const int16_t>& parents = _skeleton.joint_parents();
   const int num_joints = _skeleton.num_joints();
-  //
+
+  // Breadth-first skeletons parents are sorted, so children of a range of
+  // joints are a range of joints too. Iterates one range per depth level.
+  if (_skeleton.ordering() == Skeleton::kBreadthFirst && _from >= 0) {
+    for (int begin = _from, end = _from + 1; begin < end;) {
+      for (int i = begin; i < end; ++i) {
+        _fct(i, parents[i]);
+      }
+      const int16_t* children = parents.begin() + end;
+      begin = static_cast<int>(
+          std::lower_bound(children, parents.end(), begin) - parents.begin());
+      end = static_cast<int>(
+          std::lower_bound(children, parents.end(), end) - parents.begin());
+    }
+    return _fct;
+  }
+
   // parents[i] >= _from is true as long as "i" is a child of "_from".
   static_assert(Skeleton::kNoParent < 0,
                 "Algorithm relies on kNoParent being negative");
@@ -78,9 +127,9 @@ inline _Fct IterateJointsDF(const Skeleton& _skeleton, _Fct _fct,
 }
 
 // Applies a specified functor to each joint in a reverse (from leaves to root)
-// depth-first order. _Fct is of type void(int _current, int _parent) where the
-// first argument is the child of the second argument. _parent is kNoParent if
-// the _current joint is a root.
+// skeleton order, so children are visited before their parent. _Fct is of
+// type void(int _current, int _parent) where the first argument is the child of
+// the second argument. _parent is kNoParent if the _current joint is a root.
 template <typename _Fct>
 inline _Fct IterateJointsDFReverse(const Skeleton& _skeleton, _Fct _fct) {
   const span<const int16_t>& parents = _skeleton.joint_parents();
@@ -46,6 +46,13 @@
 #define OZZ_SIMD_FMA
 #endif
 
+// F16C provides hardware half <-> float conversions.
+#if defined(__F16C__) || defined(OZZ_SIMD_F16C)
+#include <immintrin.h>
+#define OZZ_SIMD_F16C
+#define OZZ_SIMD_AVX  // avx is available if f16c is.
+#endif
+
 #if defined(__AVX__) || defined(OZZ_SIMD_AVX)
 #include <immintrin.h>
 #define OZZ_SIMD_AVX
@@ -2030,6 +2030,17 @@ OZZ_INLINE float HalfToFloat(uint16_t _h) {
   return _mm_cvtss_f32(HalfToFloat(_mm_set1_epi32(_h)));
 }
 
+#ifdef OZZ_SIMD_F16C
+// Half <-> Float conversions use F16C hardware instructions. Half values are
+// stored in the 16 lower bits of each integer component.
+OZZ_INLINE SimdInt4 FloatToHalf(_SimdFloat4 _f) {
+  return _mm_cvtepu16_epi32(_mm_cvtps_ph(_f, _MM_FROUND_TO_NEAREST_INT));
+}
+
+OZZ_INLINE SimdFloat4 HalfToFloat(_SimdInt4 _h) {
+  return _mm_cvtph_ps(_mm_packus_epi32(_h, _h));
+}
+#else  // OZZ_SIMD_F16C
 // Half <-> Float implementation is based on:
 // http://fgiesen.wordpress.com/2012/03/28/half-to-float-done-quic/.
 inline SimdInt4 FloatToHalf(_SimdFloat4 _f) {
@@ -2081,6 +2092,7 @@ OZZ_INLINE SimdFloat4 HalfToFloat(_SimdInt4 _h) {
   const __m128 sign_inf = _mm_or_ps(_mm_castsi128_ps(sign), infnanexp);
   return _mm_or_ps(scaled, sign_inf);
 }
+#endif  // OZZ_SIMD_F16C
 }  // namespace math
 }  // namespace ozz
 
@@ -0,0 +1,179 @@
+//----------------------------------------------------------------------------//
+//                                                                            //
+// ozz-animation is hosted at http://github.com/guillaumeblanc/ozz-animation  //
+// and distributed under the MIT License (MIT).                               //
+//                                                                            //
+// Copyright (c) Guillaume Blanc                                              //
+//                                                                            //
+// Permission is hereby granted, free of charge, to any person obtaining a    //
+// copy of this software and associated documentation files (the "Software"), //
+// to deal in the Software without restriction, including without limitation  //
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,   //
+// and/or sell copies of the Software, and to permit persons to whom the      //
+// Software is furnished to do so, subject to the following conditions:       //
+//                                                                            //
+// The above copyright notice and this permission notice shall be included in //
+// all copies or substantial portions of the Software.                        //
+//                                                                            //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR //
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   //
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    //
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER //
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING    //
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER        //
+// DEALINGS IN THE SOFTWARE.                                                  //
+//                                                                            //
+//----------------------------------------------------------------------------//
+
+
+#ifndef OZZ_OZZ_BASE_MATHS_SIMD_FLOAT3X4_H_
+#define OZZ_OZZ_BASE_MATHS_SIMD_FLOAT3X4_H_
+
+#include "ozz/base/maths/simd_math.h"
+
+#include <cassert>
+
+// Implement affine 3x4 matrix.
+namespace ozz {
+namespace math {
+// Declare the 3x4 affine matrix type. It stores the 3 first rows of a Float4x4
+// whose last row is implicitly (0, 0, 0, 1):
+// [ m.rows[0].x m.rows[0].y m.rows[0].z m.rows[0].w ]   {v.x}
+// | m.rows[1].x m.rows[1].y m.rows[1].z m.rows[1].w | * {v.y}
+// | m.rows[2].x m.rows[2].y m.rows[2].z m.rows[2].w |   {v.z}
+// [ 0           0           0           1           ]   {v.1}
+// This is 25% less memory (and bandwidth) than a Float4x4, for matrices that
+// are affine by construction, like joint model-space or skinning matrices.
+// Translation is stored in the w component of each row, which is also the
+// layout expected by most GPU skinning shaders.
+struct Float3x4 {
+  // Matrix rows.
+  SimdFloat4 rows[3];
+
+  // Returns the identity matrix.
+  static OZZ_INLINE Float3x4 identity() {
+    const Float3x4 ret = {
+        {simd_float4::x_axis(), simd_float4::y_axis(), simd_float4::z_axis()}};
+    return ret;
+  }
+
+  // Returns the affine matrix built from the 3 first rows of _m. _m last row is
+  // expected to be (0, 0, 0, 1), it's ignored.
+  static OZZ_INLINE Float3x4 FromFloat4x4(const Float4x4& _m) {
+    Float3x4 ret;
+    Transpose4x3(_m.cols, ret.rows);
+    return ret;
+  }
+};
+
+// Returns the Float4x4 equivalent of _m, with (0, 0, 0, 1) as last row.
+OZZ_INLINE Float4x4 ToFloat4x4(const Float3x4& _m) {
+  Float4x4 ret;
+  Transpose3x4(_m.rows, ret.cols);
+  ret.cols[3] = ret.cols[3] + simd_float4::w_axis();
+  return ret;
+}
+
+// Returns the transpose of _m, including its implicit last row. As a Float4x4
+// is column major, the transposed matrix columns are _m rows.
+OZZ_INLINE Float4x4 Transpose(const Float3x4& _m) {
+  const Float4x4 ret = {
+      {_m.rows[0], _m.rows[1], _m.rows[2], simd_float4::w_axis()}};
+  return ret;
+}
+
+// Returns the inverse of affine matrix _m.
+// If _invertible is not nullptr, its x component will be set to true if matrix
+// is invertible. If _invertible is nullptr, then an assert is triggered in case
+// the matrix isn't invertible.
+OZZ_INLINE Float3x4 Invert(const Float3x4& _m,
+                           SimdInt4* _invertible = nullptr) {
+  // Inverse of the upper 3x3 matrix columns are the cross products of its rows,
+  // divided by the determinant.
+  const SimdFloat4 c0 = Cross3(_m.rows[1], _m.rows[2]);
+  const SimdFloat4 c1 = Cross3(_m.rows[2], _m.rows[0]);
+  const SimdFloat4 c2 = Cross3(_m.rows[0], _m.rows[1]);
+  const SimdFloat4 det = SplatX(Dot3(_m.rows[0], c0));
+  const SimdInt4 invertible = CmpNe(det, simd_float4::zero());
+  assert((_invertible || AreAllTrue1(invertible)) &&
+         "Matrix is not invertible");
+  if (_invertible != nullptr) {
+    *_invertible = invertible;
+  }
+  const SimdFloat4 rcp = simd_float4::one() / det;
+  SimdFloat4 cols[4] = {c0 * rcp, c1 * rcp, c2 * rcp};
+
+  // Inverse translation is the opposite translation rotated by the inverse
+  // upper 3x3 matrix.
+  const SimdFloat4 zzzz = SplatW(_m.rows[2]) * cols[2];
+  const SimdFloat4 a12 = MAdd(SplatW(_m.rows[1]), cols[1], zzzz);
+  cols[3] = -MAdd(SplatW(_m.rows[0]), cols[0], a12);
+
+  Float3x4 ret;
+  Transpose4x3(cols, ret.rows);
+  return ret;
+}
+
+// Multiply each row of matrix _m with vector _v.
+OZZ_INLINE Float3x4 RowMultiply(const Float3x4& _m, _SimdFloat4 _v) {
+  const Float3x4 ret = {
+      {_m.rows[0] * _v, _m.rows[1] * _v, _m.rows[2] * _v}};
+  return ret;
+}
+
+// Computes the transformation of a Float3x4 matrix and a point _p.
+// This is equivalent to multiplying a matrix by a SimdFloat4 with a w component
+// of 1. w component of the result is 0.
+OZZ_INLINE SimdFloat4 TransformPoint(const Float3x4& _m, _SimdFloat4 _p) {
+  SimdFloat4 cols[4];
+  Transpose3x4(_m.rows, cols);
+  const SimdFloat4 xxxx = SplatX(_p) * cols[0];
+  const SimdFloat4 a23 = MAdd(SplatZ(_p), cols[2], cols[3]);
+  const SimdFloat4 a01 = MAdd(SplatY(_p), cols[1], xxxx);
+  return a01 + a23;
+}
+
+// Computes the transformation of a Float3x4 matrix and a vector _v.
+// This is equivalent to multiplying a matrix by a SimdFloat4 with a w component
+// of 0. w component of the result is 0.
+OZZ_INLINE SimdFloat4 TransformVector(const Float3x4& _m, _SimdFloat4 _v) {
+  SimdFloat4 cols[4];
+  Transpose3x4(_m.rows, cols);
+  const SimdFloat4 xxxx = SplatX(_v) * cols[0];
+  const SimdFloat4 yyyy = SplatY(_v) * cols[1];
+  const SimdFloat4 a02 = MAdd(SplatZ(_v), cols[2], xxxx);
+  return yyyy + a02;
+}
+
+// Computes the multiplication of two affine matrices _a and _b.
+// As last rows are (0, 0, 0, 1), each row of the result is a combination of _b
+// rows, plus _a translation.
+OZZ_INLINE Float3x4 operator*(const Float3x4& _a, const Float3x4& _b) {
+  const SimdInt4 mask_w = simd_int4::mask_000f();
+  Float3x4 ret;
+  for (int i = 0; i < 3; ++i) {
+    const SimdFloat4 row = _a.rows[i];
+    const SimdFloat4 zzzz = MAdd(SplatZ(row), _b.rows[2], And(row, mask_w));
+    const SimdFloat4 xxxx = SplatX(row) * _b.rows[0];
+    const SimdFloat4 a01 = MAdd(SplatY(row), _b.rows[1], xxxx);
+    ret.rows[i] = a01 + zzzz;
+  }
+  return ret;
+}
+
+// Computes the per element addition of two matrices _a and _b.
+OZZ_INLINE Float3x4 operator+(const Float3x4& _a, const Float3x4& _b) {
+  const Float3x4 ret = {{_a.rows[0] + _b.rows[0], _a.rows[1] + _b.rows[1],
+                         _a.rows[2] + _b.rows[2]}};
+  return ret;
+}
+
+// Computes the per element subtraction of two matrices _a and _b.
+OZZ_INLINE Float3x4 operator-(const Float3x4& _a, const Float3x4& _b) {
+  const Float3x4 ret = {{_a.rows[0] - _b.rows[0], _a.rows[1] - _b.rows[1],
+                         _a.rows[2] - _b.rows[2]}};
+  return ret;
+}
+}  // namespace math
+}  // namespace ozz
+#endif  // OZZ_OZZ_BASE_MATHS_SIMD_FLOAT3X4_H_
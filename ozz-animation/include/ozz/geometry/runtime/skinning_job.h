@@ -35,6 +35,7 @@
 namespace ozz {
 namespace math {
 struct Float4x4;
+struct Float3x4;
 }
 namespace geometry {
 
@@ -72,6 +73,8 @@ namespace geometry {
 // joints matrices (see http://www.glprogramming.com/red/appendixf.html). This
 // code path is less efficient than the one without this matrices set, and
 // should only be used when input matrices have non uniform scaling or shearing.
+// Joint matrices can alternatively be provided as affine Float3x4 matrices,
+// which reduces palette memory and bandwidth by 25%.
 // The job does not owned the buffers (in/output) and will thus not delete them
 // during job's destruction.
 struct OZZ_GEOMETRY_DLL SkinningJob {
@@ -81,6 +84,8 @@ struct OZZ_GEOMETRY_DLL SkinningJob {
   // Validates job parameters.
   // Returns true for a valid job, false otherwise:
   // - if any range is invalid. See each range description.
+  // - if both Float4x4 and Float3x4 joint matrices are provided, or if inverse
+  // transpose matrices type doesn't match joint matrices one.
   // - if normals are provided but positions aren't.
   // - if tangents are provided but normals aren't.
   // - if no output is provided while an input is. For example, if input normals
@@ -121,6 +126,12 @@ struct OZZ_GEOMETRY_DLL SkinningJob {
   // fall into a more costly code path in the skinning algorithm.
   span<const math::Float4x4> joint_inverse_transpose_matrices;
 
+  // Affine alternatives to joint_matrices and joint_inverse_transpose_matrices.
+  // If joint_matrices3x4 isn't empty, it's used instead of joint_matrices,
+  // which must then be empty. Float4x4 and Float3x4 arrays can't be mixed.
+  span<const math::Float3x4> joint_matrices3x4;
+  span<const math::Float3x4> joint_inverse_transpose_matrices3x4;
+
   // Array of joints indices. This array is used to indexes matrices in joints
   // array.
   // Each vertex has influences_max number of indices, meaning that the size of
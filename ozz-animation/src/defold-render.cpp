@@ -13,6 +13,7 @@
 #include "ozz/base/span.h"
 #include "ozz/base/containers/vector.h"
 #include "ozz/base/containers/vector_archive.h"
+#include "ozz/base/maths/simd_float3x4.h"
 #include "ozz/base/maths/simd_math.h"
 #include "ozz/base/maths/math_ex.h"
 #include "ozz/base/maths/soa_transform.h"
@@ -24,7 +25,7 @@
 using namespace ozz;
 using namespace game;
 
-bool DrawDefoldSkinnedMesh(const game::Mesh &_mesh, const span<math::Float4x4> _skinning_matrices, const ozz::math::Float4x4 &_transform)
+bool DrawDefoldSkinnedMesh(const game::Mesh &_mesh, const span<math::Float3x4> _skinning_matrices, const ozz::math::Float4x4 &_transform)
 {
     const int vertex_count = _mesh.vertex_count();
 
@@ -72,7 +73,7 @@ bool DrawDefoldSkinnedMesh(const game::Mesh &_mesh, const span<math::Float4x4> _
 
         // Setup skinning matrices, that came from the animation stage before being
         // multiplied by inverse model-space bind-pose.
-        skinning_job.joint_matrices = _skinning_matrices;
+        skinning_job.joint_matrices3x4 = _skinning_matrices;
 
         // Setup joint's indices.
         skinning_job.joint_indices = make_span(part.joint_indices);
@@ -0,0 +1,72 @@
+
+#include <cassert>
+
+#include "ozz/animation/offline/additive_animation_builder.h"
+#include "ozz/animation/offline/animation_builder.h"
+#include "ozz/animation/offline/animation_optimizer.h"
+#include "ozz/animation/offline/raw_animation.h"
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/skeleton_utils.h"
+#include "ozz/base/containers/vector.h"
+#include "ozz/base/log.h"
+#include "ozz/base/maths/transform.h"
+
+#include "blend/additive.h"
+#include "lod/lod.h"
+
+namespace game {
+
+bool BuildAdditiveAnimation(const ozz::animation::Animation& _animation,
+                            const ozz::animation::Skeleton& _skeleton,
+                            AdditiveReference _reference, float _sample_rate,
+                            ozz::animation::Animation* _additive) {
+  assert(_additive);
+  if (_animation.num_tracks() != _skeleton.num_joints()) {
+    ozz::log::Err() << "Animation doesn't match skeleton." << std::endl;
+    return false;
+  }
+
+  ozz::animation::offline::RawAnimation raw_animation;
+  if (!ResampleAnimation(_animation, ozz::span<const int16_t>(), _sample_rate,
+                         &raw_animation)) {
+    return false;
+  }
+
+  // Subtracts the reference pose.
+  ozz::animation::offline::AdditiveAnimationBuilder additive_builder;
+  ozz::animation::offline::RawAnimation raw_additive;
+  bool built = false;
+  if (_reference == kRestPoseReference) {
+    ozz::vector<ozz::math::Transform> rest_pose(_skeleton.num_joints());
+    for (int i = 0; i < _skeleton.num_joints(); ++i) {
+      rest_pose[i] = ozz::animation::GetJointLocalRestPose(_skeleton, i);
+    }
+    built = additive_builder(raw_animation, make_span(rest_pose),
+                             &raw_additive);
+  } else {
+    built = additive_builder(raw_animation, &raw_additive);
+  }
+  if (!built) {
+    ozz::log::Err() << "Failed to build additive animation." << std::endl;
+    return false;
+  }
+
+  // Removes redundant keys, then builds the runtime animation.
+  ozz::animation::offline::RawAnimation optimized_animation;
+  ozz::animation::offline::AnimationOptimizer optimizer;
+  if (!optimizer(raw_additive, _skeleton, &optimized_animation)) {
+    ozz::log::Err() << "Failed to optimize additive animation." << std::endl;
+    return false;
+  }
+  ozz::animation::offline::AnimationBuilder builder;
+  ozz::unique_ptr<ozz::animation::Animation> animation =
+      builder(optimized_animation);
+  if (!animation) {
+    ozz::log::Err() << "Failed to build additive animation." << std::endl;
+    return false;
+  }
+  *_additive = std::move(*animation);
+  return true;
+}
+}  // namespace game
@@ -5,24 +5,35 @@
 
 // include the Defold SDK
 #include <dmsdk/sdk.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 
 #include "mesh/mesh.h"
 #include "controller/controller.h"
+#include "lod/lod.h"
+#include "blend/additive.h"
+#include "blend/blend_tree.h"
+#include "blend/mirror.h"
 
 #include "ozz/animation/runtime/animation.h"
 #include "ozz/animation/runtime/local_to_model_job.h"
 #include "ozz/animation/runtime/sampling_job.h"
 #include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/skeleton_utils.h"
+#include "ozz/animation/runtime/track.h"
 #include "ozz/base/io/archive.h"
 #include "ozz/base/io/stream.h"
 #include "ozz/base/log.h"
 #include "ozz/base/span.h"
 #include "ozz/base/containers/vector.h"
 #include "ozz/base/containers/vector_archive.h"
+#include "ozz/base/maths/simd_float3x4.h"
 #include "ozz/base/maths/simd_math.h"
 #include "ozz/base/maths/math_ex.h"
+#include "ozz/base/maths/soa_float4x4.h"
 #include "ozz/base/maths/soa_transform.h"
 #include "ozz/base/maths/vec_float.h"
 #include "ozz/base/maths/box.h"
@@ -31,8 +42,70 @@
 
 // --------------------------------------------------------------------------------------------------------
 // TODO: 
-//    Make this more of a reference container so meshes, animations and skeletons
-//    are only loaded once rather than for each instance.
+//    Make this more of a reference container so meshes and animations are only
+//    loaded once rather than for each instance, as skeletons, levels of detail
+//    and blend tree clips already are.
+
+// Reduced skeleton level of detail and its resampled animation, built once per joint budget and
+// animation file, and shared by the instances using them (see AddLod).
+typedef struct skeletonLodObj
+{
+    int                                     max_joints;
+    std::string                             animation_filename;
+
+    game::SkeletonLod                       skeleton;
+    ozz::animation::Animation               animation;
+} _skeletonLodObj;
+
+// Blend tree clip animation, loaded once per file and additive conversion, and shared by the blend trees
+// of all instances of a skeleton (see AddClip).
+typedef struct clipObj
+{
+    std::string                             filename;
+    bool                                    additive;
+    game::AdditiveReference                 reference;
+    float                                   sample_rate;
+
+    ozz::animation::Animation               animation;
+} _clipObj;
+
+// Skeletons are shared by all instances loaded from the same file, so that crowds walk a single joint
+// hierarchy (parents and rest poses stay in cache) instead of one copy per instance.
+typedef struct skeletonObj
+{
+    std::string                             filename;
+    ozz::animation::Skeleton                skeleton;
+
+    // Named joint masks, see AddJointMask. Built once and shared by the blend trees of all instances.
+    std::vector<std::string>                mask_names;
+    ozz::vector<game::JointMask>            masks;
+
+    // Mirror table, see SetMirror. Empty until set, shared by all instances. Built from the mirror_left and
+    // mirror_right joint names.
+    game::MirrorTable                       mirror;
+    std::string                             mirror_left;
+    std::string                             mirror_right;
+
+    // Levels of detail built so far, see GetSkeletonLod.
+    std::vector<skeletonLodObj *>           lods;
+
+    // Blend tree clips loaded so far, see GetClip.
+    std::vector<clipObj *>                  clips;
+} _skeletonObj;
+
+// Instance level of detail, used from a camera distance (see AddLod). The reduced skeleton and animation
+// are shared, only meshes rebinding and runtime buffers belong to the instance.
+typedef struct lodObj
+{
+    float                                   distance;
+
+    const skeletonLodObj*                   shared;
+    ozz::vector<game::SkinLod>              skins;
+
+    ozz::animation::SamplingJob::Context    context;
+    ozz::vector<ozz::math::SoaTransform>    locals;
+    ozz::vector<ozz::math::Float3x4>        models;
+} _lodObj;
 
 typedef struct animObj
 {
@@ -42,30 +115,368 @@ typedef struct animObj
 
     int                                     num_joints;
 
-    ozz::animation::Skeleton                skeleton;
+    skeletonObj*                            shared;
+    const ozz::animation::Skeleton*         skeleton;
     ozz::animation::Animation               animations;
     ozz::vector<game::Mesh>                 meshes;
 
     game::PlaybackController                controller;    
     ozz::animation::SamplingJob::Context    context;
 
+    // Time ratio locals were last sampled at, so that a paused animation isn't sampled again. Negative
+    // if locals must be sampled, because the track mask changed or a blend tree overwrote them.
+    float                                   sampled_ratio;
+
+    // The animation is sampled mirrored, see SetMirrored.
+    bool                                    mirrored;
+
+    // Blend tree, see SetBlendTree. Replaces the animation once it has nodes.
+    game::BlendTree                         blend_tree;
+
     ozz::vector<ozz::math::SoaTransform>    locals;
+
+    // Per SoA track sampling mask (see SamplingJob::track_mask), built from used_joints and
+    // sampling_joints by UpdateJointMasks. Empty samples every joint.
+    ozz::vector<ozz::byte>                  track_mask;
+
+    // Per joint bitsets (see ozz::animation::SetJointBit). used_joints contains the joints skinned by
+    // meshes or registered as attachments, with their ancestors, others aren't sampled nor converted to
+    // model-space (see LocalToModelJob::joint_mask). sampling_joints contains the joints requested by
+    // SetSamplingMask, with their ancestors. Empty bitsets stand for all joints.
+    ozz::vector<ozz::byte>                  used_joints;
+    ozz::vector<ozz::byte>                  sampling_joints;
+    ozz::vector<int>                        attachments;
+
+    // Levels of detail sorted by distance, and the active one. nullptr uses the full skeleton.
+    std::vector<lodObj *>                   lods;
+    lodObj*                                 lod;
+
+    // Update rate level of detail (see UpdateAnimation). Instance is updated every update_interval
+    // frames, with the time accumulated since its last update.
+    ozz::math::Float3                       position;
+    float                                   radius;
+    int                                     update_interval;
+    float                                   pending_dt;
+
+    // Skinning matrices and vertex buffers are up to date with model-space matrices.
+    bool                                    skinned;
+
+    // Pose interpolation, see SetInterpolation. Skinning matrices are stored decomposed to translation,
+    // rotation and scale, 4 matrices per SoA transform. Palettes of all meshes are concatenated, each
+    // starting on a new SoA transform. palettes[palette] is the latest one, the other one the previous.
+    // update_dt is the time between their updates.
+    bool                                    interpolate;
+    int                                     num_palettes;
+    int                                     palette;
+    ozz::vector<ozz::math::SoaTransform>    palettes[2];
+    float                                   update_dt;
+
+    // Number of frames since the last update, for the frame budget scheduler.
+    int                                     staleness;
+
+    // Visibility, set by SetVisible. Invisible instances, or out of the frustum ones, only advance their
+    // playback time. culled is set while they are, so that they're updated as soon as they're visible.
+    bool                                    visible;
+    bool                                    culled;
+
+    // Stats, see GetStats.
+    int                                     num_used_joints;
+    int                                     num_sampled_joints;
+    int                                     num_updated_joints;
+
+    // Per joint dirty bitset (see LocalToModelJob::dirty), set by sampling and cleared once model-space
+    // matrices are updated, so joints whose local transform didn't change aren't recomputed.
+    ozz::vector<ozz::byte>                  dirty_joints;
     
-    ozz::vector<ozz::math::Float4x4>        models;    
-    ozz::vector<ozz::math::Float4x4>        skinning_matrices;
+    // Model-space and skinning matrices are affine, so they're stored as 3x4
+    // matrices which saves 25% of palette memory and bandwidth.
+    ozz::vector<ozz::math::Float3x4>        models;    
+    ozz::vector<ozz::math::Float3x4>        skinning_matrices;
 } _animObj;
 
 // --------------------------------------------------------------------------------------------------------
     
 static std::vector<animObj *> g_anims;
+static std::vector<skeletonObj *> g_skeletons;
 static uint64_t g_last_time = 0;
 
+// Update rate level of detail. Instances significance is their screen size, approximated as their
+// radius over camera distance. Instances smaller than g_update_sizes[0] are updated every 2nd frame,
+// smaller than g_update_sizes[1] every 4th. Disabled until a camera position is set.
+static bool g_camera_set = false;
+static ozz::math::Float3 g_camera_position = ozz::math::Float3::zero();
+static float g_update_sizes[2] = {.1f, .05f};
+static uint32_t g_frame = 0;
+
+// Frame budget scheduler, see ScheduleAnimations. Disabled while the budget is 0.
+static uint64_t g_budget_us = 0;
+static int g_max_staleness = 4;
+static uint64_t g_budget_used_us = 0;
+static int g_num_scheduled = 0;
+static std::vector<std::pair<float, animObj *> > g_schedule;
+
+// Frustum planes (normal and distance, pointing inward) instances bounding sphere is tested against.
+// Frustum culling is disabled until planes are set.
+static int g_num_frustum_planes = 0;
+static ozz::math::Float4 g_frustum_planes[6];
+
 // --------------------------------------------------------------------------------------------------------
 extern bool LoadSkeleton(const char* _filename, ozz::animation::Skeleton* _skeleton);
 extern bool LoadAnimation(const char* _filename, ozz::animation::Animation* _animation);
+extern bool LoadTrack(const char* _filename, ozz::animation::FloatTrack* _track);
 extern bool LoadMeshes(const char* _filename, ozz::vector<game::Mesh>* _meshes);
 
-extern bool DrawDefoldSkinnedMesh(const game::Mesh &_mesh, const ozz::span<ozz::math::Float4x4> _skinning_matrices, const ozz::math::Float4x4 &_transform);
+// --------------------------------------------------------------------------------------------------------
+// Returns the skeleton loaded from _filename, loading it if no instance uses it yet. Returns nullptr if
+// loading fails.
+
+static skeletonObj *GetSkeleton(const char* _filename)
+{
+    for(size_t i=0; i<g_skeletons.size(); ++i)
+    {
+        if(g_skeletons[i]->filename == _filename) {
+            return g_skeletons[i];
+        }
+    }
+
+    skeletonObj *skel = new skeletonObj();
+    skel->filename = _filename;
+    if (!LoadSkeleton(_filename, &skel->skeleton)) {
+        delete skel;
+        return nullptr;
+    }
+    g_skeletons.push_back(skel);
+    return skel;
+}
+
+// Returns the level of detail of an instance skeleton and animation keeping at most max_joints joints,
+// building it if no instance uses it yet. The animation is resampled at its own rate, so that no key is
+// lost. Returns nullptr if building fails.
+
+static skeletonLodObj *GetSkeletonLod(animObj *anim, int max_joints)
+{
+    std::vector<skeletonLodObj *>& lods = anim->shared->lods;
+    for(size_t i=0; i<lods.size(); ++i)
+    {
+        if(lods[i]->max_joints == max_joints && lods[i]->animation_filename == anim->animation_filename) {
+            return lods[i];
+        }
+    }
+
+    skeletonLodObj *lod = new skeletonLodObj();
+    lod->max_joints = max_joints;
+    lod->animation_filename = anim->animation_filename;
+    if (!game::BuildSkeletonLod(*anim->skeleton, max_joints, &lod->skeleton) ||
+        !game::BuildAnimationLod(anim->animations, lod->skeleton, 0.f, &lod->animation)) {
+        delete lod;
+        return nullptr;
+    }
+    lods.push_back(lod);
+    return lod;
+}
+
+// Returns the blend tree clip loaded from filename for an instance skeleton, loading it if no instance
+// uses it yet. Additive clips are built once per source clip, reference and sample rate (in hertz, 0 to
+// match the source clip), from the shared source clip. Returns nullptr on failure.
+
+static clipObj *GetClip(animObj *anim, const char *filename, bool additive, game::AdditiveReference reference, float sample_rate)
+{
+    std::vector<clipObj *>& clips = anim->shared->clips;
+    for(size_t i=0; i<clips.size(); ++i)
+    {
+        if(clips[i]->filename == filename && clips[i]->additive == additive &&
+           (!additive || (clips[i]->reference == reference && clips[i]->sample_rate == sample_rate))) {
+            return clips[i];
+        }
+    }
+
+    clipObj *clip = new clipObj();
+    clip->filename = filename;
+    clip->additive = additive;
+    clip->reference = reference;
+    clip->sample_rate = sample_rate;
+    if (additive) {
+        const clipObj *source = GetClip(anim, filename, false, reference, 0.f);
+        if (!source || !game::BuildAdditiveAnimation(source->animation, *anim->skeleton, reference, sample_rate, &clip->animation)) {
+            printf("[LoadOzz Error] AddClip: cannot build additive animation: %s.\n", filename);
+            delete clip;
+            return nullptr;
+        }
+    } else {
+        if (!LoadAnimation(filename, &clip->animation)) {
+            printf("[LoadOzz Error] AddClip: cannot load animation: %s.\n", filename);
+            delete clip;
+            return nullptr;
+        }
+        if (clip->animation.num_tracks() != anim->num_joints) {
+            printf("[LoadOzz Error] AddClip: joints and tracks do not match.\n");
+            delete clip;
+            return nullptr;
+        }
+    }
+    clips.push_back(clip);
+    return clip;
+}
+
+// Returns true if joint is both used and part of the sampling mask.
+
+static bool IsJointSampled(animObj *anim, int joint)
+{
+    return (anim->used_joints.empty() || ozz::animation::TestJointBit(make_span(anim->used_joints), joint)) &&
+           (anim->sampling_joints.empty() || ozz::animation::TestJointBit(make_span(anim->sampling_joints), joint));
+}
+
+// Rebuilds used joints and sampling track mask, after meshes, attachments, sampling mask or mirror table
+// changed.
+
+static void UpdateJointMasks(animObj *anim)
+{
+    const int num_joints = anim->num_joints;
+
+    // Without meshes nor attachments, all joints are considered used.
+    anim->used_joints.clear();
+    anim->num_used_joints = num_joints;
+    if (!anim->meshes.empty() || !anim->attachments.empty()) {
+        anim->used_joints.assign((num_joints + 7) / 8, 0);
+        const ozz::span<ozz::byte> used = make_span(anim->used_joints);
+        for (const game::Mesh& mesh : anim->meshes) {
+            for (uint16_t joint : mesh.joint_remaps) {
+                ozz::animation::SetJointBit(used, joint);
+            }
+        }
+        for (int joint : anim->attachments) {
+            ozz::animation::SetJointBit(used, joint);
+        }
+        ozz::animation::SetAncestorBits(*anim->skeleton, used);
+
+        anim->num_used_joints = 0;
+        for (int i = 0; i < num_joints; ++i) {
+            anim->num_used_joints += ozz::animation::TestJointBit(make_span(anim->used_joints), i);
+        }
+    }
+
+    // Packs one bit per SoA track, which is sampled if one of its joints is both used and part of the
+    // sampling mask. Mirrored sampling reads counterparts tracks, so they are sampled too.
+    anim->track_mask.clear();
+    anim->num_sampled_joints = num_joints;
+    if (!anim->used_joints.empty() || !anim->sampling_joints.empty()) {
+        const int num_soa_joints = anim->skeleton->num_soa_joints();
+        anim->track_mask.assign((num_soa_joints + 7) / 8, 0);
+        anim->num_sampled_joints = 0;
+        for (int i = 0; i < num_soa_joints; ++i) {
+            bool soa_sampled = false;
+            for (int j = i * 4; j < ozz::math::Min(i * 4 + 4, num_joints); ++j) {
+                const ozz::vector<int16_t>& counterparts = anim->shared->mirror.joints;
+                soa_sampled |= IsJointSampled(anim, j) || (!counterparts.empty() && IsJointSampled(anim, counterparts[j]));
+            }
+            if (soa_sampled) {
+                anim->track_mask[i / 8] |= 1 << (i & 7);
+                anim->num_sampled_joints += ozz::math::Min(4, num_joints - i * 4);
+            }
+        }
+    }
+
+    // Joints that were skipped so far don't have up to date model-space matrices, nor local transforms.
+    std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0xff);
+    anim->sampled_ratio = -1.f;
+}
+
+// Rebinds instance meshes to _lod skeleton.
+
+static bool BuildLodSkins(animObj *anim, lodObj *lod)
+{
+    lod->skins.resize(anim->meshes.size());
+    for (size_t i = 0; i < anim->meshes.size(); ++i) {
+        if (!game::BuildSkinLod(anim->meshes[i], *anim->skeleton, lod->shared->skeleton, &lod->skins[i])) {
+            printf("[LoadOzz Error] Cannot rebind mesh to level of detail.\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Samples and converts to model-space the active level of detail of an instance.
+
+static bool UpdateLod(animObj *anim)
+{
+    lodObj *lod = anim->lod;
+    const game::SkeletonLod& skeleton = lod->shared->skeleton;
+
+    ozz::animation::SamplingJob sampling_job;
+    sampling_job.animation = &lod->shared->animation;
+    sampling_job.context = &lod->context;
+    sampling_job.ratio = anim->controller.time_ratio();
+    sampling_job.output = make_span(lod->locals);
+    if (!sampling_job.Run()) {
+        return false;
+    }
+
+    ozz::animation::LocalToModelJob ltm_job;
+    ltm_job.skeleton = &skeleton.skeleton;
+    ltm_job.input = make_span(lod->locals);
+    ltm_job.output3x4 = make_span(lod->models);
+    if (!ltm_job.Run()) {
+        return false;
+    }
+
+    anim->num_updated_joints = skeleton.skeleton.num_joints();
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+// Returns true if an instance is visible, and its bounding sphere intersects the frustum.
+
+static bool IsVisible(const animObj *anim)
+{
+    if (!anim->visible) {
+        return false;
+    }
+    for (int i = 0; i < g_num_frustum_planes; ++i) {
+        const ozz::math::Float4& plane = g_frustum_planes[i];
+        const float distance = plane.x * anim->position.x + plane.y * anim->position.y + plane.z * anim->position.z + plane.w;
+        if (distance < -anim->radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Returns an instance significance, its screen size approximated as its radius over camera distance.
+// Returns 1 if no camera is set.
+
+static float GetScreenSize(const animObj *anim)
+{
+    if (!g_camera_set) {
+        return 1.f;
+    }
+    const float distance = ozz::math::Length(anim->position - g_camera_position);
+    return anim->radius / ozz::math::Max(distance, 1e-3f);
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Returns the number of frames between two updates of an instance, according to its significance.
+
+static int GetUpdateInterval(const animObj *anim)
+{
+    if (!g_camera_set) {
+        return 1;
+    }
+    const float size = GetScreenSize(anim);
+    if (size < g_update_sizes[1]) {
+        return 4;
+    }
+    if (size < g_update_sizes[0]) {
+        return 2;
+    }
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+extern bool DrawDefoldSkinnedMesh(const game::Mesh &_mesh, const ozz::span<ozz::math::Float3x4> _skinning_matrices, const ozz::math::Float4x4 &_transform);
 
 // --------------------------------------------------------------------------------------------------------
 
@@ -93,12 +504,16 @@ static int LoadOzz(lua_State* L)
     anim->skeleton_filename = skeleton_filename;
     anim->animation_filename = animation_filename;
 
-    // Reading skeleton.
-    if (!LoadSkeleton(anim->skeleton_filename.c_str(), &anim->skeleton)) {
+    // Reading skeleton, shared with other instances.
+    anim->shared = GetSkeleton(anim->skeleton_filename.c_str());
+    if (!anim->shared) {
         printf("[LoadOzz Error] cannot load skeleton: %s.\n", anim->skeleton_filename.c_str());
         lua_pushnil(L);
         return 1;
     }
+    anim->skeleton = &anim->shared->skeleton;
+    anim->blend_tree.set_joint_masks(&anim->shared->masks);
+    anim->blend_tree.set_mirror_table(&anim->shared->mirror);
 
     // Reading animation
     if (!LoadAnimation(anim->animation_filename.c_str(), &anim->animations)) {
@@ -108,16 +523,37 @@ static int LoadOzz(lua_State* L)
     }
 
     // Allocates runtime buffers.
-    const int num_soa_joints = anim->skeleton.num_soa_joints();
+    const int num_soa_joints = anim->skeleton->num_soa_joints();
     anim->locals.resize(num_soa_joints);
-    anim->num_joints = anim->skeleton.num_joints();
+    anim->num_joints = anim->skeleton->num_joints();
     anim->models.resize(anim->num_joints);
 
+    // All model-space matrices need a first update.
+    anim->dirty_joints.assign((anim->num_joints + 7) / 8, 0xff);
+    anim->num_used_joints = anim->num_joints;
+    anim->num_sampled_joints = anim->num_joints;
+    anim->num_updated_joints = 0;
+    anim->lod = nullptr;
+    anim->position = ozz::math::Float3::zero();
+    anim->radius = 1.f;
+    anim->update_interval = 1;
+    anim->pending_dt = 0.f;
+    anim->skinned = false;
+    anim->visible = true;
+    anim->culled = false;
+    anim->interpolate = false;
+    anim->num_palettes = 0;
+    anim->palette = 0;
+    anim->update_dt = 0.f;
+    anim->staleness = 0;
+    anim->sampled_ratio = -1.f;
+    anim->mirrored = false;
+
     // Allocates a context that matches animation requirements.
     anim->context.Resize(anim->num_joints);
 
     // Skeleton and animation needs to match.
-    if (anim->skeleton.num_joints() != anim->animations.num_tracks()) {
+    if (anim->skeleton->num_joints() != anim->animations.num_tracks()) {
         printf("[LoadOzz Error] joints and tracks do not match.\n");
         lua_pushnil(L);
         return 1;
@@ -125,7 +561,7 @@ static int LoadOzz(lua_State* L)
 
     printf("----------------------------------------\n");
     printf("-- Animation Data --\n");
-    printf("Numjoints: %d\n", anim->skeleton.num_joints());
+    printf("Numjoints: %d\n", anim->skeleton->num_joints());
     printf("NumTracks: %d\n", anim->animations.num_tracks());
     printf("Animations: %d\n", (uint32_t)anim->animations.size());
     
@@ -300,13 +736,25 @@ static int LoadMeshes( lua_State *L)
     // Check the skeleton matches with the mesh, especially that the mesh
     // doesn't expect more joints than the skeleton has.
     for (const game::Mesh& mesh : anim->meshes) {
-      if (anim->num_joints < mesh.highest_joint_index()) {
+      if (anim->num_joints <= mesh.highest_joint_index()) {
         printf("[LoadOzz Error] The provided mesh doesn't match skeleton (joint count mismatch).\n");
         lua_pushnil(L);
         return 1; 
       }
     }
 
+    // Joints no mesh uses aren't updated anymore.
+    UpdateJointMasks(anim);
+    anim->num_palettes = 0;
+
+    // Rebinds meshes to levels of detail.
+    for (lodObj *lod : anim->lods) {
+        if (!BuildLodSkins(anim, lod)) {
+            lua_pushnil(L);
+            return 1;
+        }
+    }
+
     lua_newtable(L);
     int parent = lua_gettop(L);
     int i = 1;
@@ -341,22 +789,152 @@ static int LoadMeshes( lua_State *L)
 
 // --------------------------------------------------------------------------------------------------------
 
-int DrawSkinnedMeshInternal( animObj * anim )
+// Builds skinning matrices of mesh m, based on the output of the animation stage.
+
+static void BuildSkinningMatrices(const animObj *anim, size_t m, ozz::span<ozz::math::Float3x4> _matrices)
 {
-    const ozz::math::Float4x4 transform = ozz::math::Float4x4::identity();
-    
-    // Builds skinning matrices, based on the output of the animation stage.
     // The mesh might not use (aka be skinned by) all skeleton joints. We
     // use the joint remapping table (available from the mesh object) to
     // reorder model-space matrices and build skinning ones.
-    for (const game::Mesh& mesh : anim->meshes) {
+    // Level of detail skins are rebound to the reduced skeleton joints.
+    const game::Mesh& mesh = anim->meshes[m];
+    if (anim->lod) {
+        const game::SkinLod& skin = anim->lod->skins[m];
+        for (size_t i = 0; i < skin.joint_remaps.size(); ++i) {
+            _matrices[i] = anim->lod->models[skin.joint_remaps[i]] * skin.inverse_bind_poses[i];
+        }
+    } else {
         for (size_t i = 0; i < mesh.joint_remaps.size(); ++i) {
-            anim->skinning_matrices[i] = anim->models[mesh.joint_remaps[i]] * mesh.inverse_bind_poses[i];
+            _matrices[i] = anim->models[mesh.joint_remaps[i]] * mesh.inverse_bind_poses[i];
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Decomposes count (at most 4) skinning matrices to a SoA transform. Matrices that can't be decomposed,
+// because they're scaled to 0, keep their translation only.
+
+static ozz::math::SoaTransform DecomposePalette(const ozz::math::Float3x4 *matrices, size_t count)
+{
+    ozz::math::SimdFloat4 translations[4], rotations[4], scales[4];
+    for (size_t i = 0; i < 4; ++i) {
+        const ozz::math::Float4x4 matrix =
+            ozz::math::ToFloat4x4(i < count ? matrices[i] : ozz::math::Float3x4::identity());
+        if (!ozz::math::ToAffine(matrix, &translations[i], &rotations[i], &scales[i])) {
+            translations[i] = matrix.cols[3];
+            rotations[i] = ozz::math::simd_float4::w_axis();
+            scales[i] = ozz::math::simd_float4::zero();
+        }
+    }
+
+    ozz::math::SoaTransform transform;
+    ozz::math::Transpose4x3(translations, &transform.translation.x);
+    ozz::math::Transpose4x4(rotations, &transform.rotation.x);
+    ozz::math::Transpose4x3(scales, &transform.scale.x);
+    return transform;
+}
+
+// Interpolates 4 decomposed skinning matrices from a to b, and rebuilds count (at most 4) of them.
+// Rotations are nlerped along the shortest path and translations and scales lerped, so that fast rotating
+// joints don't shrink nor shear as with a matrix lerp.
+
+static void InterpolatePalette(const ozz::math::SoaTransform& a, const ozz::math::SoaTransform& b,
+                               ozz::math::SimdFloat4 alpha, ozz::math::Float3x4 *matrices, size_t count)
+{
+    const ozz::math::SimdFloat4 dot = a.rotation.x * b.rotation.x + a.rotation.y * b.rotation.y +
+                                      a.rotation.z * b.rotation.z + a.rotation.w * b.rotation.w;
+    const ozz::math::SimdInt4 sign = ozz::math::Sign(dot);
+    const ozz::math::SoaQuaternion rotation = {
+        ozz::math::Xor(b.rotation.x, sign), ozz::math::Xor(b.rotation.y, sign),
+        ozz::math::Xor(b.rotation.z, sign), ozz::math::Xor(b.rotation.w, sign)};
+    const ozz::math::SoaFloat4x4 matrix = ozz::math::SoaFloat4x4::FromAffine(
+        ozz::math::Lerp(a.translation, b.translation, alpha), ozz::math::NLerpEst(a.rotation, rotation, alpha),
+        ozz::math::Lerp(a.scale, b.scale, alpha));
+
+    // Matrix k row r is made of lane k of every column r component.
+    const ozz::math::SoaFloat4* cols = matrix.cols;
+    const ozz::math::SimdFloat4 xs[4] = {cols[0].x, cols[1].x, cols[2].x, cols[3].x};
+    const ozz::math::SimdFloat4 ys[4] = {cols[0].y, cols[1].y, cols[2].y, cols[3].y};
+    const ozz::math::SimdFloat4 zs[4] = {cols[0].z, cols[1].z, cols[2].z, cols[3].z};
+    ozz::math::SimdFloat4 rows[3][4];
+    ozz::math::Transpose4x4(xs, rows[0]);
+    ozz::math::Transpose4x4(ys, rows[1]);
+    ozz::math::Transpose4x4(zs, rows[2]);
+    for (size_t i = 0; i < count; ++i) {
+        const ozz::math::Float3x4 interpolated = {{rows[0][i], rows[1][i], rows[2][i]}};
+        matrices[i] = interpolated;
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Stores the palettes of an updated instance, for pose interpolation. Instances updated every frame have
+// nothing to interpolate, so their palettes are dropped instead.
+
+static void StorePalettes(animObj *anim)
+{
+    if (anim->update_interval <= 1) {
+        anim->num_palettes = 0;
+        return;
+    }
+
+    size_t num_soa_matrices = 0;
+    for (const game::Mesh& mesh : anim->meshes) {
+        num_soa_matrices += (mesh.joint_remaps.size() + 3) / 4;
+    }
+
+    anim->palette ^= 1;
+    anim->num_palettes = ozz::math::Min(anim->num_palettes + 1, 2);
+    ozz::vector<ozz::math::SoaTransform>& palette = anim->palettes[anim->palette];
+    palette.resize(num_soa_matrices);
+
+    size_t offset = 0;
+    for (size_t m = 0; m < anim->meshes.size(); ++m) {
+        const size_t count = anim->meshes[m].joint_remaps.size();
+        BuildSkinningMatrices(anim, m, make_span(anim->skinning_matrices));
+        for (size_t i = 0; i < count; i += 4) {
+            palette[offset++] = DecomposePalette(&anim->skinning_matrices[i], ozz::math::Min<size_t>(count - i, 4));
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+int DrawSkinnedMeshInternal( animObj * anim )
+{
+    // Instances updated at a reduced rate blend their last two palettes every frame, lagging one update
+    // behind. This is much cheaper than sampling and converting to model-space.
+    const bool interpolating = anim->interpolate && anim->update_interval > 1 && anim->num_palettes == 2 &&
+                               anim->update_dt > 0.f;
+
+    // Instances that weren't updated since their last skinning keep their vertex buffers.
+    if (anim->skinned && !interpolating) {
+        return 0;
+    }
+    anim->skinned = true;
+
+    const ozz::math::Float4x4 transform = ozz::math::Float4x4::identity();
+    const ozz::math::SimdFloat4 alpha =
+        ozz::math::simd_float4::Load1(interpolating ? ozz::math::Min(anim->pending_dt / anim->update_dt, 1.f) : 0.f);
+    const ozz::vector<ozz::math::SoaTransform>& previous = anim->palettes[anim->palette ^ 1];
+    const ozz::vector<ozz::math::SoaTransform>& current = anim->palettes[anim->palette];
+    
+    size_t offset = 0;
+    for (size_t m = 0; m < anim->meshes.size(); ++m) {
+        const game::Mesh& mesh = anim->meshes[m];
+        const size_t count = mesh.joint_remaps.size();
+        if (interpolating) {
+            for (size_t i = 0; i < count; i += 4, ++offset) {
+                InterpolatePalette(previous[offset], current[offset], alpha, &anim->skinning_matrices[i],
+                                   ozz::math::Min<size_t>(count - i, 4));
+            }
+        } else {
+            BuildSkinningMatrices(anim, m, make_span(anim->skinning_matrices));
         }
 
         // Renders skin.
-        bool ok = DrawDefoldSkinnedMesh(mesh, make_span(anim->skinning_matrices), transform);
-        if(ok == false) printf("Bad Draw juju\n");
+        if (!DrawDefoldSkinnedMesh(mesh, make_span(anim->skinning_matrices), transform)) {
+            dmLogError("DrawSkinnedMesh: Cannot skin mesh %d of %s", (int)m, anim->mesh_filename.c_str());
+        }
     }
 
     return 0;
@@ -381,40 +959,198 @@ static int DrawSkinnedMesh(lua_State *L)
 
 // --------------------------------------------------------------------------------------------------------
 
+// Advances an invisible instance playback time, without sampling it.
+
+static void CullInstance(animObj *anim)
+{
+    anim->controller.Update(anim->animations, anim->pending_dt);
+    anim->blend_tree.Update(anim->pending_dt);
+    anim->pending_dt = 0.f;
+    anim->culled = true;
+    anim->num_palettes = 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Advances an instance playback time by the time accumulated since its last update, samples it and
+// converts it to model-space.
+
+static bool UpdateInstance(animObj *anim)
+{
+    anim->culled = false;
+    anim->skinned = false;
+
+    // Updates current animation time.
+    anim->controller.Update(anim->animations, anim->pending_dt);
+    anim->update_dt = anim->pending_dt;
+    anim->pending_dt = 0.f;
+
+    // Distant instances are animated with a reduced skeleton. Blend trees prevent levels of detail from
+    // being selected.
+    if (anim->lod) {
+        if (!UpdateLod(anim)) {
+            return false;
+        }
+        if (anim->interpolate) {
+            StorePalettes(anim);
+        }
+        return true;
+    }
+
+    // Evaluates the blend tree instead of the animation. Blended poses aren't compared to the previous
+    // one, so all joints are dirty, unless the tree output was reused from its cache.
+    if (!anim->blend_tree.empty()) {
+        anim->blend_tree.Update(anim->update_dt);
+        if (!anim->blend_tree.Evaluate(*anim->skeleton, make_span(anim->track_mask), make_span(anim->locals))) {
+            return false;
+        }
+        if (anim->blend_tree.changed()) {
+            std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0xff);
+        }
+    } else if (anim->controller.time_ratio() != anim->sampled_ratio) {
+        // Samples optimized animation at t = animation_time_.
+        ozz::animation::SamplingJob sampling_job;
+        sampling_job.animation = &anim->animations;
+        sampling_job.context = &anim->context;
+        sampling_job.ratio = anim->controller.time_ratio();
+        sampling_job.output = make_span(anim->locals);
+        if (!anim->track_mask.empty()) {
+            sampling_job.track_mask = make_span(anim->track_mask);
+            sampling_job.rest_pose = anim->skeleton->joint_rest_poses();
+        }
+
+        // Mirroring moves transforms across joints after sampling compared them, so all joints are dirty.
+        if (anim->mirrored) {
+            if (!sampling_job.Run() || !game::MirrorPose(anim->shared->mirror, make_span(anim->locals))) {
+                return false;
+            }
+            std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0xff);
+        } else {
+            sampling_job.dirty = make_span(anim->dirty_joints);
+            if (!sampling_job.Run()) {
+                return false;
+            }
+        }
+        anim->sampled_ratio = sampling_job.ratio;
+    }
+
+    // Converts from local space to model space matrices.
+    ozz::animation::LocalToModelJob ltm_job;
+    ltm_job.skeleton = anim->skeleton;
+    ltm_job.input = make_span(anim->locals);
+    ltm_job.output3x4 = make_span(anim->models);
+    ltm_job.dirty = make_span(anim->dirty_joints);
+    ltm_job.joint_mask = make_span(anim->used_joints);
+    if (!ltm_job.Run()) {
+        return false;
+    }
+
+    // Dirty bits tell which joints were updated.
+    anim->num_updated_joints = 0;
+    for (int j = 0; j < anim->num_joints; ++j) {
+        anim->num_updated_joints +=
+            ozz::animation::TestJointBit(make_span(anim->dirty_joints), j) &&
+            (anim->used_joints.empty() || ozz::animation::TestJointBit(make_span(anim->used_joints), j));
+    }
+    std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0);
+
+    if (anim->interpolate) {
+        StorePalettes(anim);
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
 static int UpdateAnimation(lua_State *L)
 {
+    // The scheduler updates instances from OnUpdateozzanim.
+    if (g_budget_us > 0) {
+        return 0;
+    }
+
     double dt = (double)(( dmTime::GetTime() - g_last_time ) / 1000000.0 );
     g_last_time = dmTime::GetTime();
+    ++g_frame;
  
     for(size_t i=0; i<g_anims.size(); ++i)
     {
         // printf("Test dt: %g  %d\n", dt, (int)i);
         animObj *anim = g_anims[i];
-        // Updates current animation time.
-        anim->controller.Update(anim->animations, dt);
 
-        // Samples optimized animation at t = animation_time_.
-        ozz::animation::SamplingJob sampling_job;
-        sampling_job.animation = &anim->animations;
-        sampling_job.context = &anim->context;
-        sampling_job.ratio = anim->controller.time_ratio();
-        sampling_job.output = make_span(anim->locals);
-        if (!sampling_job.Run()) {
-            dmExtension::RESULT_INIT_ERROR  ;
+        // Less significant instances are updated at a lower rate. Instances sharing the same rate are
+        // staggered by index to spread their updates across frames. Skipped time is accumulated so
+        // that playback time advances exactly.
+        anim->pending_dt += dt;
+
+        // Invisible instances only advance their playback time, and get a single catch-up update when
+        // visible again.
+        if (!IsVisible(anim)) {
+            CullInstance(anim);
+            continue;
         }
 
-        // Converts from local space to model space matrices.
-        ozz::animation::LocalToModelJob ltm_job;
-        ltm_job.skeleton = &anim->skeleton;
-        ltm_job.input = make_span(anim->locals);
-        ltm_job.output = make_span(anim->models);
-        if (!ltm_job.Run()) {
-            dmExtension::RESULT_INIT_ERROR  ;
+        anim->update_interval = GetUpdateInterval(anim);
+        if (!anim->culled && (g_frame + i) % anim->update_interval != 0) {
+            continue;
+        }
+        if (!UpdateInstance(anim)) {
+            printf("[LoadOzz Error] UpdateAnimation: Cannot update anim: %s\n", anim->animation_filename.c_str());
         }
     }
     return 0;
 }
 
+// --------------------------------------------------------------------------------------------------------
+// Frame budget scheduler, enabled by SetBudget. Updates and skins instances from OnUpdateozzanim, the
+// most significant and stalest first, until the frame budget is spent. The remaining instances are
+// timesliced across the next frames, but instances stale for g_max_staleness frames are updated
+// whatever the budget.
+
+static void ScheduleAnimations()
+{
+    const uint64_t start = dmTime::GetTime();
+    const float dt = (float)((start - g_last_time) / 1000000.0);
+    g_last_time = start;
+    ++g_frame;
+
+    // Sorts visible instances by priority, forced ones first.
+    const float kForced = std::numeric_limits<float>::max();
+    g_schedule.clear();
+    for (animObj *anim : g_anims) {
+        anim->pending_dt += dt;
+        if (!IsVisible(anim)) {
+            CullInstance(anim);
+            continue;
+        }
+        ++anim->staleness;
+        const float priority = anim->culled || anim->staleness >= g_max_staleness
+                                   ? kForced
+                                   : GetScreenSize(anim) * anim->staleness;
+        g_schedule.push_back(std::make_pair(priority, anim));
+    }
+    std::sort(g_schedule.begin(), g_schedule.end(),
+              [](const std::pair<float, animObj *> &a, const std::pair<float, animObj *> &b) {
+                  return a.first > b.first;
+              });
+
+    g_num_scheduled = 0;
+    for (const std::pair<float, animObj *> &entry : g_schedule) {
+        if (entry.first != kForced && dmTime::GetTime() - start >= g_budget_us) {
+            break;
+        }
+        animObj *anim = entry.second;
+        anim->update_interval = anim->staleness;
+        anim->staleness = 0;
+        if (UpdateInstance(anim)) {
+            DrawSkinnedMeshInternal(anim);
+        } else {
+            printf("[LoadOzz Error] ScheduleAnimations: Cannot update anim: %s\n", anim->animation_filename.c_str());
+        }
+        ++g_num_scheduled;
+    }
+    g_budget_used_us = dmTime::GetTime() - start;
+}
+
 static int SetAnimationTime(lua_State *L) 
 {
     int idx = luaL_checknumber(L,1);
@@ -434,8 +1170,12 @@ static int SetAnimationTime(lua_State *L)
 }
 
 // --------------------------------------------------------------------------------------------------------
+// Restricts sampling to a set of joints, for distant characters. Takes a table of joint names, each
+// named joint and its ancestors are sampled, all other joints fall back to the skeleton rest pose.
+// Masking works on SoA tracks, so joints sharing a SoA track with a sampled joint are sampled too.
+// Joints no mesh or attachment uses are never sampled. Passing nil clears the mask.
 
-static int GetMeshBounds(lua_State *L)
+static int SetSamplingMask(lua_State *L)
 {
     int idx = luaL_checknumber(L,1);
     if( idx < 0 || idx >= g_anims.size()) {
@@ -445,44 +1185,894 @@ static int GetMeshBounds(lua_State *L)
     }
 
     animObj *anim = g_anims[idx];
+    anim->sampling_joints.clear();
+    if(!lua_isnoneornil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TTABLE);
 
-    // Set a default box.
-    ozz::math::Box _bound =  ozz::math::Box();   
-    if (anim->models.empty()) {
-        printf("[LoadOzz Error] GetMeshBounds: No models in anim!\n");
+        anim->sampling_joints.assign((anim->num_joints + 7) / 8, 0);
         lua_pushnil(L);
-        return 1;
-    }
-
-    // Loops through matrices and stores min/max.
-    // Matrices array cannot be empty, it was checked at the beginning of the
-    // function.
-    auto current = anim->models.begin();
-    ozz::math::SimdFloat4 min = current->cols[3];
-    ozz::math::SimdFloat4 max = current->cols[3];
-    ++current;
-    while (current < anim->models.end()) {
-        min = ozz::math::Min(min, current->cols[3]);
-        max = ozz::math::Max(max, current->cols[3]);
-        ++current;
+        while (lua_next(L, 2) != 0) {
+            const char *name = lua_tostring(L, -1);
+            const int joint = name ? ozz::animation::FindJoint(*anim->skeleton, name) : -1;
+            if(joint < 0) {
+                printf("[LoadOzz Error] SetSamplingMask: Unknown joint: %s\n", name ? name : "(nil)");
+            } else {
+                ozz::animation::SetJointBit(make_span(anim->sampling_joints), joint);
+            }
+            lua_pop(L, 1);
+        }
+        ozz::animation::SetAncestorBits(*anim->skeleton, make_span(anim->sampling_joints));
     }
+    UpdateJointMasks(anim);
 
-    // Stores in math::Box structure.
-    ozz::math::Store3PtrU(min, &_bound.min.x);
-    ozz::math::Store3PtrU(max, &_bound.max.x);
-
-    lua_pushnumber(L, _bound.min.x);
-    lua_pushnumber(L, _bound.min.y);
-    lua_pushnumber(L, _bound.min.z);
-    lua_pushnumber(L, _bound.max.x);
-    lua_pushnumber(L, _bound.max.y);
-    lua_pushnumber(L, _bound.max.z);
-    return 6;
+    // Returns the number of joints that are actually sampled.
+    lua_pushnumber(L, anim->num_sampled_joints);
+    return 1;
 }
 
 // --------------------------------------------------------------------------------------------------------
+// Registers a joint an object is attached to, so that it's kept updated even if no mesh uses it.
+// Returns the joint index, or nil if the joint doesn't exist.
 
-static int GetSkinnedBounds(lua_State *L)
+static int AddAttachment(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    const char *name = luaL_checkstring(L, 2);
+    const int joint = ozz::animation::FindJoint(*anim->skeleton, name);
+    if(joint < 0) {
+        printf("[LoadOzz Error] AddAttachment: Unknown joint: %s\n", name);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    anim->attachments.push_back(joint);
+    UpdateJointMasks(anim);
+
+    lua_pushnumber(L, joint);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Adds a level of detail using a skeleton reduced to at most max_joints joints, from the given camera
+// distance. The reduced skeleton and animation are built once, and shared by all instances of the same
+// skeleton and animation. Returns the number of joints of the level, or nil on failure.
+
+static int AddLod(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    const int max_joints = luaL_checknumber(L, 2);
+    const float distance = luaL_checknumber(L, 3);
+
+    lodObj *lod = new lodObj();
+    lod->distance = distance;
+    lod->shared = GetSkeletonLod(anim, max_joints);
+    if (!lod->shared || !BuildLodSkins(anim, lod)) {
+        printf("[LoadOzz Error] AddLod: Cannot build level of detail.\n");
+        delete lod;
+        lua_pushnil(L);
+        return 1;
+    }
+
+    const int num_lod_joints = lod->shared->skeleton.skeleton.num_joints();
+    lod->context.Resize(num_lod_joints);
+    lod->locals.resize(lod->shared->skeleton.skeleton.num_soa_joints());
+    lod->models.resize(num_lod_joints);
+
+    anim->lods.insert(
+        std::upper_bound(anim->lods.begin(), anim->lods.end(), lod,
+                         [](const lodObj *a, const lodObj *b) { return a->distance < b->distance; }),
+        lod);
+
+    lua_pushnumber(L, num_lod_joints);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Selects the level of detail matching the instance camera distance. Returns the number of joints
+// animated.
+
+static int SetLodDistance(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    const float distance = luaL_checknumber(L, 2);
+
+    // Picks the farthest level closer than distance.
+    lodObj *lod = nullptr;
+    for (lodObj *candidate : anim->lods) {
+        if (candidate->distance <= distance) {
+            lod = candidate;
+        }
+    }
+
+    // Blend trees and mirroring are only evaluated on the full skeleton.
+    if (!anim->blend_tree.empty() || anim->mirrored) {
+        lod = nullptr;
+    }
+
+    // Full skeleton matrices weren't updated while a level of detail was active.
+    if (lod != anim->lod) {
+        std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0xff);
+        anim->lod = lod;
+    }
+
+    lua_pushnumber(L, lod ? lod->shared->skeleton.skeleton.num_joints() : anim->num_joints);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Reads the sync markers of the [begin, end] ratio range of animation from Lua argument arg: a table of
+// marker times (in seconds, relative to begin), or a float track file authored with the whole animation.
+
+static bool GetSyncMarkers(lua_State *L, int arg, const ozz::animation::Animation& animation, float begin,
+                           float end, ozz::vector<float> *markers)
+{
+    if (lua_type(L, arg) == LUA_TSTRING) {
+        ozz::animation::FloatTrack track;
+        return LoadTrack(lua_tostring(L, arg), &track) && game::BuildSyncMarkers(track, begin, end, markers);
+    }
+    if (!lua_isnoneornil(L, arg)) {
+        luaL_checktype(L, arg, LUA_TTABLE);
+        const float duration = animation.duration() * (end - begin);
+        for (size_t i = 1; i <= lua_objlen(L, arg); ++i) {
+            lua_rawgeti(L, arg, i);
+            markers->push_back(lua_tonumber(L, -1) / duration);
+            lua_pop(L, 1);
+        }
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Adds a blend tree clip, loaded from an animation file and played at speed (1 by default). Optional sync
+// markers align transitions and synchronized nodes to this clip (see setblendtree). They are either a
+// table of marker times (in seconds), or a float track file whose rising edges (above .5) are markers.
+// Clips played by additive nodes are converted at load time to additive clips, the difference to their
+// first frame (additive = true) or to the skeleton rest pose (additive = "rest"), resampled at
+// sample_rate (in hertz, the source clip rate by default). Clips are loaded and converted once per
+// skeleton, and shared by the blend trees of its instances. Returns the clip index, or nil on failure.
+
+static int AddClip(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    const char *filename = luaL_checkstring(L, 2);
+    const float speed = lua_isnoneornil(L, 3) ? 1.f : luaL_checknumber(L, 3);
+
+    const bool additive = lua_toboolean(L, 5);
+    const char *reference = lua_tostring(L, 5);
+    const game::AdditiveReference additive_reference =
+        reference && strcmp(reference, "rest") == 0 ? game::kRestPoseReference : game::kFirstFrameReference;
+    const float sample_rate = lua_isnoneornil(L, 6) ? 0.f : luaL_checknumber(L, 6);
+    const clipObj *shared = GetClip(anim, filename, additive, additive_reference, sample_rate);
+    if (!shared) {
+        lua_pushnil(L);
+        return 1;
+    }
+
+    ozz::vector<float> markers;
+    if (!GetSyncMarkers(L, 4, shared->animation, 0.f, 1.f, &markers)) {
+        printf("[LoadOzz Error] AddClip: cannot load sync markers track: %s.\n", lua_tostring(L, 4));
+        lua_pushnil(L);
+        return 1;
+    }
+
+    const int clip = anim->blend_tree.AddClip(shared->animation, speed, additive);
+    anim->blend_tree.SetClipMarkers(clip, markers);
+    lua_pushnumber(L, clip);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Adds a named sub-clip, the [start, end] time range (in seconds) of a clip, played at speed (1 by default)
+// and looping inside the range. Sub-clips reference their clip keys instead of copying them, so that a
+// long take can be split into moves. Each has its own sampling context, so that sub-clips playing at
+// once don't seek each other. Sync markers are given as with
+// addclip, times being relative to start, and a track file covering the whole clip. Sub-clips are played
+// by clip nodes, by index or name (see setblendtree). Returns the sub-clip index, or nil on failure.
+
+static int AddSubClip(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    int clip = luaL_checknumber(L, 2);
+    if (clip < 0 || clip >= anim->blend_tree.num_clips()) {
+        printf("[LoadOzz Error] AddSubClip: Invalid clip index: %d\n", clip);
+        lua_pushnil(L);
+        return 1;
+    }
+    const char *name = luaL_checkstring(L, 3);
+    if (anim->blend_tree.FindClip(name) >= 0) {
+        printf("[LoadOzz Error] AddSubClip: Sub-clip already exists: %s\n", name);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    const ozz::animation::Animation& animation = anim->blend_tree.clip_animation(clip);
+    const float begin = luaL_checknumber(L, 4) / animation.duration();
+    const float end = luaL_checknumber(L, 5) / animation.duration();
+    const float speed = lua_isnoneornil(L, 6) ? 1.f : luaL_checknumber(L, 6);
+    const int sub_clip = anim->blend_tree.AddSubClip(clip, name, begin, end, speed);
+    if (sub_clip < 0) {
+        printf("[LoadOzz Error] AddSubClip: Invalid range for sub-clip: %s\n", name);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    ozz::vector<float> markers;
+    if (!GetSyncMarkers(L, 7, animation, begin, end, &markers)) {
+        printf("[LoadOzz Error] AddSubClip: cannot load sync markers track: %s.\n", lua_tostring(L, 7));
+        lua_pushnil(L);
+        return 1;
+    }
+    anim->blend_tree.SetClipMarkers(sub_clip, markers);
+    lua_pushnumber(L, sub_clip);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Adds a joint mask for partial blending, covering a joint subtree whose weight ramps up over falloff
+// joints (0 by default). Masks are shared by all instances of the skeleton, adding a mask name that
+// already exists returns the existing mask. Returns the mask index, or nil on failure.
+
+static int AddJointMask(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    skeletonObj *skel = g_anims[idx]->shared;
+    const char *name = luaL_checkstring(L, 2);
+    for (size_t i = 0; i < skel->mask_names.size(); ++i) {
+        if (skel->mask_names[i] == name) {
+            lua_pushnumber(L, i);
+            return 1;
+        }
+    }
+
+    const char *joint_name = luaL_checkstring(L, 3);
+    const int joint = ozz::animation::FindJoint(skel->skeleton, joint_name);
+    const int falloff = lua_isnoneornil(L, 4) ? 0 : luaL_checknumber(L, 4);
+    game::JointMask mask;
+    if (joint < 0 || !game::BuildJointMask(skel->skeleton, joint, falloff, &mask)) {
+        printf("[LoadOzz Error] AddJointMask: Cannot build mask from joint: %s\n", joint_name);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    skel->mask_names.push_back(name);
+    skel->masks.push_back(std::move(mask));
+    lua_pushnumber(L, skel->masks.size() - 1);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets the skeleton mirror table, shared by all its instances. Joints whose name contains left (e.g. "_L")
+// are mirrored to the joint named with right (e.g. "_R") instead, and conversely. The mirror plane is
+// normal to axis ("x" by default, "y" or "z") in model-space. Returns true, or nil if the skeleton isn't
+// symmetric.
+
+static int SetMirror(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    skeletonObj *skel = g_anims[idx]->shared;
+    const char *left = luaL_checkstring(L, 2);
+    const char *right = luaL_checkstring(L, 3);
+    const char *axis = lua_isnoneornil(L, 4) ? "x" : luaL_checkstring(L, 4);
+    const game::MirrorAxis mirror_axis =
+        strcmp(axis, "y") == 0 ? game::kMirrorY : strcmp(axis, "z") == 0 ? game::kMirrorZ : game::kMirrorX;
+
+    // The same table is already shared, so are its mirrored poses.
+    if (!skel->mirror.joints.empty() && skel->mirror.axis == mirror_axis &&
+        skel->mirror_left == left && skel->mirror_right == right) {
+        lua_pushboolean(L, 1);
+        return 1;
+    }
+
+    // The previous table is kept if the new one can't be built.
+    game::MirrorTable mirror;
+    if (!game::BuildMirrorTable(skel->skeleton, mirror_axis, left, right, &mirror)) {
+        printf("[LoadOzz Error] SetMirror: Cannot build mirror table from: %s, %s\n", left, right);
+        lua_pushnil(L);
+        return 1;
+    }
+    skel->mirror = std::move(mirror);
+    skel->mirror_left = left;
+    skel->mirror_right = right;
+
+    // Instances sample counterparts tracks from now on. Blend tree nodes cached poses mirrored with the
+    // previous table.
+    for (size_t i = 0; i < g_anims.size(); ++i) {
+        if (g_anims[i]->shared == skel) {
+            UpdateJointMasks(g_anims[i]);
+            g_anims[i]->blend_tree.InvalidateCaches();
+        }
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Plays the instance animation mirrored (see setmirror), or normally. Blend tree clips are mirrored by
+// their node instead (see setblendtree). Returns true, or nil if the skeleton has no mirror table.
+
+static int SetMirrored(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    const bool mirrored = lua_toboolean(L, 2);
+    if (mirrored && anim->shared->mirror.joints.empty()) {
+        printf("[LoadOzz Error] SetMirrored: No mirror table, see setmirror.\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // Mirroring is only evaluated on the full skeleton, whose matrices weren't updated while a level of
+    // detail was active.
+    if (mirrored != anim->mirrored) {
+        anim->mirrored = mirrored;
+        if (mirrored) {
+            anim->lod = nullptr;
+        }
+        anim->sampled_ratio = -1.f;
+        std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0xff);
+    }
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Reads the parameter named by field of the node table on top of the stack, adding it to the tree.
+// Returns -1 if the field isn't set.
+
+static int GetNodeParameter(lua_State *L, game::BlendTree *tree, const char *field)
+{
+    lua_getfield(L, -1, field);
+    const char *name = lua_tostring(L, -1);
+    const int parameter = name ? tree->AddParameter(name) : -1;
+    lua_pop(L, 1);
+    return parameter;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Reads the transitions table of the state machine node on top of the stack. Each transition is a table:
+//   {from = state, to = state, duration = seconds, exit = time ratio, sync = boolean, inertialize = boolean,
+//    conditions = {{"parameter name", "<" | ">" | "==" | "~=", value}, ...}}
+// States are indices in the node children (starting at 1), from = nil transitions from any state.
+// Returns false if a condition is invalid.
+
+static bool GetNodeTransitions(lua_State *L, game::BlendTree *tree, game::BlendNode *node)
+{
+    lua_getfield(L, -1, "transitions");
+    if (!lua_istable(L, -1)) {
+        lua_pop(L, 1);
+        return true;
+    }
+
+    bool valid = true;
+    for (size_t i = 1; i <= lua_objlen(L, -1); ++i) {
+        lua_rawgeti(L, -1, i);
+        game::BlendTransition transition;
+
+        lua_getfield(L, -1, "from");
+        transition.from = lua_isnumber(L, -1) ? lua_tonumber(L, -1) - 1 : -1;
+        lua_getfield(L, -2, "to");
+        transition.to = lua_tonumber(L, -1) - 1;
+        lua_getfield(L, -3, "duration");
+        transition.duration = lua_tonumber(L, -1);
+        lua_getfield(L, -4, "exit");
+        transition.exit_ratio = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : -1.f;
+        lua_getfield(L, -5, "sync");
+        transition.sync = lua_toboolean(L, -1);
+        lua_getfield(L, -6, "inertialize");
+        transition.inertialize = lua_toboolean(L, -1);
+        lua_pop(L, 6);
+
+        lua_getfield(L, -1, "conditions");
+        if (lua_istable(L, -1)) {
+            for (size_t c = 1; c <= lua_objlen(L, -1); ++c) {
+                lua_rawgeti(L, -1, c);
+                lua_rawgeti(L, -1, 1);
+                lua_rawgeti(L, -2, 2);
+                lua_rawgeti(L, -3, 3);
+                const char *name = lua_tostring(L, -3);
+                const char *comparison = lua_tostring(L, -2);
+                game::BlendCondition condition;
+                condition.parameter = name ? tree->AddParameter(name) : -1;
+                condition.value = lua_tonumber(L, -1);
+                if (comparison && strcmp(comparison, "<") == 0) {
+                    condition.comparison = game::BlendCondition::kLess;
+                } else if (comparison && strcmp(comparison, ">") == 0) {
+                    condition.comparison = game::BlendCondition::kGreater;
+                } else if (comparison && strcmp(comparison, "==") == 0) {
+                    condition.comparison = game::BlendCondition::kEqual;
+                } else if (comparison && strcmp(comparison, "~=") == 0) {
+                    condition.comparison = game::BlendCondition::kNotEqual;
+                } else {
+                    printf("[LoadOzz Error] SetBlendTree: Unknown comparison: %s\n", comparison ? comparison : "(nil)");
+                    valid = false;
+                }
+                transition.conditions.push_back(condition);
+                lua_pop(L, 4);
+            }
+        }
+        lua_pop(L, 1);
+
+        node->transitions.push_back(transition);
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return valid;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets the blend tree that replaces the instance animation. Takes an array of nodes, the first one being
+// the root. Each node is a table with a type and its settings:
+//   {type = "clip", clip = clip index or sub-clip name (see addclip, addsubclip), mirror = boolean (see setmirror)}
+//   {type = "lerp", children = {a, b}, parameter = "name", mask = joint mask index (see addjointmask)}
+//   {type = "additive", children = {base, additive}, parameter = "name", mask = joint mask index}
+//   {type = "blend1d", children = {...}, positions = {x, ...}, parameter = "name"}
+//   {type = "blend2d", children = {...}, positions = {{x, y}, ...}, parameter = "x name", parameter_y = "y name"}
+//   {type = "statemachine", children = {states...}, transitions = {...}}, see GetNodeTransitions
+// Children are indices in the node array (starting at 1), and must follow their parent. lerp, blend1d and
+// blend2d nodes with sync = true play their clips in phase, matching their sync markers (see addclip).
+// Parameters are set with setparameter. Passing nil removes the tree. Returns true, or nil if the tree is
+// invalid.
+
+static int SetBlendTree(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    ozz::vector<game::BlendNode> nodes;
+    if(!lua_isnoneornil(L, 2)) {
+        luaL_checktype(L, 2, LUA_TTABLE);
+
+        nodes.resize(lua_objlen(L, 2));
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            game::BlendNode& node = nodes[i];
+            lua_rawgeti(L, 2, i + 1);
+            luaL_checktype(L, -1, LUA_TTABLE);
+
+            lua_getfield(L, -1, "type");
+            const char *type = lua_tostring(L, -1);
+            lua_pop(L, 1);
+            const char *types[] = {"clip", "lerp", "additive", "blend1d", "blend2d", "statemachine"};
+            int t = 0;
+            while (t < 6 && (!type || strcmp(type, types[t]) != 0)) {
+                ++t;
+            }
+            if (t == 6) {
+                printf("[LoadOzz Error] SetBlendTree: Unknown node type: %s\n", type ? type : "(nil)");
+                lua_pop(L, 1);
+                lua_pushnil(L);
+                return 1;
+            }
+            node.type = static_cast<game::BlendNode::Type>(t);
+
+            lua_getfield(L, -1, "clip");
+            if (lua_type(L, -1) == LUA_TSTRING) {
+                node.clip = anim->blend_tree.FindClip(lua_tostring(L, -1));
+            } else {
+                node.clip = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : -1;
+            }
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "mask");
+            node.mask = lua_isnumber(L, -1) ? lua_tonumber(L, -1) : -1;
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "sync");
+            node.sync = lua_toboolean(L, -1);
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "mirror");
+            node.mirror = lua_toboolean(L, -1);
+            lua_pop(L, 1);
+
+            node.parameter = GetNodeParameter(L, &anim->blend_tree, "parameter");
+            node.parameter_y = GetNodeParameter(L, &anim->blend_tree, "parameter_y");
+            if (!GetNodeTransitions(L, &anim->blend_tree, &node)) {
+                lua_pop(L, 1);
+                lua_pushnil(L);
+                return 1;
+            }
+
+            lua_getfield(L, -1, "children");
+            if (lua_istable(L, -1)) {
+                for (size_t c = 1; c <= lua_objlen(L, -1); ++c) {
+                    lua_rawgeti(L, -1, c);
+                    node.children.push_back(lua_tonumber(L, -1) - 1);
+                    lua_pop(L, 1);
+                }
+            }
+            lua_pop(L, 1);
+
+            lua_getfield(L, -1, "positions");
+            if (lua_istable(L, -1)) {
+                for (size_t p = 1; p <= lua_objlen(L, -1); ++p) {
+                    lua_rawgeti(L, -1, p);
+                    ozz::math::Float2 position(0.f, 0.f);
+                    if (lua_istable(L, -1)) {
+                        lua_rawgeti(L, -1, 1);
+                        lua_rawgeti(L, -2, 2);
+                        position = ozz::math::Float2(lua_tonumber(L, -2), lua_tonumber(L, -1));
+                        lua_pop(L, 2);
+                    } else {
+                        position.x = lua_tonumber(L, -1);
+                    }
+                    node.positions.push_back(position);
+                    lua_pop(L, 1);
+                }
+            }
+            lua_pop(L, 1);
+
+            lua_pop(L, 1);
+        }
+    }
+
+    if (!anim->blend_tree.SetNodes(nodes)) {
+        printf("[LoadOzz Error] SetBlendTree: Invalid blend tree.\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // Blend trees are evaluated on the full skeleton, whose matrices weren't updated while a level of
+    // detail was active.
+    if (!nodes.empty()) {
+        anim->lod = nullptr;
+    }
+    std::fill(anim->dirty_joints.begin(), anim->dirty_joints.end(), 0xff);
+    anim->sampled_ratio = -1.f;
+
+    lua_pushboolean(L, 1);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets a blend tree parameter value. Parameters are created by setblendtree, unknown ones are ignored.
+
+static int SetParameter(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        return 0;    
+    }
+
+    animObj *anim = g_anims[idx];
+    const char *name = luaL_checkstring(L, 2);
+    const int parameter = anim->blend_tree.FindParameter(name);
+    if (parameter < 0) {
+        printf("[LoadOzz Error] SetParameter: Unknown parameter: %s\n", name);
+        return 0;
+    }
+    anim->blend_tree.set_parameter(parameter, luaL_checknumber(L, 3));
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Returns the current state of a state machine node (indices starting at 1, like setblendtree ones), or
+// nil if the node isn't a state machine.
+
+static int GetState(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    const int state = g_anims[idx]->blend_tree.state((int)luaL_checknumber(L, 2) - 1);
+    if (state < 0) {
+        lua_pushnil(L);
+    } else {
+        lua_pushnumber(L, state + 1);
+    }
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets the camera position used to compute instances update rate. Update rate level of detail is
+// disabled until the camera is set.
+
+static int SetCamera(lua_State *L)
+{
+    g_camera_position = ozz::math::Float3(luaL_checknumber(L, 1), luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+    g_camera_set = true;
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets an instance world position, and optionally its bounding radius (1 by default), used to compute
+// its update rate.
+
+static int SetPosition(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    anim->position = ozz::math::Float3(luaL_checknumber(L, 2), luaL_checknumber(L, 3), luaL_checknumber(L, 4));
+    if (!lua_isnoneornil(L, 5)) {
+        anim->radius = luaL_checknumber(L, 5);
+    }
+
+    lua_pushnumber(L, GetUpdateInterval(anim));
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Shows or hides an instance. Hidden instances aren't sampled nor skinned, but their playback time
+// still advances.
+
+static int SetVisible(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    anim->visible = lua_toboolean(L, 2) != 0;
+
+    lua_pushboolean(L, anim->visible);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Enables or disables pose interpolation. Instances updated at a reduced rate then blend their last two
+// skinning palettes every frame instead of showing stepped motion, at the cost of one update of lag.
+
+static int SetInterpolation(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    anim->interpolate = lua_toboolean(L, 2) != 0;
+    anim->num_palettes = 0;
+
+    lua_pushboolean(L, anim->interpolate);
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets frustum planes used to cull instances bounding sphere (see SetPosition). Takes a table of up to
+// 6 planes, each a table of 4 numbers: inward normal x, y, z and distance. Passing nil disables frustum
+// culling.
+
+static int SetFrustum(lua_State *L)
+{
+    g_num_frustum_planes = 0;
+    if(lua_isnoneornil(L, 1)) {
+        return 0;
+    }
+    luaL_checktype(L, 1, LUA_TTABLE);
+
+    const int num_planes = ozz::math::Min(static_cast<int>(lua_objlen(L, 1)), 6);
+    for (int i = 0; i < num_planes; ++i) {
+        lua_rawgeti(L, 1, i + 1);
+        luaL_checktype(L, -1, LUA_TTABLE);
+        float components[4];
+        for (int c = 0; c < 4; ++c) {
+            lua_rawgeti(L, -1, c + 1);
+            components[c] = lua_tonumber(L, -1);
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+        g_frustum_planes[i] = ozz::math::Float4(components[0], components[1], components[2], components[3]);
+    }
+    g_num_frustum_planes = num_planes;
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Sets the screen sizes (radius over camera distance) below which instances are updated every 2nd and
+// every 4th frame.
+
+static int SetUpdateSizes(lua_State *L)
+{
+    g_update_sizes[0] = luaL_checknumber(L, 1);
+    g_update_sizes[1] = luaL_checknumber(L, 2);
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Enables the frame budget scheduler, with a per frame budget in microseconds for animation and
+// skinning, and the maximum number of frames an instance can be left without update (4 by default).
+// Instances are then updated and skinned by the extension update, updateanimation does nothing.
+// A budget of 0 disables the scheduler.
+
+static int SetBudget(lua_State *L)
+{
+    g_budget_us = (uint64_t)ozz::math::Max(luaL_checknumber(L, 1), 0.);
+    if (!lua_isnoneornil(L, 2)) {
+        g_max_staleness = ozz::math::Max((int)luaL_checknumber(L, 2), 1);
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Returns the microseconds spent by the scheduler during the last frame, the budget, and the number of
+// instances it updated.
+
+static int GetBudgetStats(lua_State *L)
+{
+    lua_pushnumber(L, (double)g_budget_used_us);
+    lua_pushnumber(L, (double)g_budget_us);
+    lua_pushnumber(L, g_num_scheduled);
+    return 3;
+}
+
+// --------------------------------------------------------------------------------------------------------
+// Returns a table of joint counts: total joints, joints used by meshes and attachments, joints sampled
+// and joints whose model-space matrix was updated by the last update, the instance update interval,
+// whether it's visible and the number of blend tree clips sampled.
+
+static int GetStats(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+    lua_newtable(L);
+
+    lua_pushstring(L, "joints");
+    lua_pushnumber(L, anim->num_joints);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "used_joints");
+    lua_pushnumber(L, anim->num_used_joints);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "sampled_joints");
+    lua_pushnumber(L, anim->lod ? anim->lod->shared->skeleton.skeleton.num_joints() : anim->num_sampled_joints);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "updated_joints");
+    lua_pushnumber(L, anim->num_updated_joints);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "update_interval");
+    lua_pushnumber(L, anim->update_interval);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "visible");
+    lua_pushboolean(L, !anim->culled);
+    lua_rawset(L, -3);
+    lua_pushstring(L, "sampled_clips");
+    lua_pushnumber(L, anim->blend_tree.empty() ? 1 : anim->blend_tree.num_sampled_clips());
+    lua_rawset(L, -3);
+
+    return 1;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+static int GetMeshBounds(lua_State *L)
+{
+    int idx = luaL_checknumber(L,1);
+    if( idx < 0 || idx >= g_anims.size()) {
+        printf("[LoadOzz Error] Invalid anim index: %d\n", idx);
+        lua_pushnil(L);
+        return 1;    
+    }
+
+    animObj *anim = g_anims[idx];
+
+    // Set a default box.
+    ozz::math::Box _bound =  ozz::math::Box();   
+    if (anim->models.empty()) {
+        printf("[LoadOzz Error] GetMeshBounds: No models in anim!\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    // Loops through matrices and stores min/max.
+    // Matrices array cannot be empty, it was checked at the beginning of the
+    // function.
+    // Translations are stored in the w component of matrix rows, so rows are
+    // min/maxed as a whole and w components are extracted at the end.
+    // Joints that aren't used aren't updated, so they're skipped. Levels of
+    // detail update all their joints.
+    const ozz::vector<ozz::math::Float3x4>& models = anim->lod ? anim->lod->models : anim->models;
+    const ozz::span<const ozz::byte> used =
+        anim->lod ? ozz::span<const ozz::byte>() : make_span(anim->used_joints);
+    ozz::math::Float3x4 min, max;
+    for (int r = 0; r < 3; ++r) {
+        min.rows[r] = ozz::math::simd_float4::Load1(std::numeric_limits<float>::max());
+        max.rows[r] = ozz::math::simd_float4::Load1(-std::numeric_limits<float>::max());
+    }
+    for (size_t i = 0; i < models.size(); ++i) {
+        if (!used.empty() && !ozz::animation::TestJointBit(used, i)) {
+            continue;
+        }
+        const ozz::math::Float3x4& current = models[i];
+        for (int r = 0; r < 3; ++r) {
+            min.rows[r] = ozz::math::Min(min.rows[r], current.rows[r]);
+            max.rows[r] = ozz::math::Max(max.rows[r], current.rows[r]);
+        }
+    }
+
+    // Stores in math::Box structure.
+    _bound.min = ozz::math::Float3(ozz::math::GetW(min.rows[0]), ozz::math::GetW(min.rows[1]), ozz::math::GetW(min.rows[2]));
+    _bound.max = ozz::math::Float3(ozz::math::GetW(max.rows[0]), ozz::math::GetW(max.rows[1]), ozz::math::GetW(max.rows[2]));
+
+    lua_pushnumber(L, _bound.min.x);
+    lua_pushnumber(L, _bound.min.y);
+    lua_pushnumber(L, _bound.min.z);
+    lua_pushnumber(L, _bound.max.x);
+    lua_pushnumber(L, _bound.max.y);
+    lua_pushnumber(L, _bound.max.z);
+    return 6;
+}
+
+// --------------------------------------------------------------------------------------------------------
+
+static int GetSkinnedBounds(lua_State *L)
 {
     int idx = luaL_checknumber(L,1);
     if( idx < 0 || idx >= g_anims.size()) {
@@ -504,19 +2094,23 @@ static int GetSkinnedBounds(lua_State *L)
     // Loops through matrices and stores min/max.
     // Matrices array cannot be empty, it was checked at the beginning of the
     // function.
+    // Translations are stored in the w component of matrix rows, so rows are
+    // min/maxed as a whole and w components are extracted at the end.
     auto current = anim->skinning_matrices.begin();
-    ozz::math::SimdFloat4 min = current->cols[3];
-    ozz::math::SimdFloat4 max = current->cols[3];
+    ozz::math::Float3x4 min = *current;
+    ozz::math::Float3x4 max = *current;
     ++current;
     while (current < anim->skinning_matrices.end()) {
-        min = ozz::math::Min(min, current->cols[3]);
-        max = ozz::math::Max(max, current->cols[3]);
+        for (int r = 0; r < 3; ++r) {
+            min.rows[r] = ozz::math::Min(min.rows[r], current->rows[r]);
+            max.rows[r] = ozz::math::Max(max.rows[r], current->rows[r]);
+        }
         ++current;
     }
 
     // Stores in math::Box structure.
-    ozz::math::Store3PtrU(min, &_bound.min.x);
-    ozz::math::Store3PtrU(max, &_bound.max.x);
+    _bound.min = ozz::math::Float3(ozz::math::GetW(min.rows[0]), ozz::math::GetW(min.rows[1]), ozz::math::GetW(min.rows[2]));
+    _bound.max = ozz::math::Float3(ozz::math::GetW(max.rows[0]), ozz::math::GetW(max.rows[1]), ozz::math::GetW(max.rows[2]));
 
     lua_pushnumber(L, _bound.min.x);
     lua_pushnumber(L, _bound.min.y);
@@ -539,6 +2133,27 @@ static const luaL_reg Module_methods[] =
     {"updateanimation", UpdateAnimation},
     {"drawskinnedmesh", DrawSkinnedMesh},
     {"setanimationtime", SetAnimationTime},
+    {"setsamplingmask", SetSamplingMask},
+    {"addattachment", AddAttachment},
+    {"getstats", GetStats},
+    {"addlod", AddLod},
+    {"setloddistance", SetLodDistance},
+    {"setcamera", SetCamera},
+    {"setposition", SetPosition},
+    {"setupdatesizes", SetUpdateSizes},
+    {"setvisible", SetVisible},
+    {"setfrustum", SetFrustum},
+    {"setinterpolation", SetInterpolation},
+    {"setbudget", SetBudget},
+    {"getbudgetstats", GetBudgetStats},
+    {"addclip", AddClip},
+    {"addsubclip", AddSubClip},
+    {"setblendtree", SetBlendTree},
+    {"setparameter", SetParameter},
+    {"getstate", GetState},
+    {"addjointmask", AddJointMask},
+    {"setmirror", SetMirror},
+    {"setmirrored", SetMirrored},
     {0, 0}
 };
 
@@ -581,8 +2196,21 @@ static dmExtension::Result AppFinalizeozzanim(dmExtension::AppParams* params)
     dmLogInfo("AppFinalizeozz");
     for(int i=0; i<g_anims.size(); i++)
     {
+        for (lodObj *lod : g_anims[i]->lods) {
+            delete lod;
+        }
         delete g_anims[i];
     }
+    for(int i=0; i<g_skeletons.size(); i++)
+    {
+        for (skeletonLodObj *lod : g_skeletons[i]->lods) {
+            delete lod;
+        }
+        for (clipObj *clip : g_skeletons[i]->clips) {
+            delete clip;
+        }
+        delete g_skeletons[i];
+    }
     return dmExtension::RESULT_OK;
 }
 
@@ -598,6 +2226,9 @@ static dmExtension::Result Finalizeozzanim(dmExtension::Params* params)
 
 static dmExtension::Result OnUpdateozzanim(dmExtension::Params* params)
 {
+    if (g_budget_us > 0) {
+        ScheduleAnimations();
+    }
 
     return dmExtension::RESULT_OK;
 }
@@ -0,0 +1,983 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/blending_job.h"
+#include "ozz/animation/runtime/sampling_job.h"
+#include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/skeleton_utils.h"
+#include "ozz/animation/runtime/track.h"
+#include "ozz/animation/runtime/track_triggering_job.h"
+#include "ozz/base/log.h"
+#include "ozz/base/maths/math_ex.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/maths/vec_float.h"
+
+#include "blend/blend_tree.h"
+
+namespace game {
+
+namespace {
+// Children whose weight is below this threshold are culled, and aren't
+// sampled.
+const float kCullWeight = 1e-3f;
+
+// Returns true if _p is strictly inside the circumcircle of the
+// counterclockwise triangle (_a, _b, _c).
+bool InCircumcircle(const ozz::math::Float2& _a, const ozz::math::Float2& _b,
+                    const ozz::math::Float2& _c, const ozz::math::Float2& _p) {
+  const ozz::math::Float2 a = _a - _p;
+  const ozz::math::Float2 b = _b - _p;
+  const ozz::math::Float2 c = _c - _p;
+  const float det = ozz::math::Dot(a, a) * (b.x * c.y - c.x * b.y) -
+                    ozz::math::Dot(b, b) * (a.x * c.y - c.x * a.y) +
+                    ozz::math::Dot(c, c) * (a.x * b.y - b.x * a.y);
+  return det > 0.f;
+}
+
+// Sets _layer joint weights to _weights. SoaWeight only wraps a SimdFloat4,
+// so they share the same layout.
+void SetJointWeights(const ozz::vector<SoaWeight>& _weights,
+                     ozz::animation::BlendingJob::Layer* _layer) {
+  _layer->joint_weights = {
+      reinterpret_cast<const ozz::math::SimdFloat4*>(_weights.data()),
+      _weights.size()};
+}
+
+// Delaunay triangulation of _points (Bowyer-Watson). Outputs counterclockwise
+// triangles as triplets of point indices, none if points are collinear.
+void Triangulate(const ozz::vector<ozz::math::Float2>& _points,
+                 ozz::vector<int>* _triangles) {
+  _triangles->clear();
+  const int num_points = static_cast<int>(_points.size());
+  if (num_points < 3) {
+    return;
+  }
+
+  // Starts from a triangle that contains all points, whose vertices are
+  // appended to the points.
+  ozz::math::Float2 min = _points[0];
+  ozz::math::Float2 max = _points[0];
+  for (const ozz::math::Float2& point : _points) {
+    min = ozz::math::Min(min, point);
+    max = ozz::math::Max(max, point);
+  }
+  const ozz::math::Float2 center = (min + max) * .5f;
+  const float extent = ozz::math::Max(max.x - min.x, max.y - min.y) * 20.f;
+  ozz::vector<ozz::math::Float2> points = _points;
+  points.push_back(ozz::math::Float2(center.x - extent, center.y - extent));
+  points.push_back(ozz::math::Float2(center.x + extent, center.y - extent));
+  points.push_back(ozz::math::Float2(center.x, center.y + extent));
+
+  ozz::vector<int> triangles = {num_points, num_points + 1, num_points + 2};
+  ozz::vector<int> edges;
+  for (int p = 0; p < num_points; ++p) {
+    // Removes triangles whose circumcircle contains p, collecting their edges.
+    edges.clear();
+    for (size_t t = 0; t < triangles.size();) {
+      const int* v = &triangles[t];
+      if (InCircumcircle(points[v[0]], points[v[1]], points[v[2]],
+                         points[p])) {
+        for (int e = 0; e < 3; ++e) {
+          edges.push_back(v[e]);
+          edges.push_back(v[(e + 1) % 3]);
+        }
+        triangles.erase(triangles.begin() + t, triangles.begin() + t + 3);
+      } else {
+        t += 3;
+      }
+    }
+
+    // Edges shared by two removed triangles are inside the hole. The others
+    // bound it, and are connected to p.
+    for (size_t e = 0; e < edges.size(); e += 2) {
+      bool shared = false;
+      for (size_t o = 0; !shared && o < edges.size(); o += 2) {
+        shared = edges[o] == edges[e + 1] && edges[o + 1] == edges[e];
+      }
+      if (!shared) {
+        triangles.push_back(edges[e]);
+        triangles.push_back(edges[e + 1]);
+        triangles.push_back(p);
+      }
+    }
+  }
+
+  // Drops the triangles connected to the enclosing triangle.
+  for (size_t t = 0; t < triangles.size(); t += 3) {
+    if (triangles[t] < num_points && triangles[t + 1] < num_points &&
+        triangles[t + 2] < num_points) {
+      _triangles->insert(_triangles->end(), triangles.begin() + t,
+                         triangles.begin() + t + 3);
+    }
+  }
+}
+
+// Outputs the edges that points out of _triangles are projected on, as pairs
+// of point indices: _triangles boundary edges, or consecutive points along
+// their line if _points are collinear.
+void BoundaryEdges(const ozz::vector<ozz::math::Float2>& _points,
+                   const ozz::vector<int>& _triangles,
+                   ozz::vector<int>* _edges) {
+  _edges->clear();
+  if (_triangles.empty()) {
+    const int num_points = static_cast<int>(_points.size());
+    int farthest = 0;
+    for (int i = 1; i < num_points; ++i) {
+      if (ozz::math::LengthSqr(_points[i] - _points[0]) >
+          ozz::math::LengthSqr(_points[farthest] - _points[0])) {
+        farthest = i;
+      }
+    }
+    const ozz::math::Float2 direction = _points[farthest] - _points[0];
+    ozz::vector<int> order(num_points);
+    for (int i = 0; i < num_points; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](int _a, int _b) {
+      return ozz::math::Dot(_points[_a] - _points[0], direction) <
+             ozz::math::Dot(_points[_b] - _points[0], direction);
+    });
+    for (int i = 1; i < num_points; ++i) {
+      _edges->push_back(order[i - 1]);
+      _edges->push_back(order[i]);
+    }
+    return;
+  }
+
+  // Boundary edges belong to a single triangle, inner ones are shared by two
+  // triangles in opposite directions.
+  for (size_t t = 0; t < _triangles.size(); t += 3) {
+    for (int e = 0; e < 3; ++e) {
+      const int a = _triangles[t + e];
+      const int b = _triangles[t + (e + 1) % 3];
+      bool shared = false;
+      for (size_t o = 0; !shared && o < _triangles.size(); o += 3) {
+        for (int oe = 0; oe < 3; ++oe) {
+          shared |= _triangles[o + oe] == b &&
+                    _triangles[o + (oe + 1) % 3] == a;
+        }
+      }
+      if (!shared) {
+        _edges->push_back(a);
+        _edges->push_back(b);
+      }
+    }
+  }
+}
+}  // namespace
+
+BlendTransition::BlendTransition()
+    : from(-1),
+      to(-1),
+      duration(0.f),
+      inertialize(false),
+      exit_ratio(-1.f),
+      sync(false) {}
+
+BlendNode::BlendNode()
+    : type(kClip),
+      clip(-1),
+      mirror(false),
+      parameter(-1),
+      parameter_y(-1),
+      mask(-1),
+      sync(false) {}
+
+bool BuildJointMask(const ozz::animation::Skeleton& _skeleton, int _root,
+                    int _falloff, JointMask* _mask) {
+  assert(_mask);
+  const int num_joints = _skeleton.num_joints();
+  if (_root < 0 || _root >= num_joints || _falloff < 0) {
+    return false;
+  }
+
+  // Parents are iterated before their children, so depth can be propagated.
+  ozz::vector<int> depths(num_joints, 0);
+  ozz::vector<float> weights(_skeleton.num_soa_joints() * 4, 0.f);
+  ozz::animation::IterateJointsDF(
+      _skeleton,
+      [&](int _joint, int _parent) {
+        depths[_joint] = _joint == _root ? 0 : depths[_parent] + 1;
+        weights[_joint] = ozz::math::Min(
+            1.f, (depths[_joint] + 1.f) / (_falloff + 1.f));
+      },
+      _root);
+
+  const int num_soa_joints = _skeleton.num_soa_joints();
+  _mask->weights.resize(num_soa_joints);
+  _mask->inverse_weights.resize(num_soa_joints);
+  for (int i = 0; i < num_soa_joints; ++i) {
+    const ozz::math::SimdFloat4 weight =
+        ozz::math::simd_float4::LoadPtrU(&weights[i * 4]);
+    _mask->weights[i].value = weight;
+    _mask->inverse_weights[i].value = ozz::math::simd_float4::one() - weight;
+  }
+  return true;
+}
+
+bool BuildSyncMarkers(const ozz::animation::FloatTrack& _track, float _begin,
+                      float _end, ozz::vector<float>* _markers) {
+  assert(_markers);
+  if (_end <= _begin) {
+    return false;
+  }
+  ozz::animation::TrackTriggeringJob::Iterator iterator;
+  ozz::animation::TrackTriggeringJob job;
+  job.track = &_track;
+  job.from = _begin;
+  job.to = _end;
+  job.threshold = .5f;
+  job.iterator = &iterator;
+  if (!job.Run()) {
+    return false;
+  }
+
+  _markers->clear();
+  for (; iterator != job.end(); ++iterator) {
+    if (iterator->rising) {
+      _markers->push_back((iterator->ratio - _begin) / (_end - _begin));
+    }
+  }
+  return true;
+}
+
+BlendTree::Clip::Clip(const ozz::animation::Animation& _animation)
+    : animation(&_animation),
+      context(_animation.num_tracks()),
+      additive(false),
+      synced(false) {}
+
+float BlendTree::Clip::duration() const {
+  return animation->duration() *
+         (controller.range_end() - controller.range_begin());
+}
+
+BlendTree::BlendTree()
+    : masks_(nullptr),
+      mirror_(nullptr),
+      last_dt_(0.f),
+      num_soa_joints_(0),
+      stamp_(0),
+      output_stamp_(0),
+      changed_(true),
+      num_sampled_clips_(0) {}
+
+int BlendTree::AddClip(const ozz::animation::Animation& _animation,
+                       float _speed, bool _additive) {
+  clips_.push_back(ozz::make_unique<Clip>(_animation));
+  clips_.back()->controller.set_playback_speed(_speed);
+  clips_.back()->additive = _additive;
+  return static_cast<int>(clips_.size()) - 1;
+}
+
+int BlendTree::AddSubClip(int _clip, const char* _name, float _begin,
+                          float _end, float _speed) {
+  assert(_clip >= 0 && _clip < num_clips() && _name);
+  if (_begin < 0.f || _end > 1.f || _end <= _begin) {
+    return -1;
+  }
+  const Clip& clip = *clips_[_clip];
+  clips_.push_back(ozz::make_unique<Clip>(*clip.animation));
+  Clip& sub_clip = *clips_.back();
+  sub_clip.name = _name;
+  sub_clip.controller.set_range(_begin, _end);
+  sub_clip.controller.set_playback_speed(_speed);
+  sub_clip.additive = clip.additive;
+  return static_cast<int>(clips_.size()) - 1;
+}
+
+int BlendTree::FindClip(const char* _name) const {
+  for (size_t i = 0; i < clips_.size(); ++i) {
+    if (!clips_[i]->name.empty() && clips_[i]->name == _name) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void BlendTree::SetClipMarkers(int _clip, const ozz::vector<float>& _markers) {
+  assert(_clip >= 0 && _clip < num_clips());
+  clips_[_clip]->markers = _markers;
+  std::sort(clips_[_clip]->markers.begin(), clips_[_clip]->markers.end());
+}
+
+int BlendTree::AddParameter(const char* _name) {
+  const int parameter = FindParameter(_name);
+  if (parameter != -1) {
+    return parameter;
+  }
+  parameter_names_.push_back(_name);
+  parameters_.push_back(0.f);
+  return static_cast<int>(parameters_.size()) - 1;
+}
+
+int BlendTree::FindParameter(const char* _name) const {
+  for (size_t i = 0; i < parameter_names_.size(); ++i) {
+    if (parameter_names_[i] == _name) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+void BlendTree::set_parameter(int _index, float _value) {
+  assert(_index >= 0 && _index < static_cast<int>(parameters_.size()));
+  parameters_[_index] = _value;
+}
+
+bool BlendTree::SetNodes(const ozz::vector<BlendNode>& _nodes) {
+  nodes_.clear();
+
+  const int num_nodes = static_cast<int>(_nodes.size());
+  const int num_parameters = static_cast<int>(parameters_.size());
+  for (int i = 0; i < num_nodes; ++i) {
+    const BlendNode& node = _nodes[i];
+    const size_t num_children = node.children.size();
+    bool valid = true;
+    switch (node.type) {
+      case BlendNode::kClip:
+        valid = node.clip >= 0 && node.clip < num_clips() && num_children == 0;
+        break;
+      case BlendNode::kLerp:
+      case BlendNode::kAdditive:
+        valid = num_children == 2;
+        break;
+      case BlendNode::kBlend1D:
+        valid = num_children > 0 && node.positions.size() == num_children;
+        for (size_t c = 1; valid && c < num_children; ++c) {
+          valid = node.positions[c - 1].x < node.positions[c].x;
+        }
+        break;
+      case BlendNode::kBlend2D:
+        valid = num_children > 0 && node.positions.size() == num_children &&
+                node.parameter_y >= 0 && node.parameter_y < num_parameters;
+        for (size_t c = 0; valid && c < num_children; ++c) {
+          for (size_t o = c + 1; valid && o < num_children; ++o) {
+            valid = node.positions[c].x != node.positions[o].x ||
+                    node.positions[c].y != node.positions[o].y;
+          }
+        }
+        break;
+      case BlendNode::kStateMachine:
+        valid = num_children > 0;
+        for (const BlendTransition& transition : node.transitions) {
+          valid &= transition.from >= -1 &&
+                    transition.from < static_cast<int>(num_children) &&
+                    transition.to >= 0 &&
+                    transition.to < static_cast<int>(num_children) &&
+                    transition.duration >= 0.f;
+          for (const BlendCondition& condition : transition.conditions) {
+            valid &= condition.parameter >= 0 &&
+                     condition.parameter < num_parameters;
+          }
+        }
+        break;
+      default:
+        valid = false;
+        break;
+    }
+    if (node.type != BlendNode::kClip &&
+        node.type != BlendNode::kStateMachine) {
+      valid &= node.parameter >= 0 && node.parameter < num_parameters;
+    }
+    if (node.mirror) {
+      valid &= node.type == BlendNode::kClip && valid &&
+               !clips_[node.clip]->additive && mirror_ &&
+               !mirror_->joints.empty();
+    }
+    if (node.sync) {
+      valid &= node.type == BlendNode::kLerp ||
+               node.type == BlendNode::kBlend1D ||
+               node.type == BlendNode::kBlend2D;
+    }
+    if (node.mask != -1) {
+      valid &= (node.type == BlendNode::kLerp ||
+                node.type == BlendNode::kAdditive) &&
+               masks_ && node.mask >= 0 &&
+               node.mask < static_cast<int>(masks_->size());
+    }
+    for (int child : node.children) {
+      valid &= child > i && child < num_nodes;
+    }
+    if (!valid) {
+      ozz::log::Err() << "Invalid blend tree node " << i << "." << std::endl;
+      return false;
+    }
+
+    // A plain clip would be added as a delta, corrupting the pose.
+    if (node.type == BlendNode::kAdditive) {
+      const BlendNode& delta = _nodes[node.children[1]];
+      if (delta.type != BlendNode::kClip || delta.clip < 0 ||
+          delta.clip >= num_clips() || !clips_[delta.clip]->additive) {
+        ozz::log::Err() << "Blend tree additive node " << i
+                        << " second child isn't an additive clip." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  nodes_ = _nodes;
+  weights_.resize(nodes_.size());
+  child_poses_.resize(nodes_.size());
+  caches_.clear();
+  caches_.resize(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    weights_[i].assign(nodes_[i].children.size(), 0.f);
+    child_poses_[i].resize(nodes_[i].children.size());
+    caches_[i].stamps.assign(nodes_[i].children.size(), 0);
+  }
+
+  triangles_.clear();
+  triangles_.resize(nodes_.size());
+  edges_.clear();
+  edges_.resize(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    if (nodes_[i].type == BlendNode::kBlend2D) {
+      Triangulate(nodes_[i].positions, &triangles_[i]);
+      BoundaryEdges(nodes_[i].positions, triangles_[i], &edges_[i]);
+    }
+  }
+
+  // Children follow their parent, so synchronization can be propagated down
+  // in a single pass. Synchronized clips are updated by their topmost
+  // synchronized node.
+  synced_nodes_.clear();
+  ozz::vector<bool> synced(nodes_.size(), false);
+  for (const ozz::unique_ptr<Clip>& clip : clips_) {
+    clip->synced = false;
+  }
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const BlendNode& node = nodes_[i];
+    if (node.sync && !synced[i]) {
+      synced_nodes_.push_back(static_cast<int>(i));
+    }
+    if (node.sync || synced[i]) {
+      for (int child : node.children) {
+        synced[child] = true;
+      }
+      if (node.type == BlendNode::kClip) {
+        clips_[node.clip]->synced = true;
+      }
+    }
+  }
+
+  // State machines start in their first state.
+  const Machine machine = {0, -1, 0.f, 0.f};
+  machines_.assign(nodes_.size(), machine);
+
+  inertializers_.clear();
+  inertializers_.resize(nodes_.size());
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    for (const BlendTransition& transition : nodes_[i].transitions) {
+      if (transition.inertialize && !inertializers_[i]) {
+        inertializers_[i] = ozz::make_unique<Inertializer>();
+      }
+    }
+  }
+  return true;
+}
+
+int BlendTree::state(int _node) const {
+  if (_node < 0 || _node >= static_cast<int>(nodes_.size()) ||
+      nodes_[_node].type != BlendNode::kStateMachine) {
+    return -1;
+  }
+  return machines_[_node].state;
+}
+
+void BlendTree::Update(float _dt) {
+  for (const ozz::unique_ptr<Clip>& clip : clips_) {
+    if (!clip->synced) {
+      clip->controller.Update(*clip->animation, _dt);
+    }
+  }
+  for (int node : synced_nodes_) {
+    UpdateSyncedNode(node, _dt);
+  }
+
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    if (nodes_[i].type == BlendNode::kStateMachine) {
+      UpdateStateMachine(static_cast<int>(i), _dt);
+    }
+  }
+
+  // Transitions that just began are advanced too, as the last recorded pose
+  // is one update behind.
+  for (const ozz::unique_ptr<Inertializer>& inertializer : inertializers_) {
+    if (inertializer) {
+      inertializer->Update(_dt);
+    }
+  }
+  last_dt_ = _dt;
+}
+
+void BlendTree::UpdateSyncedNode(int _node, float _dt) {
+  const BlendNode& node = nodes_[_node];
+  ComputeWeights(_node);
+  const ozz::vector<float>& weights = weights_[_node];
+
+  // Cycle duration is blended from children leading clips, so that the node
+  // plays faster as it blends towards shorter clips.
+  float duration = 0.f;
+  float weight = 0.f;
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    const Clip& clip = *clips_[LeadingClip(node.children[i])];
+    const float speed = std::abs(clip.controller.playback_speed());
+    if (weights[i] > 0.f && speed > 0.f) {
+      duration += weights[i] * clip.duration() / speed;
+      weight += weights[i];
+    }
+  }
+
+  // The leading clip is advanced by the fraction of the cycle elapsed, other
+  // clips follow it.
+  const int leader = LeadingClip(_node);
+  Clip& clip = *clips_[leader];
+  const float speed = std::abs(clip.controller.playback_speed());
+  const float scale =
+      duration > 0.f && speed > 0.f
+          ? clip.duration() * weight / (duration * speed)
+          : 0.f;
+  clip.controller.Update(*clip.animation, _dt * scale);
+  SyncTimeRatio(_node, leader, clip.controller.time_ratio());
+}
+
+void BlendTree::UpdateStateMachine(int _node, float _dt) {
+  const BlendNode& node = nodes_[_node];
+  Machine& machine = machines_[_node];
+
+  machine.fade_time += _dt;
+  if (machine.previous != -1 && machine.fade_time >= machine.fade_duration) {
+    machine.previous = -1;
+  }
+  if (machine.previous != -1) {
+    return;
+  }
+
+  for (const BlendTransition& transition : node.transitions) {
+    if ((transition.from != -1 && transition.from != machine.state) ||
+        transition.to == machine.state) {
+      continue;
+    }
+    const int from_clip = LeadingClip(node.children[machine.state]);
+    const float from_ratio = clips_[from_clip]->controller.time_ratio();
+    if (transition.exit_ratio >= 0.f && from_ratio < transition.exit_ratio) {
+      continue;
+    }
+    bool met = true;
+    for (const BlendCondition& condition : transition.conditions) {
+      const float value = parameters_[condition.parameter];
+      switch (condition.comparison) {
+        case BlendCondition::kLess:
+          met &= value < condition.value;
+          break;
+        case BlendCondition::kGreater:
+          met &= value > condition.value;
+          break;
+        case BlendCondition::kEqual:
+          met &= value == condition.value;
+          break;
+        case BlendCondition::kNotEqual:
+          met &= value != condition.value;
+          break;
+      }
+    }
+    if (!met) {
+      continue;
+    }
+
+    const int to_node = node.children[transition.to];
+    SetTimeRatio(to_node, transition.sync ? SyncRatio(from_clip, from_ratio,
+                                                      LeadingClip(to_node))
+                                          : 0.f);
+    if (transition.inertialize) {
+      inertializers_[_node]->Begin(transition.duration);
+      machine.previous = -1;
+    } else {
+      machine.previous = transition.duration > 0.f ? machine.state : -1;
+    }
+    machine.state = transition.to;
+    machine.fade_time = 0.f;
+    machine.fade_duration = transition.duration;
+    break;
+  }
+}
+
+int BlendTree::LeadingClip(int _node) const {
+  while (nodes_[_node].type != BlendNode::kClip) {
+    const BlendNode& node = nodes_[_node];
+    int child = 0;
+    if (node.type == BlendNode::kStateMachine) {
+      child = machines_[_node].state;
+    } else if (node.type != BlendNode::kAdditive) {
+      const ozz::vector<float>& weights = weights_[_node];
+      child = static_cast<int>(
+          std::max_element(weights.begin(), weights.end()) - weights.begin());
+    }
+    _node = node.children[child];
+  }
+  return nodes_[_node].clip;
+}
+
+void BlendTree::SetTimeRatio(int _node, float _ratio) {
+  const BlendNode& node = nodes_[_node];
+  if (node.type == BlendNode::kClip) {
+    clips_[node.clip]->controller.set_time_ratio(_ratio);
+  }
+  for (int child : node.children) {
+    SetTimeRatio(child, _ratio);
+  }
+}
+
+void BlendTree::SyncTimeRatio(int _node, int _from, float _ratio) {
+  const BlendNode& node = nodes_[_node];
+  if (node.type == BlendNode::kClip && node.clip != _from) {
+    clips_[node.clip]->controller.set_time_ratio(
+        SyncRatio(_from, _ratio, node.clip));
+  }
+  for (int child : node.children) {
+    SyncTimeRatio(child, _from, _ratio);
+  }
+}
+
+float BlendTree::SyncRatio(int _from, float _ratio, int _to) const {
+  const ozz::vector<float>& from = clips_[_from]->markers;
+  const ozz::vector<float>& to = clips_[_to]->markers;
+  if (from.empty() || to.empty()) {
+    return _ratio;
+  }
+
+  // Finds the marker interval _ratio is in, which might wrap around the end
+  // of the loop.
+  const int num_from = static_cast<int>(from.size());
+  int marker =
+      static_cast<int>(std::upper_bound(from.begin(), from.end(), _ratio) -
+                       from.begin()) -
+      1;
+  if (marker < 0) {
+    marker = num_from - 1;
+  }
+  const float begin = from[marker];
+  const float end = marker + 1 < num_from ? from[marker + 1] : from[0] + 1.f;
+  const float elapsed = _ratio >= begin ? _ratio - begin : _ratio + 1.f - begin;
+  const float fraction = elapsed / (end - begin);
+
+  // Same fraction of the matching _to interval.
+  const int num_to = static_cast<int>(to.size());
+  const int to_marker = marker % num_to;
+  const float to_begin = to[to_marker];
+  const float to_end =
+      to_marker + 1 < num_to ? to[to_marker + 1] : to[0] + 1.f;
+  const float ratio = to_begin + fraction * (to_end - to_begin);
+  return ratio - std::floor(ratio);
+}
+
+void BlendTree::InvalidateCaches() {
+  for (NodeCache& cache : caches_) {
+    cache.valid = false;
+  }
+}
+
+bool BlendTree::Evaluate(const ozz::animation::Skeleton& _skeleton,
+                         const ozz::span<const ozz::byte>& _track_mask,
+                         const ozz::span<ozz::math::SoaTransform>& _output) {
+  num_sampled_clips_ = 0;
+  if (nodes_.empty() ||
+      _output.size() < static_cast<size_t>(_skeleton.num_soa_joints())) {
+    return false;
+  }
+
+  // Cached outputs were sampled with the previous track mask and skeleton.
+  if (_skeleton.num_soa_joints() != num_soa_joints_ ||
+      _track_mask.size() != track_mask_.size() ||
+      !std::equal(_track_mask.begin(), _track_mask.end(),
+                  track_mask_.begin())) {
+    num_soa_joints_ = _skeleton.num_soa_joints();
+    track_mask_.assign(_track_mask.begin(), _track_mask.end());
+    InvalidateCaches();
+  }
+
+  const int pose = EvaluateNode(0, _skeleton, _track_mask);
+  if (pose == -1) {
+    changed_ = true;
+    return false;
+  }
+  const NodeCache& cache = caches_[pose];
+  changed_ = cache.stamp != output_stamp_;
+  output_stamp_ = cache.stamp;
+  std::copy(cache.pose.begin(), cache.pose.end(), _output.begin());
+  return true;
+}
+
+int BlendTree::ComputeWeights(int _node) {
+  const BlendNode& node = nodes_[_node];
+  ozz::vector<float>& weights = weights_[_node];
+  const int num_children = static_cast<int>(node.children.size());
+  const float x = node.parameter >= 0 ? parameters_[node.parameter] : 0.f;
+
+  std::fill(weights.begin(), weights.end(), 0.f);
+  switch (node.type) {
+    case BlendNode::kLerp: {
+      // Masked joints blend children[1] over children[0], which is always
+      // needed by the others.
+      const float t = ozz::math::Clamp(0.f, x, 1.f);
+      weights[0] = node.mask == -1 ? 1.f - t : 1.f;
+      weights[1] = t;
+      break;
+    }
+    case BlendNode::kAdditive: {
+      weights[0] = 1.f;
+      weights[1] = ozz::math::Clamp(0.f, x, 1.f);
+      break;
+    }
+    case BlendNode::kBlend1D: {
+      const ozz::vector<ozz::math::Float2>& positions = node.positions;
+      if (x <= positions[0].x) {
+        weights[0] = 1.f;
+      } else if (x >= positions[num_children - 1].x) {
+        weights[num_children - 1] = 1.f;
+      } else {
+        int i = 0;
+        while (x > positions[i + 1].x) {
+          ++i;
+        }
+        const float t =
+            (x - positions[i].x) / (positions[i + 1].x - positions[i].x);
+        weights[i] = 1.f - t;
+        weights[i + 1] = t;
+      }
+      break;
+    }
+    case BlendNode::kBlend2D: {
+      // Barycentric coordinates in the triangle that contains p, so that at
+      // most three children are blended.
+      const ozz::vector<ozz::math::Float2>& positions = node.positions;
+      const ozz::vector<int>& triangles = triangles_[_node];
+      const ozz::math::Float2 p(x, parameters_[node.parameter_y]);
+      bool inside = false;
+      for (size_t t = 0; !inside && t < triangles.size(); t += 3) {
+        const int* v = &triangles[t];
+        const ozz::math::Float2 ab = positions[v[1]] - positions[v[0]];
+        const ozz::math::Float2 ac = positions[v[2]] - positions[v[0]];
+        const ozz::math::Float2 ap = p - positions[v[0]];
+        const float d00 = ozz::math::Dot(ab, ab);
+        const float d01 = ozz::math::Dot(ab, ac);
+        const float d11 = ozz::math::Dot(ac, ac);
+        const float d20 = ozz::math::Dot(ap, ab);
+        const float d21 = ozz::math::Dot(ap, ac);
+        const float denom = d00 * d11 - d01 * d01;
+        const float v1 = (d11 * d20 - d01 * d21) / denom;
+        const float v2 = (d00 * d21 - d01 * d20) / denom;
+        const float v0 = 1.f - v1 - v2;
+        inside = v0 >= -1e-5f && v1 >= -1e-5f && v2 >= -1e-5f;
+        if (inside) {
+          weights[v[0]] = ozz::math::Max(v0, 0.f);
+          weights[v[1]] = ozz::math::Max(v1, 0.f);
+          weights[v[2]] = ozz::math::Max(v2, 0.f);
+        }
+      }
+      if (inside) {
+        break;
+      }
+
+      // Out of the triangulation, p is projected on the nearest boundary
+      // edge.
+      const ozz::vector<int>& edges = edges_[_node];
+      int edge[2] = {0, 0};
+      float edge_t = 0.f;
+      float nearest = std::numeric_limits<float>::max();
+      for (size_t e = 0; e < edges.size(); e += 2) {
+        const ozz::math::Float2& a = positions[edges[e]];
+        const ozz::math::Float2 ab = positions[edges[e + 1]] - a;
+        const float t = ozz::math::Clamp(
+            0.f, ozz::math::Dot(p - a, ab) / ozz::math::Dot(ab, ab), 1.f);
+        const float distance = ozz::math::LengthSqr(p - (a + ab * t));
+        if (distance < nearest) {
+          nearest = distance;
+          edge[0] = edges[e];
+          edge[1] = edges[e + 1];
+          edge_t = t;
+        }
+      }
+      weights[edge[0]] = 1.f - edge_t;
+      weights[edge[1]] += edge_t;
+      break;
+    }
+    case BlendNode::kStateMachine: {
+      // Crossfades linearly from the previous state.
+      const Machine& machine = machines_[_node];
+      if (machine.previous != -1) {
+        const float t = machine.fade_time / machine.fade_duration;
+        weights[machine.previous] = 1.f - t;
+        weights[machine.state] = t;
+      } else {
+        weights[machine.state] = 1.f;
+      }
+      break;
+    }
+    default:
+      assert(false);
+      break;
+  }
+
+  // Culls children that don't contribute, and normalizes the others so
+  // culling doesn't change the blend total weight. Additive and masked
+  // weights aren't normalized.
+  int num_contributing = 0;
+  float sum = 0.f;
+  for (float& weight : weights) {
+    if (weight < kCullWeight) {
+      weight = 0.f;
+    } else {
+      ++num_contributing;
+      sum += weight;
+    }
+  }
+  if (node.type != BlendNode::kAdditive && node.mask == -1) {
+    for (float& weight : weights) {
+      weight /= sum;
+    }
+  }
+  return num_contributing;
+}
+
+int BlendTree::EvaluateNode(int _node,
+                            const ozz::animation::Skeleton& _skeleton,
+                            const ozz::span<const ozz::byte>& _track_mask) {
+  const BlendNode& node = nodes_[_node];
+  if (node.type != BlendNode::kClip) {
+    return EvaluateChildren(_node, _skeleton, _track_mask);
+  }
+
+  // Clip is only sampled if its time ratio changed, paused clips are free.
+  Clip& clip = *clips_[node.clip];
+  NodeCache& cache = caches_[_node];
+  const float ratio = clip.controller.animation_ratio();
+  if (cache.valid && cache.ratio == ratio) {
+    return _node;
+  }
+
+  cache.valid = false;
+  cache.pose.resize(_skeleton.num_soa_joints());
+  ozz::animation::SamplingJob sampling_job;
+  sampling_job.animation = clip.animation;
+  sampling_job.context = &clip.context;
+  sampling_job.ratio = ratio;
+  sampling_job.output = make_span(cache.pose);
+  // Masked tracks are set to the rest pose, which isn't a neutral delta.
+  if (!_track_mask.empty() && !clip.additive) {
+    sampling_job.track_mask = _track_mask;
+    sampling_job.rest_pose = _skeleton.joint_rest_poses();
+  }
+  if (!sampling_job.Run() ||
+      (node.mirror && !MirrorPose(*mirror_, make_span(cache.pose)))) {
+    return -1;
+  }
+  ++num_sampled_clips_;
+  cache.valid = true;
+  cache.ratio = ratio;
+  cache.stamp = ++stamp_;
+  return _node;
+}
+
+int BlendTree::EvaluateChildren(int _node,
+                                const ozz::animation::Skeleton& _skeleton,
+                                const ozz::span<const ozz::byte>& _track_mask) {
+  const BlendNode& node = nodes_[_node];
+  NodeCache& cache = caches_[_node];
+  Inertializer* inertializer = inertializers_[_node].get();
+
+  // Weights are computed before children are evaluated, so that culled
+  // subtrees are never sampled.
+  const int num_contributing = ComputeWeights(_node);
+  const ozz::vector<float>& weights = weights_[_node];
+
+  // The last output is reused if weights and children outputs didn't change.
+  // Inertializers state changes every update, so their output is never
+  // reused.
+  ozz::vector<int>& poses = child_poses_[_node];
+  bool unchanged = cache.valid && !inertializer && cache.weights == weights;
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    poses[i] = -1;
+    if (weights[i] > 0.f) {
+      poses[i] = EvaluateNode(node.children[i], _skeleton, _track_mask);
+      if (poses[i] == -1) {
+        cache.valid = false;
+        return -1;
+      }
+      unchanged &= caches_[poses[i]].stamp == cache.stamps[i];
+    }
+  }
+
+  // A single contributing child is used as is.
+  if (num_contributing == 1 && !inertializer) {
+    cache.valid = false;
+    return *std::max_element(poses.begin(), poses.end());
+  }
+  if (unchanged) {
+    return _node;
+  }
+
+  cache.valid = false;
+  cache.pose.resize(_skeleton.num_soa_joints());
+  layers_.clear();
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    if (poses[i] != -1) {
+      ozz::animation::BlendingJob::Layer layer;
+      layer.weight = weights[i];
+      layer.transform = make_span(caches_[poses[i]].pose);
+      layers_.push_back(layer);
+    }
+  }
+
+  ozz::animation::BlendingJob blending_job;
+  if (node.type == BlendNode::kAdditive) {
+    if (node.mask != -1) {
+      SetJointWeights((*masks_)[node.mask].weights, &layers_[1]);
+    }
+    blending_job.layers = make_span(layers_).subspan(0, 1);
+    blending_job.additive_layers = make_span(layers_).subspan(1, 1);
+  } else if (node.mask != -1) {
+    // Masked joints get children[1] weight t, and children[0] 1 - t. The
+    // others only get children[0], split in two layers so that weights
+    // always sum to 1: 1 - t for all joints, plus t outside of the mask.
+    const JointMask& mask = (*masks_)[node.mask];
+    const float t = layers_[1].weight;
+    SetJointWeights(mask.weights, &layers_[1]);
+    ozz::animation::BlendingJob::Layer outside = layers_[0];
+    outside.weight = t;
+    SetJointWeights(mask.inverse_weights, &outside);
+    layers_[0].weight = 1.f - t;
+    layers_.push_back(outside);
+    blending_job.layers = make_span(layers_);
+  } else {
+    blending_job.layers = make_span(layers_);
+  }
+  blending_job.rest_pose = _skeleton.joint_rest_poses();
+  blending_job.output = make_span(cache.pose);
+  if (!blending_job.Run()) {
+    return -1;
+  }
+
+  // State machines with inertialized transitions record their output, from
+  // which the next transition starts, and decay the offsets of the one in
+  // progress.
+  if (inertializer) {
+    const ozz::span<ozz::math::SoaTransform> output = make_span(cache.pose);
+    inertializer->Apply(output);
+    inertializer->Record(output, last_dt_);
+  }
+
+  cache.valid = true;
+  cache.weights = weights;
+  for (size_t i = 0; i < node.children.size(); ++i) {
+    cache.stamps[i] = poses[i] != -1 ? caches_[poses[i]].stamp : 0;
+  }
+  cache.stamp = ++stamp_;
+  return _node;
+}
+}  // namespace game
@@ -27,14 +27,17 @@ PlaybackController::PlaybackController()
       previous_time_ratio_(0.f),
       playback_speed_(1.f),
       play_(true),
-      loop_(true) {}
+      loop_(true),
+      range_begin_(0.f),
+      range_end_(1.f) {}
 
 void PlaybackController::Update(const ozz::animation::Animation& _animation,
                                 float _dt) {
   float new_time = time_ratio_;
 
-  if (play_) {
-    new_time = time_ratio_ + _dt * playback_speed_ / _animation.duration();
+  const float duration = _animation.duration() * (range_end_ - range_begin_);
+  if (play_ && duration > 0.f) {
+    new_time = time_ratio_ + _dt * playback_speed_ / duration;
   }
 
   // Must be called even if time doesn't change, in order to update previous
@@ -59,6 +62,15 @@ void PlaybackController::set_time_ratio(float _ratio) {
 // Gets animation current time.
 float PlaybackController::time_ratio() const { return time_ratio_; }
 
+void PlaybackController::set_range(float _begin, float _end) {
+  range_begin_ = ozz::math::Clamp(0.f, _begin, 1.f);
+  range_end_ = ozz::math::Clamp(range_begin_, _end, 1.f);
+}
+
+float PlaybackController::animation_ratio() const {
+  return range_begin_ + time_ratio_ * (range_end_ - range_begin_);
+}
+
 // Gets animation time of last update.
 float PlaybackController::previous_time_ratio() const {
   return previous_time_ratio_;
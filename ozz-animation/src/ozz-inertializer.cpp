@@ -0,0 +1,236 @@
+
+#include <algorithm>
+
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/base/maths/soa_float.h"
+#include "ozz/base/maths/soa_quaternion.h"
+#include "ozz/base/maths/soa_transform.h"
+
+#include "blend/inertializer.h"
+
+namespace game {
+
+namespace {
+using ozz::math::SimdFloat4;
+using ozz::math::SimdInt4;
+using ozz::math::SoaFloat3;
+using ozz::math::SoaQuaternion;
+
+// Keeps quaternion _q in the same hemisphere as _ref, so that it's the
+// shortest rotation.
+SoaQuaternion AlignHemisphere(const SoaQuaternion& _q,
+                              const SoaQuaternion& _ref) {
+  const SimdFloat4 dot =
+      _q.x * _ref.x + _q.y * _ref.y + _q.z * _ref.z + _q.w * _ref.w;
+  const SimdInt4 flip = ozz::math::CmpLt(dot, ozz::math::simd_float4::zero());
+  const SoaQuaternion r = {ozz::math::Select(flip, -_q.x, _q.x),
+                           ozz::math::Select(flip, -_q.y, _q.y),
+                           ozz::math::Select(flip, -_q.z, _q.z),
+                           ozz::math::Select(flip, -_q.w, _q.w)};
+  return r;
+}
+
+// Evaluates normalized decay polynomial at _t, 0 past t1.
+SimdFloat4 EvaluateDecay(const SimdFloat4& _a, const SimdFloat4& _b,
+                         const SimdFloat4& _c, const SimdFloat4& _d,
+                         const SimdFloat4& _v, const SimdFloat4& _t1,
+                         const SimdFloat4& _t) {
+  const SimdFloat4 f =
+      ((((_a * _t + _b) * _t + _c) * _t + _d) * _t + _v) * _t +
+      ozz::math::simd_float4::one();
+  return ozz::math::Select(ozz::math::CmpLt(_t, _t1), f,
+                           ozz::math::simd_float4::zero());
+}
+}  // namespace
+
+Inertializer::Inertializer()
+    : num_poses_(0),
+      latest_(0),
+      dt_(0.f),
+      updates_(0),
+      active_(false),
+      pending_(false),
+      duration_(0.f),
+      time_(0.f) {}
+
+void Inertializer::Record(
+    const ozz::span<const ozz::math::SoaTransform>& _pose, float _dt) {
+  latest_ ^= 1;
+  poses_[latest_].assign(_pose.begin(), _pose.end());
+  // The previous pose is stale if updates were skipped since.
+  num_poses_ = updates_ > 1 ? 1 : std::min(num_poses_ + 1, 2);
+  dt_ = _dt;
+  updates_ = 0;
+}
+
+void Inertializer::Begin(float _duration) {
+  // Nothing to transition from, or only stale poses.
+  if (updates_ > 0) {
+    num_poses_ = 0;
+  }
+  if (num_poses_ == 0 || _duration <= 0.f) {
+    active_ = false;
+    return;
+  }
+  active_ = true;
+  pending_ = true;
+  duration_ = _duration;
+  time_ = 0.f;
+}
+
+void Inertializer::Update(float _dt) {
+  ++updates_;
+  if (!active_) {
+    return;
+  }
+  time_ += _dt;
+  if (time_ >= duration_ && !pending_) {
+    active_ = false;
+  }
+}
+
+Inertializer::Decay Inertializer::ComputeDecay(
+    ozz::math::_SimdFloat4 _x, ozz::math::_SimdFloat4 _x_prev) const {
+  const SimdFloat4 zero = ozz::math::simd_float4::zero();
+  const SimdFloat4 x = ozz::math::Max(_x, ozz::math::simd_float4::Load1(1e-6f));
+
+  // Normalized velocity. It's only kept if moving toward zero, so that the
+  // offset never overshoots.
+  SimdFloat4 v = zero;
+  if (num_poses_ == 2 && dt_ > 0.f) {
+    v = ozz::math::Min((x - _x_prev) / (x * ozz::math::simd_float4::Load1(dt_)),
+                       zero);
+  }
+
+  // Shortens the transition so that the offset doesn't overshoot when the
+  // velocity is high.
+  const SimdFloat4 duration = ozz::math::simd_float4::Load1(duration_);
+  const SimdFloat4 t1 = ozz::math::Select(
+      ozz::math::CmpLt(v, zero),
+      ozz::math::Min(duration, ozz::math::simd_float4::Load1(-5.f) / v),
+      duration);
+  const SimdFloat4 t1_2 = t1 * t1;
+  const SimdFloat4 t1_3 = t1_2 * t1;
+  const SimdFloat4 t1_4 = t1_3 * t1;
+  const SimdFloat4 t1_5 = t1_4 * t1;
+  const SimdFloat4 vt1 = v * t1;
+  const SimdFloat4 two = ozz::math::simd_float4::Load1(2.f);
+
+  // Initial acceleration, again never away from zero.
+  const SimdFloat4 a0 = ozz::math::Max(
+      (ozz::math::simd_float4::Load1(-8.f) * vt1 -
+       ozz::math::simd_float4::Load1(20.f)) /
+          t1_2,
+      zero);
+  const SimdFloat4 a0t1_2 = a0 * t1_2;
+
+  Decay decay;
+  decay.a = -(a0t1_2 + ozz::math::simd_float4::Load1(6.f) * vt1 +
+              ozz::math::simd_float4::Load1(12.f)) /
+            (two * t1_5);
+  decay.b = (ozz::math::simd_float4::Load1(3.f) * a0t1_2 +
+             ozz::math::simd_float4::Load1(16.f) * vt1 +
+             ozz::math::simd_float4::Load1(30.f)) /
+            (two * t1_4);
+  decay.c = -(ozz::math::simd_float4::Load1(3.f) * a0t1_2 +
+              ozz::math::simd_float4::Load1(12.f) * vt1 +
+              ozz::math::simd_float4::Load1(20.f)) /
+            (two * t1_3);
+  decay.d = a0 * ozz::math::simd_float4::Load1(.5f);
+  decay.v = v;
+  decay.t1 = t1;
+  return decay;
+}
+
+void Inertializer::ComputeOffsets(
+    const ozz::span<const ozz::math::SoaTransform>& _pose) {
+  const ozz::vector<ozz::math::SoaTransform>& source = poses_[latest_];
+  const ozz::vector<ozz::math::SoaTransform>& previous =
+      num_poses_ == 2 ? poses_[latest_ ^ 1] : source;
+  const size_t num_soa_joints = std::min(_pose.size(), source.size());
+  offsets_.resize(num_soa_joints);
+  decays_.resize(num_soa_joints * 3);
+
+  const SimdFloat4 epsilon = ozz::math::simd_float4::Load1(1e-6f);
+  for (size_t i = 0; i < num_soa_joints; ++i) {
+    const ozz::math::SoaTransform& target = _pose[i];
+    ozz::math::SoaTransform& offset = offsets_[i];
+
+    // Translation and scale offsets are vectors, whose length is decayed.
+    // Previous offset is projected on the current offset direction.
+    offset.translation = source[i].translation - target.translation;
+    const SimdFloat4 t_length = ozz::math::Length(offset.translation);
+    const SoaFloat3 t_direction =
+        offset.translation / ozz::math::Max(t_length, epsilon);
+    decays_[i * 3 + 0] = ComputeDecay(
+        t_length,
+        ozz::math::Dot(previous[i].translation - target.translation,
+                       t_direction));
+
+    offset.scale = source[i].scale - target.scale;
+    const SimdFloat4 s_length = ozz::math::Length(offset.scale);
+    const SoaFloat3 s_direction =
+        offset.scale / ozz::math::Max(s_length, epsilon);
+    decays_[i * 3 + 2] = ComputeDecay(
+        s_length,
+        ozz::math::Dot(previous[i].scale - target.scale, s_direction));
+
+    // Rotation offset is decayed as the tangent of its half angle, which is
+    // the length of its axis once w is 1. Scaling the axis then
+    // renormalizing scales this tangent.
+    const SoaQuaternion identity = ozz::math::SoaQuaternion::identity();
+    offset.rotation = AlignHemisphere(
+        source[i].rotation * ozz::math::Conjugate(target.rotation), identity);
+    const SoaQuaternion r_previous = AlignHemisphere(
+        previous[i].rotation * ozz::math::Conjugate(target.rotation),
+        offset.rotation);
+    const SoaFloat3 axis = {offset.rotation.x, offset.rotation.y,
+                            offset.rotation.z};
+    const SimdFloat4 sin_half = ozz::math::Length(axis);
+    const SoaFloat3 r_direction = axis / ozz::math::Max(sin_half, epsilon);
+    const SoaFloat3 axis_previous = {r_previous.x, r_previous.y,
+                                     r_previous.z};
+    decays_[i * 3 + 1] = ComputeDecay(
+        sin_half / ozz::math::Max(offset.rotation.w, epsilon),
+        ozz::math::Dot(axis_previous, r_direction) /
+            ozz::math::Max(r_previous.w, epsilon));
+  }
+}
+
+void Inertializer::Apply(const ozz::span<ozz::math::SoaTransform>& _pose) {
+  if (!active_) {
+    return;
+  }
+  if (pending_) {
+    ComputeOffsets(_pose);
+    pending_ = false;
+  }
+  if (time_ >= duration_) {
+    active_ = false;
+    return;
+  }
+
+  const SimdFloat4 t = ozz::math::simd_float4::Load1(time_);
+  const size_t num_soa_joints = std::min(_pose.size(), offsets_.size());
+  for (size_t i = 0; i < num_soa_joints; ++i) {
+    const ozz::math::SoaTransform& offset = offsets_[i];
+    const Decay* decay = &decays_[i * 3];
+    ozz::math::SoaTransform& pose = _pose[i];
+
+    const SimdFloat4 ft = EvaluateDecay(decay[0].a, decay[0].b, decay[0].c,
+                                        decay[0].d, decay[0].v, decay[0].t1, t);
+    pose.translation = pose.translation + offset.translation * ft;
+
+    const SimdFloat4 fr = EvaluateDecay(decay[1].a, decay[1].b, decay[1].c,
+                                        decay[1].d, decay[1].v, decay[1].t1, t);
+    const SoaQuaternion rotation = {offset.rotation.x * fr,
+                                    offset.rotation.y * fr,
+                                    offset.rotation.z * fr, offset.rotation.w};
+    pose.rotation = ozz::math::Normalize(rotation) * pose.rotation;
+
+    const SimdFloat4 fs = EvaluateDecay(decay[2].a, decay[2].b, decay[2].c,
+                                        decay[2].d, decay[2].v, decay[2].t1, t);
+    pose.scale = pose.scale + offset.scale * fs;
+  }
+}
+}  // namespace game
@@ -15,6 +15,7 @@
 #include "ozz/base/io/stream.h"
 #include "ozz/base/log.h"
 #include "ozz/base/maths/box.h"
+#include "ozz/base/maths/simd_float3x4.h"
 #include "ozz/base/maths/simd_math_archive.h"
 #include "ozz/base/maths/simd_math.h"
 #include "ozz/base/maths/simd_quaternion.h"
@@ -74,6 +75,31 @@ bool LoadAnimation(const char* _filename, ozz::animation::Animation* _animation)
   return true;
 }
 
+bool LoadTrack(const char* _filename, ozz::animation::FloatTrack* _track) {
+  assert(_filename && _track);
+  ozz::log::Out() << "Loading track archive: " << _filename << "."
+                  << std::endl;
+  ozz::io::File file(_filename, "rb");
+  if (!file.opened()) {
+    ozz::log::Err() << "Failed to open track file " << _filename << "."
+                    << std::endl;
+    return false;
+  }
+  ozz::io::IArchive archive(&file);
+  if (!archive.TestTag<ozz::animation::FloatTrack>()) {
+    ozz::log::Err() << "Failed to load float track instance from file "
+                    << _filename << "." << std::endl;
+    return false;
+  }
+
+  // Once the tag is validated, reading cannot fail.
+  {
+    archive >> *_track;
+  }
+
+  return true;
+}
+
 bool LoadMeshes(const char* _filename, ozz::vector<game::Mesh>* _meshes) {
   assert(_filename && _meshes);
   ozz::log::Out() << "Loading meshes archive: " << _filename << "."
@@ -137,7 +163,12 @@ void Extern<game::Mesh>::Save(OArchive& _archive, const game::Mesh* _meshes,
     _archive << mesh.parts;
     _archive << mesh.triangle_indices;
     _archive << mesh.joint_remaps;
-    _archive << mesh.inverse_bind_poses;
+    ozz::vector<ozz::math::Float4x4> inverse_bind_poses;
+    inverse_bind_poses.reserve(mesh.inverse_bind_poses.size());
+    for (const ozz::math::Float3x4& pose : mesh.inverse_bind_poses) {
+      inverse_bind_poses.push_back(ozz::math::ToFloat4x4(pose));
+    }
+    _archive << inverse_bind_poses;
   }
 }
 
@@ -149,7 +180,13 @@ void Extern<game::Mesh>::Load(IArchive& _archive, game::Mesh* _meshes,
     _archive >> mesh.parts;
     _archive >> mesh.triangle_indices;
     _archive >> mesh.joint_remaps;
-    _archive >> mesh.inverse_bind_poses;
+    ozz::vector<ozz::math::Float4x4> inverse_bind_poses;
+    _archive >> inverse_bind_poses;
+    mesh.inverse_bind_poses.resize(inverse_bind_poses.size());
+    for (size_t j = 0; j < inverse_bind_poses.size(); ++j) {
+      mesh.inverse_bind_poses[j] =
+          ozz::math::Float3x4::FromFloat4x4(inverse_bind_poses[j]);
+    }
   }
 }
 }  // namespace io
@@ -0,0 +1,281 @@
+
+#include <cassert>
+#include <cmath>
+
+#include "ozz/animation/offline/animation_builder.h"
+#include "ozz/animation/offline/animation_optimizer.h"
+#include "ozz/animation/offline/raw_animation.h"
+#include "ozz/animation/offline/raw_skeleton.h"
+#include "ozz/animation/offline/skeleton_builder.h"
+#include "ozz/animation/runtime/animation.h"
+#include "ozz/animation/runtime/local_to_model_job.h"
+#include "ozz/animation/runtime/sampling_job.h"
+#include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/skeleton_utils.h"
+#include "ozz/base/log.h"
+#include "ozz/base/maths/math_ex.h"
+#include "ozz/base/maths/simd_float3x4.h"
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/maths/transform.h"
+
+#include "mesh/mesh.h"
+#include "lod/lod.h"
+
+namespace game {
+
+namespace {
+
+// Unpacks _joint transform from soa _transforms.
+ozz::math::Transform GetJointTransform(
+    const ozz::span<const ozz::math::SoaTransform>& _transforms, int _joint) {
+  const ozz::math::SoaTransform& soa_transform = _transforms[_joint / 4];
+
+  // Transpose SoA data to AoS.
+  ozz::math::SimdFloat4 translations[4];
+  ozz::math::Transpose3x4(&soa_transform.translation.x, translations);
+  ozz::math::SimdFloat4 rotations[4];
+  ozz::math::Transpose4x4(&soa_transform.rotation.x, rotations);
+  ozz::math::SimdFloat4 scales[4];
+  ozz::math::Transpose3x4(&soa_transform.scale.x, scales);
+
+  ozz::math::Transform transform;
+  const int offset = _joint % 4;
+  ozz::math::Store3PtrU(translations[offset], &transform.translation.x);
+  ozz::math::StorePtrU(rotations[offset], &transform.rotation.x);
+  ozz::math::Store3PtrU(scales[offset], &transform.scale.x);
+  return transform;
+}
+
+// Estimates _animation source sample rate (in hertz) from its closest
+// keyframes. Rounded to whole hertz, as keyframe times are stored as ratios.
+float EstimateSampleRate(const ozz::animation::Animation& _animation) {
+  const ozz::span<const float> timepoints = _animation.timepoints();
+  float interval = 1.f;
+  for (size_t i = 1; i < timepoints.size(); ++i) {
+    const float delta = timepoints[i] - timepoints[i - 1];
+    if (delta > 0.f && delta < interval) {
+      interval = delta;
+    }
+  }
+  const float duration = _animation.duration();
+  if (duration <= 0.f) {
+    return 1.f;
+  }
+  return ozz::math::Max(1.f, std::round(1.f / (interval * duration)));
+}
+
+// Adds _parent surviving children (and their hierarchy) to _children.
+void AddRawJoints(const ozz::animation::Skeleton& _skeleton,
+                  const ozz::vector<bool>& _alive, int _parent,
+                  ozz::animation::offline::RawSkeleton::Joint::Children*
+                      _children) {
+  const ozz::span<const int16_t>& parents = _skeleton.joint_parents();
+  for (int i = _parent + 1; i < _skeleton.num_joints(); ++i) {
+    if (parents[i] != _parent || !_alive[i]) {
+      continue;
+    }
+    _children->resize(_children->size() + 1);
+    ozz::animation::offline::RawSkeleton::Joint& joint = _children->back();
+    joint.name = _skeleton.joint_names()[i];
+    joint.transform = ozz::animation::GetJointLocalRestPose(_skeleton, i);
+    AddRawJoints(_skeleton, _alive, i, &joint.children);
+  }
+}
+}  // namespace
+
+bool BuildSkeletonLod(const ozz::animation::Skeleton& _skeleton,
+                      int _max_joints, SkeletonLod* _lod) {
+  assert(_lod);
+  const int num_joints = _skeleton.num_joints();
+  const ozz::span<const int16_t>& parents = _skeleton.joint_parents();
+
+  // Computes joints depth and number of children.
+  ozz::vector<int> depths(num_joints, 0);
+  ozz::vector<int> children(num_joints, 0);
+  for (int i = 0; i < num_joints; ++i) {
+    const int parent = parents[i];
+    if (parent != ozz::animation::Skeleton::kNoParent) {
+      depths[i] = depths[parent] + 1;
+      ++children[parent];
+    }
+  }
+
+  // Collapses the deepest leaf, until the joint budget is reached. Its parent
+  // might become a leaf in turn.
+  ozz::vector<bool> alive(num_joints, true);
+  for (int num_alive = num_joints; num_alive > _max_joints; --num_alive) {
+    int leaf = -1;
+    for (int i = 0; i < num_joints; ++i) {
+      if (alive[i] && children[i] == 0 &&
+          parents[i] != ozz::animation::Skeleton::kNoParent &&
+          (leaf == -1 || depths[i] >= depths[leaf])) {
+        leaf = i;
+      }
+    }
+    if (leaf == -1) {
+      break;  // Only roots remain.
+    }
+    alive[leaf] = false;
+    --children[parents[leaf]];
+  }
+
+  // Builds the reduced skeleton, with the same ordering as the original one.
+  ozz::animation::offline::RawSkeleton raw_skeleton;
+  AddRawJoints(_skeleton, alive, ozz::animation::Skeleton::kNoParent,
+               &raw_skeleton.roots);
+  ozz::animation::offline::SkeletonBuilder builder;
+  builder.breadth_first =
+      _skeleton.ordering() == ozz::animation::Skeleton::kBreadthFirst;
+  ozz::unique_ptr<ozz::animation::Skeleton> skeleton = builder(raw_skeleton);
+  if (!skeleton) {
+    ozz::log::Err() << "Failed to build skeleton LOD." << std::endl;
+    return false;
+  }
+  _lod->skeleton = std::move(*skeleton);
+
+  // Builder might reorder joints, so they're matched by name.
+  const int num_lod_joints = _lod->skeleton.num_joints();
+  _lod->tracks.resize(num_lod_joints);
+  _lod->joints.assign(num_joints, -1);
+  for (int i = 0; i < num_lod_joints; ++i) {
+    const int joint = ozz::animation::FindJoint(
+        _skeleton, _lod->skeleton.joint_names()[i]);
+    if (joint < 0 || _lod->joints[joint] != -1) {
+      ozz::log::Err() << "Skeleton LOD requires unique joint names."
+                      << std::endl;
+      return false;
+    }
+    _lod->tracks[i] = static_cast<int16_t>(joint);
+    _lod->joints[joint] = static_cast<int16_t>(i);
+  }
+
+  // Collapsed joints map to their parent's reduced joint. Parents are always
+  // before their children.
+  for (int i = 0; i < num_joints; ++i) {
+    if (_lod->joints[i] == -1) {
+      _lod->joints[i] = _lod->joints[parents[i]];
+    }
+  }
+
+  return true;
+}
+
+bool ResampleAnimation(const ozz::animation::Animation& _animation,
+                       const ozz::span<const int16_t>& _tracks,
+                       float _sample_rate,
+                       ozz::animation::offline::RawAnimation* _raw_animation) {
+  assert(_raw_animation);
+  ozz::animation::offline::RawAnimation& raw_animation = *_raw_animation;
+  const int num_tracks = _tracks.empty() ? _animation.num_tracks()
+                                         : static_cast<int>(_tracks.size());
+  raw_animation.duration = _animation.duration();
+  raw_animation.name = _animation.name();
+  raw_animation.tracks.clear();
+  raw_animation.tracks.resize(num_tracks);
+
+  // Samples all tracks at a constant rate, including first and last frames.
+  const float sample_rate =
+      _sample_rate > 0.f ? _sample_rate : EstimateSampleRate(_animation);
+  const int num_keys = ozz::math::Max(
+      2, static_cast<int>(std::ceil(_animation.duration() * sample_rate)) + 1);
+  ozz::animation::SamplingJob::Context context(_animation.num_tracks());
+  ozz::vector<ozz::math::SoaTransform> locals(_animation.num_soa_tracks());
+  for (int k = 0; k < num_keys; ++k) {
+    ozz::animation::SamplingJob sampling_job;
+    sampling_job.animation = &_animation;
+    sampling_job.context = &context;
+    sampling_job.ratio = static_cast<float>(k) / (num_keys - 1);
+    sampling_job.output = make_span(locals);
+    if (!sampling_job.Run()) {
+      return false;
+    }
+
+    const float time = sampling_job.ratio * _animation.duration();
+    for (int i = 0; i < num_tracks; ++i) {
+      const ozz::math::Transform transform = GetJointTransform(
+          make_span(locals), _tracks.empty() ? i : _tracks[i]);
+      ozz::animation::offline::RawAnimation::JointTrack& track =
+          raw_animation.tracks[i];
+      track.translations.push_back({time, transform.translation});
+      track.rotations.push_back({time, transform.rotation});
+      track.scales.push_back({time, transform.scale});
+    }
+  }
+  return true;
+}
+
+bool BuildAnimationLod(const ozz::animation::Animation& _animation,
+                       const SkeletonLod& _lod, float _sample_rate,
+                       ozz::animation::Animation* _lod_animation) {
+  assert(_lod_animation);
+  if (_animation.num_tracks() != static_cast<int>(_lod.joints.size())) {
+    ozz::log::Err() << "Animation doesn't match skeleton LOD." << std::endl;
+    return false;
+  }
+
+  ozz::animation::offline::RawAnimation raw_animation;
+  if (!ResampleAnimation(_animation, make_span(_lod.tracks), _sample_rate,
+                         &raw_animation)) {
+    return false;
+  }
+
+  // Removes redundant keys, then builds the runtime animation.
+  ozz::animation::offline::RawAnimation optimized_animation;
+  ozz::animation::offline::AnimationOptimizer optimizer;
+  if (!optimizer(raw_animation, _lod.skeleton, &optimized_animation)) {
+    ozz::log::Err() << "Failed to optimize animation LOD." << std::endl;
+    return false;
+  }
+  ozz::animation::offline::AnimationBuilder builder;
+  ozz::unique_ptr<ozz::animation::Animation> animation =
+      builder(optimized_animation);
+  if (!animation) {
+    ozz::log::Err() << "Failed to build animation LOD." << std::endl;
+    return false;
+  }
+  *_lod_animation = std::move(*animation);
+  return true;
+}
+
+bool BuildSkinLod(const Mesh& _mesh, const ozz::animation::Skeleton& _skeleton,
+                  const SkeletonLod& _lod, SkinLod* _skin) {
+  assert(_skin);
+  if (_skeleton.num_joints() != static_cast<int>(_lod.joints.size()) ||
+      _skeleton.num_joints() <= _mesh.highest_joint_index()) {
+    ozz::log::Err() << "Mesh doesn't match skeleton LOD." << std::endl;
+    return false;
+  }
+
+  // Rest pose model-space matrices.
+  ozz::vector<ozz::math::Float3x4> models(_skeleton.num_joints());
+  ozz::animation::LocalToModelJob ltm_job;
+  ltm_job.skeleton = &_skeleton;
+  ltm_job.input = _skeleton.joint_rest_poses();
+  ltm_job.output3x4 = make_span(models);
+  if (!ltm_job.Run()) {
+    return false;
+  }
+
+  // A collapsed joint model-space matrix is its surviving ancestor matrix
+  // multiplied by their rest pose relative transform. This transform is
+  // premultiplied to the inverse bind pose.
+  const size_t num_remaps = _mesh.joint_remaps.size();
+  _skin->joint_remaps.resize(num_remaps);
+  _skin->inverse_bind_poses.resize(num_remaps);
+  for (size_t i = 0; i < num_remaps; ++i) {
+    const int joint = _mesh.joint_remaps[i];
+    const int lod_joint = _lod.joints[joint];
+    const int ancestor = _lod.tracks[lod_joint];
+    _skin->joint_remaps[i] = static_cast<uint16_t>(lod_joint);
+    if (ancestor == joint) {
+      _skin->inverse_bind_poses[i] = _mesh.inverse_bind_poses[i];
+    } else {
+      _skin->inverse_bind_poses[i] = ozz::math::Invert(models[ancestor]) *
+                                     models[joint] *
+                                     _mesh.inverse_bind_poses[i];
+    }
+  }
+  return true;
+}
+}  // namespace game
@@ -0,0 +1,216 @@
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/skeleton_utils.h"
+#include "ozz/base/log.h"
+#include "ozz/base/maths/quaternion.h"
+#include "ozz/base/maths/simd_math.h"
+#include "ozz/base/maths/soa_float.h"
+#include "ozz/base/maths/soa_quaternion.h"
+#include "ozz/base/maths/soa_transform.h"
+#include "ozz/base/maths/transform.h"
+
+#include "blend/mirror.h"
+
+namespace game {
+
+namespace {
+using ozz::math::Quaternion;
+using ozz::math::SimdFloat4;
+using ozz::math::SoaFloat3;
+using ozz::math::SoaQuaternion;
+
+// SoaTransform is made of 10 SoA components (translation xyz, rotation xyzw
+// and scale xyz), so a joint is 10 floats 4 floats apart.
+const int kSoaTransformFloats = 40;
+static_assert(sizeof(ozz::math::SoaTransform) ==
+                  kSoaTransformFloats * sizeof(float),
+              "Unexpected SoaTransform layout");
+
+// Reflects rotation _q through _axis mirror plane: the rotation axis is
+// reflected and the angle negated, which negates the two other components.
+Quaternion Reflect(const Quaternion& _q, MirrorAxis _axis) {
+  switch (_axis) {
+    case kMirrorX:
+      return Quaternion(_q.x, -_q.y, -_q.z, _q.w);
+    case kMirrorY:
+      return Quaternion(-_q.x, _q.y, -_q.z, _q.w);
+    default:
+      return Quaternion(-_q.x, -_q.y, _q.z, _q.w);
+  }
+}
+
+// Packs 4 joints quaternions to a SoA quaternion.
+SoaQuaternion PackSoa(const Quaternion* _q) {
+  return SoaQuaternion::Load(
+      ozz::math::simd_float4::Load(_q[0].x, _q[1].x, _q[2].x, _q[3].x),
+      ozz::math::simd_float4::Load(_q[0].y, _q[1].y, _q[2].y, _q[3].y),
+      ozz::math::simd_float4::Load(_q[0].z, _q[1].z, _q[2].z, _q[3].z),
+      ozz::math::simd_float4::Load(_q[0].w, _q[1].w, _q[2].w, _q[3].w));
+}
+
+// Rotates _v by unit quaternion _q.
+SoaFloat3 TransformVector(const SoaQuaternion& _q, const SoaFloat3& _v) {
+  const SoaFloat3 axis = {_q.x, _q.y, _q.z};
+  const SoaFloat3 a = ozz::math::Cross(axis, _v) + _v * _q.w;
+  const SimdFloat4 two = ozz::math::simd_float4::Load1(2.f);
+  return _v + ozz::math::Cross(axis, a) * two;
+}
+}  // namespace
+
+bool BuildMirrorTable(const ozz::animation::Skeleton& _skeleton,
+                      MirrorAxis _axis, const char* _left, const char* _right,
+                      MirrorTable* _table) {
+  assert(_left && _right && _table);
+  if (*_left == 0 || *_right == 0) {
+    return false;
+  }
+
+  // Finds counterparts by name.
+  const int num_joints = _skeleton.num_joints();
+  const ozz::span<const char* const> names = _skeleton.joint_names();
+  const size_t left_length = std::strlen(_left);
+  const size_t right_length = std::strlen(_right);
+  ozz::vector<int16_t> joints(num_joints);
+  for (int i = 0; i < num_joints; ++i) {
+    std::string name = names[i];
+    size_t position = name.find(_left);
+    if (position != std::string::npos) {
+      name.replace(position, left_length, _right);
+    } else if ((position = name.find(_right)) != std::string::npos) {
+      name.replace(position, right_length, _left);
+    }
+    const int joint = position != std::string::npos
+                          ? ozz::animation::FindJoint(_skeleton, name.c_str())
+                          : i;
+    if (joint < 0) {
+      ozz::log::Err() << "No mirror counterpart for joint " << names[i] << "."
+                      << std::endl;
+      return false;
+    }
+    joints[i] = static_cast<int16_t>(joint);
+  }
+
+  // Mirroring local transforms requires counterparts to have counterpart
+  // parents.
+  const ozz::span<const int16_t> parents = _skeleton.joint_parents();
+  for (int i = 0; i < num_joints; ++i) {
+    const int parent = parents[i];
+    const int mirrored_parent = parents[joints[i]];
+    if (joints[joints[i]] != i ||
+        (parent == ozz::animation::Skeleton::kNoParent
+             ? mirrored_parent != ozz::animation::Skeleton::kNoParent
+             : mirrored_parent != joints[parent])) {
+      ozz::log::Err() << "Joint " << names[i]
+                      << " isn't symmetric to its mirror counterpart."
+                      << std::endl;
+      return false;
+    }
+  }
+
+  // The reflected model-space rest pose of a joint matches its counterpart
+  // one, up to a rotation if their local axes aren't mirror images. Parents
+  // are iterated before their children.
+  ozz::vector<Quaternion> models(num_joints);
+  for (int i = 0; i < num_joints; ++i) {
+    const Quaternion rotation =
+        ozz::animation::GetJointLocalRestPose(_skeleton, i).rotation;
+    models[i] = parents[i] == ozz::animation::Skeleton::kNoParent
+                    ? rotation
+                    : models[parents[i]] * rotation;
+  }
+  const int num_soa_joints = _skeleton.num_soa_joints();
+  ozz::vector<Quaternion> corrections(num_soa_joints * 4,
+                                      Quaternion::identity());
+  ozz::vector<Quaternion> parent_corrections(num_soa_joints * 4,
+                                             Quaternion::identity());
+  bool corrected = false;
+  for (int i = 0; i < num_joints; ++i) {
+    corrections[i] =
+        Conjugate(Reflect(models[joints[i]], _axis)) * models[i];
+    corrected |= std::abs(corrections[i].w) < 1.f - 1e-5f;
+  }
+  for (int i = 0; i < num_joints; ++i) {
+    if (parents[i] != ozz::animation::Skeleton::kNoParent) {
+      parent_corrections[i] = Conjugate(corrections[parents[i]]);
+    }
+  }
+
+  _table->axis = _axis;
+  _table->joints = joints;
+  _table->pairs.clear();
+  for (int i = 0; i < num_joints; ++i) {
+    if (i < joints[i]) {
+      _table->pairs.push_back(static_cast<int16_t>(i));
+      _table->pairs.push_back(joints[i]);
+    }
+  }
+  _table->corrections.clear();
+  _table->parent_corrections.clear();
+  if (corrected) {
+    for (int i = 0; i < num_soa_joints; ++i) {
+      _table->corrections.push_back(PackSoa(&corrections[i * 4]));
+      _table->parent_corrections.push_back(
+          PackSoa(&parent_corrections[i * 4]));
+    }
+  }
+  return true;
+}
+
+bool MirrorPose(const MirrorTable& _table,
+                const ozz::span<ozz::math::SoaTransform>& _pose) {
+  const size_t num_soa_joints = (_table.joints.size() + 3) / 4;
+  if (_pose.size() < num_soa_joints) {
+    return false;
+  }
+
+  // Exchanges counterparts lanes.
+  float* floats = reinterpret_cast<float*>(_pose.data());
+  for (size_t i = 0; i < _table.pairs.size(); i += 2) {
+    const int a = _table.pairs[i];
+    const int b = _table.pairs[i + 1];
+    float* a_floats = floats + (a / 4) * kSoaTransformFloats + (a & 3);
+    float* b_floats = floats + (b / 4) * kSoaTransformFloats + (b & 3);
+    for (int c = 0; c < kSoaTransformFloats; c += 4) {
+      const float swap = a_floats[c];
+      a_floats[c] = b_floats[c];
+      b_floats[c] = swap;
+    }
+  }
+
+  // Reflects translations and rotations, negating translation component
+  // along the axis, and rotation components across it.
+  const SimdFloat4 one = ozz::math::simd_float4::one();
+  const SimdFloat4 minus_one = -one;
+  const SoaFloat3 translation_signs = {
+      _table.axis == kMirrorX ? minus_one : one,
+      _table.axis == kMirrorY ? minus_one : one,
+      _table.axis == kMirrorZ ? minus_one : one};
+  const SoaFloat3 rotation_signs = {-translation_signs.x,
+                                    -translation_signs.y,
+                                    -translation_signs.z};
+  const bool corrected = !_table.corrections.empty();
+  for (size_t i = 0; i < num_soa_joints; ++i) {
+    ozz::math::SoaTransform& transform = _pose[i];
+    const SoaFloat3 translation = transform.translation * translation_signs;
+    const SoaQuaternion rotation = {transform.rotation.x * rotation_signs.x,
+                                    transform.rotation.y * rotation_signs.y,
+                                    transform.rotation.z * rotation_signs.z,
+                                    transform.rotation.w};
+    if (corrected) {
+      const SoaQuaternion& parent_correction = _table.parent_corrections[i];
+      transform.translation = TransformVector(parent_correction, translation);
+      transform.rotation =
+          parent_correction * rotation * _table.corrections[i];
+    } else {
+      transform.translation = translation;
+      transform.rotation = rotation;
+    }
+  }
+  return true;
+}
+}  // namespace game
@@ -127,6 +127,13 @@ struct QuaternionKey {
   static constexpr float kfScale = 1.f * kiScale;
 };
 
+// Defines the tangent key frame type of rotations, used by cubic Hermite
+// spline animations. Quaternion tangents aren't normalized, so the 4
+// components are stored as half precision floats.
+struct Float4Key {
+  uint16_t values[4];
+};
+
 // Endianness independent load and store
 inline void pack(int _largest, int _sign, const int _cpnt[3],
                  QuaternionKey* _key) {
@@ -150,6 +157,39 @@ inline void unpack(const QuaternionKey& _key, int& _biggest, int& _sign,
   _cpnt[2] = _key.values[2] >> 1;
 }
 
+// Variable bit-rate quantization of a keyed SoA track of float3 (translations
+// and scales). Keyframes of each of the 4 tracks are stored consecutively in a
+// bit stream. Each component is quantized on the same number of bits within
+// the track range, so that value = min + quantized * scale.
+struct Float3Quantization {
+  float min[3][4];
+  float scale[3][4];
+
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range [0,kMaxBits]. A
+  // keyframe is made of 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMaxBits = 16;
+};
+
+// Variable bit-rate quantization of a keyed SoA track of quaternions.
+// Keyframes use QuaternionKey bit layout (largest component index, sign, then
+// the 3 smallest components), with a number of bits per component chosen per
+// track.
+struct QuaternionQuantization {
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range
+  // [kMinBits,QuaternionKey::kBits]. A keyframe is made of 3 + 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMinBits = 4;
+};
+
 }  // namespace internal
 }  // namespace animation
 }  // namespace ozz
@@ -159,7 +199,13 @@ inline void unpack(const QuaternionKey& _key, int& _biggest, int& _sign,
 namespace ozz {
 namespace animation {
 
-Animation::Animation() : duration_(0.f), num_tracks_(0), name_(nullptr) {}
+Animation::Animation()
+    : duration_(0.f),
+      num_tracks_(0),
+      name_(nullptr),
+      translations_constants_{{}, {}, 0},
+      rotations_constants_{{}, {}, 0},
+      scales_constants_{{}, {}, 0} {}
 
 Animation::Animation(Animation&& _other) { *this = std::move(_other); }
 
@@ -174,6 +220,15 @@ Animation& Animation::operator=(Animation&& _other) {
   std::swap(translations_values_, _other.translations_values_);
   std::swap(rotations_values_, _other.rotations_values_);
   std::swap(scales_values_, _other.scales_values_);
+  std::swap(translations_constants_, _other.translations_constants_);
+  std::swap(rotations_constants_, _other.rotations_constants_);
+  std::swap(scales_constants_, _other.scales_constants_);
+  std::swap(translations_quantization_, _other.translations_quantization_);
+  std::swap(rotations_quantization_, _other.rotations_quantization_);
+  std::swap(scales_quantization_, _other.scales_quantization_);
+  std::swap(translations_tangents_, _other.translations_tangents_);
+  std::swap(rotations_tangents_, _other.rotations_tangents_);
+  std::swap(scales_tangents_, _other.scales_tangents_);
 
   return *this;
 }
@@ -184,11 +239,15 @@ void Animation::Allocate(const AllocateParams& _params) {
   // Distributes buffer memory while ensuring proper alignment (serves larger
   // alignment values first).
   static_assert(
-      alignof(float) >= alignof(uint32_t) &&
+      alignof(float) >= alignof(internal::Float3Quantization) &&
+          alignof(internal::Float3Quantization) >=
+              alignof(internal::QuaternionQuantization) &&
+          alignof(internal::QuaternionQuantization) >= alignof(uint32_t) &&
           alignof(uint32_t) >= alignof(uint16_t) &&
           alignof(uint16_t) >= alignof(internal::Float3Key) &&
           alignof(internal::Float3Key) >= alignof(internal::QuaternionKey) &&
-          alignof(internal::QuaternionKey) >= alignof(char),
+          alignof(internal::QuaternionKey) >= alignof(internal::Float4Key) &&
+          alignof(internal::Float4Key) >= alignof(char),
       "Must serve larger alignment values first)");
 
   assert(timepoints_.empty() && "Animation must be unallocated");
@@ -200,21 +259,48 @@ void Animation::Allocate(const AllocateParams& _params) {
           ? sizeof(uint8_t)
           : sizeof(uint16_t);
   const size_t sizeof_previous = sizeof(uint16_t);
+
+  // Fixed precision keyframes values aren't stored when variable bit-rate
+  // format is used.
+  const size_t translation_values =
+      _params.translation_quantization.tracks ? 0 : _params.translations;
+  const size_t rotation_values =
+      _params.rotation_quantization.tracks ? 0 : _params.rotations;
+  const size_t scale_values =
+      _params.scale_quantization.tracks ? 0 : _params.scales;
+
   const size_t buffer_size =
       (_params.name_len > 0 ? _params.name_len + 1 : 0) +
       _params.timepoints * sizeof(float) +
-      _params.translations *
-          (sizeof(internal::Float3Key) + sizeof_ratio + sizeof_previous) +
-      _params.rotations *
-          (sizeof(internal::QuaternionKey) + sizeof_ratio + sizeof_previous) +
-      _params.scales *
-          (sizeof(internal::Float3Key) + sizeof_ratio + sizeof_previous) +
+      _params.translations * (sizeof_ratio + sizeof_previous) +
+      translation_values * sizeof(internal::Float3Key) +
+      _params.rotations * (sizeof_ratio + sizeof_previous) +
+      rotation_values * sizeof(internal::QuaternionKey) +
+      _params.scales * (sizeof_ratio + sizeof_previous) +
+      scale_values * sizeof(internal::Float3Key) +
       _params.translation_iframes.entries * sizeof(byte) +
       _params.translation_iframes.offsets * sizeof(uint32_t) +
       _params.rotation_iframes.entries * sizeof(byte) +
       _params.rotation_iframes.offsets * sizeof(uint32_t) +
       _params.scale_iframes.entries * sizeof(byte) +
-      _params.scale_iframes.offsets * sizeof(uint32_t);
+      _params.scale_iframes.offsets * sizeof(uint32_t) +
+      _params.translation_constants.flags * sizeof(byte) +
+      _params.translation_constants.values * sizeof(float) +
+      _params.rotation_constants.flags * sizeof(byte) +
+      _params.rotation_constants.values * sizeof(float) +
+      _params.scale_constants.flags * sizeof(byte) +
+      _params.scale_constants.values * sizeof(float) +
+      _params.translation_quantization.tracks *
+          sizeof(internal::Float3Quantization) +
+      _params.translation_quantization.stream * sizeof(byte) +
+      _params.rotation_quantization.tracks *
+          sizeof(internal::QuaternionQuantization) +
+      _params.rotation_quantization.stream * sizeof(byte) +
+      _params.scale_quantization.tracks * sizeof(internal::Float3Quantization) +
+      _params.scale_quantization.stream * sizeof(byte) +
+      _params.translation_tangents * sizeof(internal::Float3Key) +
+      _params.rotation_tangents * sizeof(internal::Float4Key) +
+      _params.scale_tangents * sizeof(internal::Float3Key);
   span<byte> buffer = {static_cast<byte*>(memory::default_allocator()->Allocate(
                            buffer_size, alignof(float))),
                        buffer_size};
@@ -223,12 +309,25 @@ void Animation::Allocate(const AllocateParams& _params) {
 
   // 32b alignment
   timepoints_ = fill_span<float>(buffer, _params.timepoints);
+  translations_quantization_.tracks = fill_span<internal::Float3Quantization>(
+      buffer, _params.translation_quantization.tracks);
+  scales_quantization_.tracks = fill_span<internal::Float3Quantization>(
+      buffer, _params.scale_quantization.tracks);
+  rotations_quantization_.tracks =
+      fill_span<internal::QuaternionQuantization>(
+          buffer, _params.rotation_quantization.tracks);
   translations_ctrl_.iframe_desc =
       fill_span<uint32_t>(buffer, _params.translation_iframes.offsets);
   rotations_ctrl_.iframe_desc =
       fill_span<uint32_t>(buffer, _params.rotation_iframes.offsets);
   scales_ctrl_.iframe_desc =
       fill_span<uint32_t>(buffer, _params.scale_iframes.offsets);
+  translations_constants_.values =
+      fill_span<float>(buffer, _params.translation_constants.values);
+  rotations_constants_.values =
+      fill_span<float>(buffer, _params.rotation_constants.values);
+  scales_constants_.values =
+      fill_span<float>(buffer, _params.scale_constants.values);
 
   // 16b alignment
   translations_ctrl_.previouses =
@@ -236,10 +335,16 @@ void Animation::Allocate(const AllocateParams& _params) {
   rotations_ctrl_.previouses = fill_span<uint16_t>(buffer, _params.rotations);
   scales_ctrl_.previouses = fill_span<uint16_t>(buffer, _params.scales);
   translations_values_ =
-      fill_span<internal::Float3Key>(buffer, _params.translations);
+      fill_span<internal::Float3Key>(buffer, translation_values);
   rotations_values_ =
-      fill_span<internal::QuaternionKey>(buffer, _params.rotations);
-  scales_values_ = fill_span<internal::Float3Key>(buffer, _params.scales);
+      fill_span<internal::QuaternionKey>(buffer, rotation_values);
+  scales_values_ = fill_span<internal::Float3Key>(buffer, scale_values);
+  translations_tangents_ =
+      fill_span<internal::Float3Key>(buffer, _params.translation_tangents);
+  rotations_tangents_ =
+      fill_span<internal::Float4Key>(buffer, _params.rotation_tangents);
+  scales_tangents_ =
+      fill_span<internal::Float3Key>(buffer, _params.scale_tangents);
 
   // 16b / 8b alignment
   translations_ctrl_.ratios =
@@ -249,6 +354,18 @@ void Animation::Allocate(const AllocateParams& _params) {
   scales_ctrl_.ratios = fill_span<byte>(buffer, _params.scales * sizeof_ratio);
 
   // 8b alignment
+  translations_constants_.flags =
+      fill_span<byte>(buffer, _params.translation_constants.flags);
+  rotations_constants_.flags =
+      fill_span<byte>(buffer, _params.rotation_constants.flags);
+  scales_constants_.flags =
+      fill_span<byte>(buffer, _params.scale_constants.flags);
+  translations_quantization_.stream =
+      fill_span<byte>(buffer, _params.translation_quantization.stream);
+  rotations_quantization_.stream =
+      fill_span<byte>(buffer, _params.rotation_quantization.stream);
+  scales_quantization_.stream =
+      fill_span<byte>(buffer, _params.scale_quantization.stream);
 
   // iframe_entries are compressed with gv4, they must not be at the end of the
   // buffer, as gv4 will access 3 bytes further than compressed entries.
@@ -280,6 +397,15 @@ void Animation::Deallocate() {
   translations_values_ = {};
   rotations_values_ = {};
   scales_values_ = {};
+  translations_constants_ = {{}, {}, 0};
+  rotations_constants_ = {{}, {}, 0};
+  scales_constants_ = {{}, {}, 0};
+  translations_quantization_ = {};
+  rotations_quantization_ = {};
+  scales_quantization_ = {};
+  translations_tangents_ = {};
+  rotations_tangents_ = {};
+  scales_tangents_ = {};
 }
 
 size_t Animation::size() const {
@@ -287,7 +413,12 @@ size_t Animation::size() const {
       sizeof(*this) + timepoints_.size_bytes() +
       translations_ctrl_.size_bytes() + rotations_ctrl_.size_bytes() +
       scales_ctrl_.size_bytes() + translations_values_.size_bytes() +
-      rotations_values_.size_bytes() + scales_values_.size_bytes();
+      rotations_values_.size_bytes() + scales_values_.size_bytes() +
+      translations_constants_.size_bytes() + rotations_constants_.size_bytes() +
+      scales_constants_.size_bytes() + translations_quantization_.size_bytes() +
+      rotations_quantization_.size_bytes() + scales_quantization_.size_bytes() +
+      translations_tangents_.size_bytes() + rotations_tangents_.size_bytes() +
+      scales_tangents_.size_bytes();
   return size;
 }
 }  // namespace animation
@@ -355,6 +486,70 @@ struct Extern<animation::internal::QuaternionKey> {
                                    OZZ_ARRAY_SIZE(_keys->values) * _count);
   }
 };
+OZZ_IO_TYPE_NOT_VERSIONABLE(animation::internal::Float4Key)
+template <>
+struct Extern<animation::internal::Float4Key> {
+  static void Save(OArchive& _archive,
+                   const animation::internal::Float4Key* _keys, size_t _count) {
+    _archive << ozz::io::MakeArray(_keys->values,
+                                   OZZ_ARRAY_SIZE(_keys->values) * _count);
+  }
+  static void Load(IArchive& _archive, animation::internal::Float4Key* _keys,
+                   size_t _count, uint32_t _version) {
+    (void)_version;
+    _archive >> ozz::io::MakeArray(_keys->values,
+                                   OZZ_ARRAY_SIZE(_keys->values) * _count);
+  }
+};
+
+OZZ_IO_TYPE_NOT_VERSIONABLE(animation::internal::Float3Quantization)
+template <>
+struct Extern<animation::internal::Float3Quantization> {
+  static void Save(OArchive& _archive,
+                   const animation::internal::Float3Quantization* _tracks,
+                   size_t _count) {
+    for (size_t i = 0; i < _count; ++i) {
+      const animation::internal::Float3Quantization& track = _tracks[i];
+      _archive << ozz::io::MakeArray(&track.min[0][0], 3 * 4);
+      _archive << ozz::io::MakeArray(&track.scale[0][0], 3 * 4);
+      _archive << ozz::io::MakeArray(track.offset);
+      _archive << ozz::io::MakeArray(track.bits);
+    }
+  }
+  static void Load(IArchive& _archive,
+                   animation::internal::Float3Quantization* _tracks,
+                   size_t _count, uint32_t _version) {
+    (void)_version;
+    for (size_t i = 0; i < _count; ++i) {
+      animation::internal::Float3Quantization& track = _tracks[i];
+      _archive >> ozz::io::MakeArray(&track.min[0][0], 3 * 4);
+      _archive >> ozz::io::MakeArray(&track.scale[0][0], 3 * 4);
+      _archive >> ozz::io::MakeArray(track.offset);
+      _archive >> ozz::io::MakeArray(track.bits);
+    }
+  }
+};
+OZZ_IO_TYPE_NOT_VERSIONABLE(animation::internal::QuaternionQuantization)
+template <>
+struct Extern<animation::internal::QuaternionQuantization> {
+  static void Save(OArchive& _archive,
+                   const animation::internal::QuaternionQuantization* _tracks,
+                   size_t _count) {
+    for (size_t i = 0; i < _count; ++i) {
+      _archive << ozz::io::MakeArray(_tracks[i].offset);
+      _archive << ozz::io::MakeArray(_tracks[i].bits);
+    }
+  }
+  static void Load(IArchive& _archive,
+                   animation::internal::QuaternionQuantization* _tracks,
+                   size_t _count, uint32_t _version) {
+    (void)_version;
+    for (size_t i = 0; i < _count; ++i) {
+      _archive >> ozz::io::MakeArray(_tracks[i].offset);
+      _archive >> ozz::io::MakeArray(_tracks[i].bits);
+    }
+  }
+};
 }  // namespace io
 namespace animation {
 void Animation::Save(ozz::io::OArchive& _archive) const {
@@ -366,11 +561,11 @@ void Animation::Save(ozz::io::OArchive& _archive) const {
 
   const size_t timepoints_count = timepoints_.size();
   _archive << static_cast<uint32_t>(timepoints_count);
-  const size_t translation_count = translations_values_.size();
+  const size_t translation_count = translations_ctrl_.previouses.size();
   _archive << static_cast<uint32_t>(translation_count);
-  const size_t rotation_count = rotations_values_.size();
+  const size_t rotation_count = rotations_ctrl_.previouses.size();
   _archive << static_cast<uint32_t>(rotation_count);
-  const size_t scale_count = scales_values_.size();
+  const size_t scale_count = scales_ctrl_.previouses.size();
   _archive << static_cast<uint32_t>(scale_count);
   const size_t t_iframe_entries_count =
       translations_ctrl_.iframe_entries.size();
@@ -385,6 +580,22 @@ void Animation::Save(ozz::io::OArchive& _archive) const {
   _archive << static_cast<uint32_t>(s_iframe_entries_count);
   const size_t s_iframe_desc_count = scales_ctrl_.iframe_desc.size();
   _archive << static_cast<uint32_t>(s_iframe_desc_count);
+  const Constants* constants[] = {&translations_constants_,
+                                  &rotations_constants_, &scales_constants_};
+  for (const Constants* c : constants) {
+    _archive << static_cast<uint32_t>(c->num_keyed_soa_tracks);
+    _archive << static_cast<uint32_t>(c->flags.size());
+    _archive << static_cast<uint32_t>(c->values.size());
+  }
+  _archive << static_cast<uint32_t>(translations_quantization_.tracks.size());
+  _archive << static_cast<uint32_t>(translations_quantization_.stream.size());
+  _archive << static_cast<uint32_t>(rotations_quantization_.tracks.size());
+  _archive << static_cast<uint32_t>(rotations_quantization_.stream.size());
+  _archive << static_cast<uint32_t>(scales_quantization_.tracks.size());
+  _archive << static_cast<uint32_t>(scales_quantization_.stream.size());
+  _archive << static_cast<uint32_t>(translations_tangents_.size());
+  _archive << static_cast<uint32_t>(rotations_tangents_.size());
+  _archive << static_cast<uint32_t>(scales_tangents_.size());
 
   _archive << ozz::io::MakeArray(name_, name_len);
   _archive << ozz::io::MakeArray(timepoints_);
@@ -395,6 +606,22 @@ void Animation::Save(ozz::io::OArchive& _archive) const {
   _archive << io::MakeArray(rotations_values_);
   _archive << scales_ctrl_;
   _archive << io::MakeArray(scales_values_);
+
+  for (const Constants* c : constants) {
+    _archive << io::MakeArray(c->flags);
+    _archive << io::MakeArray(c->values);
+  }
+
+  _archive << io::MakeArray(translations_quantization_.tracks);
+  _archive << io::MakeArray(translations_quantization_.stream);
+  _archive << io::MakeArray(rotations_quantization_.tracks);
+  _archive << io::MakeArray(rotations_quantization_.stream);
+  _archive << io::MakeArray(scales_quantization_.tracks);
+  _archive << io::MakeArray(scales_quantization_.stream);
+
+  _archive << io::MakeArray(translations_tangents_);
+  _archive << io::MakeArray(rotations_tangents_);
+  _archive << io::MakeArray(scales_tangents_);
 }
 
 void Animation::Load(ozz::io::IArchive& _archive, uint32_t _version) {
@@ -403,8 +630,9 @@ void Animation::Load(ozz::io::IArchive& _archive, uint32_t _version) {
   duration_ = 0.f;
   num_tracks_ = 0;
 
-  // No retro-compatibility with anterior versions.
-  if (_version != 7) {
+  // Versions 7 to 9 are still supported, as they only lack constant tracks,
+  // variable bit-rate keyframes or tangents.
+  if (_version < 7 || _version > 10) {
     log::Err() << "Unsupported animation version " << _version << "."
                << std::endl;
     return;
@@ -439,6 +667,35 @@ void Animation::Load(ozz::io::IArchive& _archive, uint32_t _version) {
   uint32_t s_iframe_desc_count;
   _archive >> s_iframe_desc_count;
 
+  // Versions prior to 8 have no constant track, all tracks are keyed.
+  uint32_t constants_counts[3][3];
+  for (auto& counts : constants_counts) {
+    counts[0] = static_cast<uint32_t>(num_soa_tracks());
+    counts[1] = counts[2] = 0;
+    if (_version >= 8) {
+      _archive >> counts[0];
+      _archive >> counts[1];
+      _archive >> counts[2];
+    }
+  }
+
+  // Versions prior to 9 only have fixed precision keyframes.
+  uint32_t quantization_counts[3][2] = {};
+  if (_version >= 9) {
+    for (auto& counts : quantization_counts) {
+      _archive >> counts[0];
+      _archive >> counts[1];
+    }
+  }
+
+  // Versions prior to 10 only have linearly interpolated keyframes.
+  uint32_t tangents_counts[3] = {};
+  if (_version >= 10) {
+    for (uint32_t& count : tangents_counts) {
+      _archive >> count;
+    }
+  }
+
   const AllocateParams params{name_len,
                               timepoints_count,
                               translation_count,
@@ -446,7 +703,19 @@ void Animation::Load(ozz::io::IArchive& _archive, uint32_t _version) {
                               scale_count,
                               {t_iframe_entries_count, t_iframe_desc_count},
                               {r_iframe_entries_count, r_iframe_desc_count},
-                              {s_iframe_entries_count, s_iframe_desc_count}};
+                              {s_iframe_entries_count, s_iframe_desc_count},
+                              {constants_counts[0][1], constants_counts[0][2]},
+                              {constants_counts[1][1], constants_counts[1][2]},
+                              {constants_counts[2][1], constants_counts[2][2]},
+                              {quantization_counts[0][0],
+                               quantization_counts[0][1]},
+                              {quantization_counts[1][0],
+                               quantization_counts[1][1]},
+                              {quantization_counts[2][0],
+                               quantization_counts[2][1]},
+                              tangents_counts[0],
+                              tangents_counts[1],
+                              tangents_counts[2]};
   Allocate(params);
 
   if (name_) {  // nullptr name_ is supported.
@@ -462,6 +731,26 @@ void Animation::Load(ozz::io::IArchive& _archive, uint32_t _version) {
   _archive >> io::MakeArray(rotations_values_);
   _archive >> scales_ctrl_;
   _archive >> io::MakeArray(scales_values_);
+
+  Constants* constants[] = {&translations_constants_, &rotations_constants_,
+                            &scales_constants_};
+  for (int i = 0; i < 3; ++i) {
+    constants[i]->num_keyed_soa_tracks =
+        static_cast<int>(constants_counts[i][0]);
+    _archive >> io::MakeArray(constants[i]->flags);
+    _archive >> io::MakeArray(constants[i]->values);
+  }
+
+  _archive >> io::MakeArray(translations_quantization_.tracks);
+  _archive >> io::MakeArray(translations_quantization_.stream);
+  _archive >> io::MakeArray(rotations_quantization_.tracks);
+  _archive >> io::MakeArray(rotations_quantization_.stream);
+  _archive >> io::MakeArray(scales_quantization_.tracks);
+  _archive >> io::MakeArray(scales_quantization_.stream);
+
+  _archive >> io::MakeArray(translations_tangents_);
+  _archive >> io::MakeArray(rotations_tangents_);
+  _archive >> io::MakeArray(scales_tangents_);
 }
 }  // namespace animation
 }  // namespace ozz
@@ -583,6 +872,13 @@ struct QuaternionKey {
   static constexpr float kfScale = 1.f * kiScale;
 };
 
+// Defines the tangent key frame type of rotations, used by cubic Hermite
+// spline animations. Quaternion tangents aren't normalized, so the 4
+// components are stored as half precision floats.
+struct Float4Key {
+  uint16_t values[4];
+};
+
 // Endianness independent load and store
 inline void pack(int _largest, int _sign, const int _cpnt[3],
                  QuaternionKey* _key) {
@@ -606,6 +902,39 @@ inline void unpack(const QuaternionKey& _key, int& _biggest, int& _sign,
   _cpnt[2] = _key.values[2] >> 1;
 }
 
+// Variable bit-rate quantization of a keyed SoA track of float3 (translations
+// and scales). Keyframes of each of the 4 tracks are stored consecutively in a
+// bit stream. Each component is quantized on the same number of bits within
+// the track range, so that value = min + quantized * scale.
+struct Float3Quantization {
+  float min[3][4];
+  float scale[3][4];
+
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range [0,kMaxBits]. A
+  // keyframe is made of 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMaxBits = 16;
+};
+
+// Variable bit-rate quantization of a keyed SoA track of quaternions.
+// Keyframes use QuaternionKey bit layout (largest component index, sign, then
+// the 3 smallest components), with a number of bits per component chosen per
+// track.
+struct QuaternionQuantization {
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range
+  // [kMinBits,QuaternionKey::kBits]. A keyframe is made of 3 + 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMinBits = 4;
+};
+
 }  // namespace internal
 }  // namespace animation
 }  // namespace ozz
@@ -616,13 +945,26 @@ namespace ozz {
 namespace animation {
 
 inline int CountKeyframesImpl(const Animation::KeyframesCtrlConst& _ctrl,
+                              const Animation::ConstantsConst& _constants,
                               int _track) {
   if (_track < 0) {
     return static_cast<int>(_ctrl.previouses.size());
   }
 
+  // Constant tracks have no keyframe.
+  const int soa_track = _track / 4;
+  if (_constants.constant(soa_track) || _ctrl.previouses.empty()) {
+    return 0;
+  }
+
+  // Remaps track index to keyed tracks.
+  int keyed_soa_track = 0;
+  for (int i = 0; i < soa_track; ++i) {
+    keyed_soa_track += !_constants.constant(i);
+  }
+
   int count = 1;
-  size_t previous = static_cast<size_t>(_track);
+  size_t previous = static_cast<size_t>(keyed_soa_track * 4 + (_track & 3));
   for (size_t i = previous + 1; i < _ctrl.previouses.size(); ++i) {
     if (i - _ctrl.previouses[i] == previous) {
       ++count;
@@ -633,13 +975,16 @@ inline int CountKeyframesImpl(const Animation::KeyframesCtrlConst& _ctrl,
 }
 
 int CountTranslationKeyframes(const Animation& _animation, int _track) {
-  return CountKeyframesImpl(_animation.translations_ctrl(), _track);
+  return CountKeyframesImpl(_animation.translations_ctrl(),
+                            _animation.translations_constants(), _track);
 }
 int CountRotationKeyframes(const Animation& _animation, int _track) {
-  return CountKeyframesImpl(_animation.rotations_ctrl(), _track);
+  return CountKeyframesImpl(_animation.rotations_ctrl(),
+                            _animation.rotations_constants(), _track);
 }
 int CountScaleKeyframes(const Animation& _animation, int _track) {
-  return CountKeyframesImpl(_animation.scales_ctrl(), _track);
+  return CountKeyframesImpl(_animation.scales_ctrl(),
+                            _animation.scales_constants(), _track);
 }
 }  // namespace animation
 }  // namespace ozz
@@ -740,97 +1085,386 @@ bool BlendingJob::Validate() const {
 
 namespace {
 
-// Macro that defines the process of blending the 1st pass.
-#define OZZ_BLEND_1ST_PASS(_in, _simd_weight, _out)    \
-  do {                                                 \
-    _out.translation = _in.translation * _simd_weight; \
-    _out.rotation = _in.rotation * _simd_weight;       \
-    _out.scale = _in.scale * _simd_weight;             \
-  } while (void(0), 0)
-
-// Macro that defines the process of blending any pass but the first.
-#define OZZ_BLEND_N_PASS(_in, _simd_weight, _out)                             \
-  do {                                                                        \
-    /* Blends translation. */                                                 \
-    _out.translation = _out.translation + _in.translation * _simd_weight;     \
-    /* Blends rotations, negates opposed quaternions to be sure to choose*/   \
-    /* the shortest path between the two.*/                                   \
-    const math::SimdInt4 sign = math::Sign(Dot(_out.rotation, _in.rotation)); \
-    const math::SoaQuaternion rotation = {                                    \
-        math::Xor(_in.rotation.x, sign), math::Xor(_in.rotation.y, sign),     \
-        math::Xor(_in.rotation.z, sign), math::Xor(_in.rotation.w, sign)};    \
-    _out.rotation = _out.rotation + rotation * _simd_weight;                  \
-    /* Blends scales.*/                                                       \
-    _out.scale = _out.scale + _in.scale * _simd_weight;                       \
-  } while (void(0), 0)
-
-// Macro that defines the process of adding a pass.
-#define OZZ_ADD_PASS(_in, _simd_weight, _out)                               \
-  do {                                                                      \
-    _out.translation = _out.translation + _in.translation * _simd_weight;   \
-    /* Interpolate quaternion between identity and src.rotation.*/          \
-    /* Quaternion sign is fixed up, so that lerp takes the shortest path.*/ \
-    const math::SimdInt4 sign = math::Sign(_in.rotation.w);                 \
-    const math::SoaQuaternion interp_quat = {                               \
-        math::Xor(_in.rotation.x, sign) * _simd_weight,                     \
-        math::Xor(_in.rotation.y, sign) * _simd_weight,                     \
-        math::Xor(_in.rotation.z, sign) * _simd_weight,                     \
-        (math::Xor(_in.rotation.w, sign) - one) * _simd_weight + one};      \
-    _out.rotation = _out.rotation * NormalizeEst(interp_quat);              \
-    _out.scale.x = _out.scale.x *                                           \
-                   math::MAdd(_in.scale.x, _simd_weight, one_minus_weight); \
-    _out.scale.y = _out.scale.y *                                           \
-                   math::MAdd(_in.scale.y, _simd_weight, one_minus_weight); \
-    _out.scale.z = _out.scale.z *                                           \
-                   math::MAdd(_in.scale.z, _simd_weight, one_minus_weight); \
-  } while (void(0), 0)
-
-// Macro that defines the process of subtracting a pass.
-#define OZZ_SUB_PASS(_in, _simd_weight, _out)                                  \
-  do {                                                                         \
-    _out.translation = _out.translation - _in.translation * _simd_weight;      \
-    /* Interpolate quaternion between identity and src.rotation.*/             \
-    /* Quaternion sign is fixed up, so that lerp takes the shortest path.*/    \
-    const math::SimdInt4 sign = math::Sign(_in.rotation.w);                    \
-    const math::SoaQuaternion interp_quat = {                                  \
-        math::Xor(_in.rotation.x, sign) * _simd_weight,                        \
-        math::Xor(_in.rotation.y, sign) * _simd_weight,                        \
-        math::Xor(_in.rotation.z, sign) * _simd_weight,                        \
-        (math::Xor(_in.rotation.w, sign) - one) * _simd_weight + one};         \
-    _out.rotation = _out.rotation * Conjugate(NormalizeEst(interp_quat));      \
-    _out.scale.x =                                                             \
-        _out.scale.x *                                                         \
-        math::RcpEst(math::MAdd(_in.scale.x, _simd_weight, one_minus_weight)); \
-    _out.scale.y =                                                             \
-        _out.scale.y *                                                         \
-        math::RcpEst(math::MAdd(_in.scale.y, _simd_weight, one_minus_weight)); \
-    _out.scale.z =                                                             \
-        _out.scale.z *                                                         \
-        math::RcpEst(math::MAdd(_in.scale.z, _simd_weight, one_minus_weight)); \
-  } while (void(0), 0)
-
-// Defines parameters that are passed through blending stages.
+// Blending is processed by blocks of SoA joints, running all the stages on a
+// block (layers, rest pose, normalization and additive layers) before moving
+// to the next one. The block stays in registers through all the stages, so
+// output memory is written once whatever the number of layers. A partial layer
+// is skipped for the blocks where all its joint weights are zero.
+// Stages are implemented once, for any block width. The width and its math
+// are defined by lanes traits: Lanes4 processes one SoaTransform (4 joints)
+// using ozz math library, Lanes8 processes two (8 joints) using AVX.
+
+// Block of SoA transforms components. Templated on lanes traits rather than on
+// their SIMD type, whose alignment attributes would be ignored as a template
+// argument.
+template <typename _Lanes>
+struct SoaBlock {
+  typedef typename _Lanes::Value Value;
+  Value tx, ty, tz;
+  Value rx, ry, rz, rw;
+  Value sx, sy, sz;
+};
+
+// 4 joints lanes, using ozz math library.
+struct Lanes4 {
+  typedef math::SimdFloat4 Value;
+  typedef math::SimdInt4 Mask;
+  typedef SoaBlock<Lanes4> Block;
+
+  // Number of SoaTransform per block.
+  static const size_t kWidth = 1;
+
+  static OZZ_INLINE void Load(const math::SoaTransform* _in, Block* _out) {
+    _out->tx = _in->translation.x;
+    _out->ty = _in->translation.y;
+    _out->tz = _in->translation.z;
+    _out->rx = _in->rotation.x;
+    _out->ry = _in->rotation.y;
+    _out->rz = _in->rotation.z;
+    _out->rw = _in->rotation.w;
+    _out->sx = _in->scale.x;
+    _out->sy = _in->scale.y;
+    _out->sz = _in->scale.z;
+  }
+
+  static OZZ_INLINE void Store(const Block& _in, math::SoaTransform* _out) {
+    const math::SoaTransform out = {{_in.tx, _in.ty, _in.tz},
+                                    {_in.rx, _in.ry, _in.rz, _in.rw},
+                                    {_in.sx, _in.sy, _in.sz}};
+    *_out = out;
+  }
+
+  static OZZ_INLINE Value LoadWeights(const math::SimdFloat4* _weights) {
+    return *_weights;
+  }
+
+  static OZZ_INLINE Value Load1(float _f) {
+    return math::simd_float4::Load1(_f);
+  }
+  static OZZ_INLINE Value Add(Value _a, Value _b) { return _a + _b; }
+  static OZZ_INLINE Value Sub(Value _a, Value _b) { return _a - _b; }
+  static OZZ_INLINE Value Mul(Value _a, Value _b) { return _a * _b; }
+  static OZZ_INLINE Value MAdd(Value _a, Value _b, Value _c) {
+    return math::MAdd(_a, _b, _c);
+  }
+  static OZZ_INLINE Value Neg(Value _v) { return -_v; }
+  static OZZ_INLINE Value Max(Value _a, Value _b) { return math::Max(_a, _b); }
+  static OZZ_INLINE Value Max0(Value _v) { return math::Max0(_v); }
+  static OZZ_INLINE Value RcpEst(Value _v) { return math::RcpEst(_v); }
+  static OZZ_INLINE Value RcpEstNR(Value _v) { return math::RcpEstNR(_v); }
+  static OZZ_INLINE Value RSqrtEstNR(Value _v) {
+    return math::RSqrtEstNR(_v);
+  }
+  static OZZ_INLINE Mask Sign(Value _v) { return math::Sign(_v); }
+  static OZZ_INLINE Value Xor(Value _v, Mask _mask) {
+    return math::Xor(_v, _mask);
+  }
+
+  // Returns true if any component of _v is greater than 0.
+  static OZZ_INLINE bool AnyPositive(Value _v) {
+    return !math::AreAllFalse(math::CmpGt(_v, math::simd_float4::zero()));
+  }
+};
+
+#if defined(OZZ_SIMD_AVX)
+// 8 joints lanes, using AVX. The two SoaTransform of a block are loaded to the
+// low and high halves of 256 bits registers.
+struct Lanes8 {
+  typedef __m256 Value;
+  typedef __m256 Mask;
+  typedef SoaBlock<Lanes8> Block;
+
+  // Number of SoaTransform per block.
+  static const size_t kWidth = 2;
+
+  static OZZ_INLINE Value Load(math::_SimdFloat4 _lo, math::_SimdFloat4 _hi) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_lo), _hi, 1);
+  }
+
+  static OZZ_INLINE void Store(Value _v, math::SimdFloat4* _lo,
+                               math::SimdFloat4* _hi) {
+    *_lo = _mm256_castps256_ps128(_v);
+    *_hi = _mm256_extractf128_ps(_v, 1);
+  }
+
+  static OZZ_INLINE void Load(const math::SoaTransform* _in, Block* _out) {
+    _out->tx = Load(_in[0].translation.x, _in[1].translation.x);
+    _out->ty = Load(_in[0].translation.y, _in[1].translation.y);
+    _out->tz = Load(_in[0].translation.z, _in[1].translation.z);
+    _out->rx = Load(_in[0].rotation.x, _in[1].rotation.x);
+    _out->ry = Load(_in[0].rotation.y, _in[1].rotation.y);
+    _out->rz = Load(_in[0].rotation.z, _in[1].rotation.z);
+    _out->rw = Load(_in[0].rotation.w, _in[1].rotation.w);
+    _out->sx = Load(_in[0].scale.x, _in[1].scale.x);
+    _out->sy = Load(_in[0].scale.y, _in[1].scale.y);
+    _out->sz = Load(_in[0].scale.z, _in[1].scale.z);
+  }
+
+  static OZZ_INLINE void Store(const Block& _in, math::SoaTransform* _out) {
+    Store(_in.tx, &_out[0].translation.x, &_out[1].translation.x);
+    Store(_in.ty, &_out[0].translation.y, &_out[1].translation.y);
+    Store(_in.tz, &_out[0].translation.z, &_out[1].translation.z);
+    Store(_in.rx, &_out[0].rotation.x, &_out[1].rotation.x);
+    Store(_in.ry, &_out[0].rotation.y, &_out[1].rotation.y);
+    Store(_in.rz, &_out[0].rotation.z, &_out[1].rotation.z);
+    Store(_in.rw, &_out[0].rotation.w, &_out[1].rotation.w);
+    Store(_in.sx, &_out[0].scale.x, &_out[1].scale.x);
+    Store(_in.sy, &_out[0].scale.y, &_out[1].scale.y);
+    Store(_in.sz, &_out[0].scale.z, &_out[1].scale.z);
+  }
+
+  static OZZ_INLINE Value LoadWeights(const math::SimdFloat4* _weights) {
+    return Load(_weights[0], _weights[1]);
+  }
+
+  static OZZ_INLINE Value Load1(float _f) { return _mm256_set1_ps(_f); }
+  static OZZ_INLINE Value Add(Value _a, Value _b) {
+    return _mm256_add_ps(_a, _b);
+  }
+  static OZZ_INLINE Value Sub(Value _a, Value _b) {
+    return _mm256_sub_ps(_a, _b);
+  }
+  static OZZ_INLINE Value Mul(Value _a, Value _b) {
+    return _mm256_mul_ps(_a, _b);
+  }
+  static OZZ_INLINE Value MAdd(Value _a, Value _b, Value _c) {
+#if defined(OZZ_SIMD_FMA)
+    return _mm256_fmadd_ps(_a, _b, _c);
+#else   // OZZ_SIMD_FMA
+    return _mm256_add_ps(_mm256_mul_ps(_a, _b), _c);
+#endif  // OZZ_SIMD_FMA
+  }
+  static OZZ_INLINE Value Neg(Value _v) {
+    return _mm256_xor_ps(_v, _mm256_set1_ps(-0.f));
+  }
+  static OZZ_INLINE Value Max(Value _a, Value _b) {
+    return _mm256_max_ps(_a, _b);
+  }
+  static OZZ_INLINE Value Max0(Value _v) {
+    return _mm256_max_ps(_mm256_setzero_ps(), _v);
+  }
+  static OZZ_INLINE Value RcpEst(Value _v) { return _mm256_rcp_ps(_v); }
+  static OZZ_INLINE Value RcpEstNR(Value _v) {
+    // One Newton-Raphson step, see math::RcpEstNR.
+    const __m256 nr = _mm256_rcp_ps(_v);
+    return _mm256_sub_ps(_mm256_add_ps(nr, nr),
+                         _mm256_mul_ps(_mm256_mul_ps(nr, nr), _v));
+  }
+  static OZZ_INLINE Value RSqrtEstNR(Value _v) {
+    // One Newton-Raphson step, see math::RSqrtEstNR.
+    const __m256 nr = _mm256_rsqrt_ps(_v);
+    return _mm256_mul_ps(
+        _mm256_mul_ps(_mm256_set1_ps(.5f), nr),
+        _mm256_sub_ps(_mm256_set1_ps(3.f),
+                      _mm256_mul_ps(_mm256_mul_ps(_v, nr), nr)));
+  }
+  static OZZ_INLINE Mask Sign(Value _v) {
+    return _mm256_and_ps(_v, _mm256_set1_ps(-0.f));
+  }
+  static OZZ_INLINE Value Xor(Value _v, Mask _mask) {
+    return _mm256_xor_ps(_v, _mask);
+  }
+
+  // Returns true if any component of _v is greater than 0.
+  static OZZ_INLINE bool AnyPositive(Value _v) {
+    return _mm256_movemask_ps(
+               _mm256_cmp_ps(_v, _mm256_setzero_ps(), _CMP_GT_OQ)) != 0;
+  }
+};
+#endif  // OZZ_SIMD_AVX
+
+// Blends the first pass of a block.
+template <typename _Lanes>
+OZZ_INLINE void Blend1stPass(const typename _Lanes::Block& _in,
+                             typename _Lanes::Value _weight,
+                             typename _Lanes::Block* _out) {
+  typedef _Lanes L;
+  _out->tx = L::Mul(_in.tx, _weight);
+  _out->ty = L::Mul(_in.ty, _weight);
+  _out->tz = L::Mul(_in.tz, _weight);
+  _out->rx = L::Mul(_in.rx, _weight);
+  _out->ry = L::Mul(_in.ry, _weight);
+  _out->rz = L::Mul(_in.rz, _weight);
+  _out->rw = L::Mul(_in.rw, _weight);
+  _out->sx = L::Mul(_in.sx, _weight);
+  _out->sy = L::Mul(_in.sy, _weight);
+  _out->sz = L::Mul(_in.sz, _weight);
+}
+
+// Blends any pass but the first.
+template <typename _Lanes>
+OZZ_INLINE void BlendNPass(const typename _Lanes::Block& _in,
+                           typename _Lanes::Value _weight,
+                           typename _Lanes::Block* _out) {
+  typedef _Lanes L;
+  // Blends translation.
+  _out->tx = L::MAdd(_in.tx, _weight, _out->tx);
+  _out->ty = L::MAdd(_in.ty, _weight, _out->ty);
+  _out->tz = L::MAdd(_in.tz, _weight, _out->tz);
+
+  // Blends rotations, negates opposed quaternions to be sure to choose the
+  // shortest path between the two.
+  const typename L::Value dot = L::Add(
+      L::Add(L::Add(L::Mul(_out->rx, _in.rx), L::Mul(_out->ry, _in.ry)),
+             L::Mul(_out->rz, _in.rz)),
+      L::Mul(_out->rw, _in.rw));
+  const typename L::Mask sign = L::Sign(dot);
+  _out->rx = L::MAdd(L::Xor(_in.rx, sign), _weight, _out->rx);
+  _out->ry = L::MAdd(L::Xor(_in.ry, sign), _weight, _out->ry);
+  _out->rz = L::MAdd(L::Xor(_in.rz, sign), _weight, _out->rz);
+  _out->rw = L::MAdd(L::Xor(_in.rw, sign), _weight, _out->rw);
+
+  // Blends scales.
+  _out->sx = L::MAdd(_in.sx, _weight, _out->sx);
+  _out->sy = L::MAdd(_in.sy, _weight, _out->sy);
+  _out->sz = L::MAdd(_in.sz, _weight, _out->sz);
+}
+
+// Normalizes block rotations, and multiplies translations and scales by the
+// normalization _ratio. Quaternion length cannot be zero as opposed
+// quaternions have been fixed up during blending passes.
+template <typename _Lanes>
+OZZ_INLINE void NormalizePass(typename _Lanes::Value _ratio,
+                              typename _Lanes::Block* _out) {
+  typedef _Lanes L;
+  // Uses a Newton-Raphson refined estimate, as quaternions loose much
+  // precision due to normalization.
+  const typename L::Value len2 = L::Add(
+      L::Add(L::Add(L::Mul(_out->rx, _out->rx), L::Mul(_out->ry, _out->ry)),
+             L::Mul(_out->rz, _out->rz)),
+      L::Mul(_out->rw, _out->rw));
+  const typename L::Value inv_len = L::RSqrtEstNR(len2);
+  _out->rx = L::Mul(_out->rx, inv_len);
+  _out->ry = L::Mul(_out->ry, inv_len);
+  _out->rz = L::Mul(_out->rz, inv_len);
+  _out->rw = L::Mul(_out->rw, inv_len);
+
+  _out->tx = L::Mul(_out->tx, _ratio);
+  _out->ty = L::Mul(_out->ty, _ratio);
+  _out->tz = L::Mul(_out->tz, _ratio);
+  _out->sx = L::Mul(_out->sx, _ratio);
+  _out->sy = L::Mul(_out->sy, _ratio);
+  _out->sz = L::Mul(_out->sz, _ratio);
+}
+
+// Adds (or subtracts if _subtract is true) an additive pass to a block.
+template <typename _Lanes>
+OZZ_INLINE void AddPass(const typename _Lanes::Block& _in,
+                        typename _Lanes::Value _weight, bool _subtract,
+                        typename _Lanes::Block* _out) {
+  typedef _Lanes L;
+  typedef typename L::Value Value;
+  const Value one = L::Load1(1.f);
+  const Value one_minus_weight = L::Sub(one, _weight);
+
+  // Translation.
+  if (_subtract) {
+    _out->tx = L::Sub(_out->tx, L::Mul(_in.tx, _weight));
+    _out->ty = L::Sub(_out->ty, L::Mul(_in.ty, _weight));
+    _out->tz = L::Sub(_out->tz, L::Mul(_in.tz, _weight));
+  } else {
+    _out->tx = L::MAdd(_in.tx, _weight, _out->tx);
+    _out->ty = L::MAdd(_in.ty, _weight, _out->ty);
+    _out->tz = L::MAdd(_in.tz, _weight, _out->tz);
+  }
+
+  // Interpolates quaternion between identity and _in rotation. Quaternion
+  // sign is fixed up, so that lerp takes the shortest path.
+  const typename L::Mask sign = L::Sign(_in.rw);
+  Value qx = L::Mul(L::Xor(_in.rx, sign), _weight);
+  Value qy = L::Mul(L::Xor(_in.ry, sign), _weight);
+  Value qz = L::Mul(L::Xor(_in.rz, sign), _weight);
+  Value qw = L::MAdd(L::Sub(L::Xor(_in.rw, sign), one), _weight, one);
+  const Value inv_len = L::RSqrtEstNR(L::Add(
+      L::Add(L::Add(L::Mul(qx, qx), L::Mul(qy, qy)), L::Mul(qz, qz)),
+      L::Mul(qw, qw)));
+  qx = L::Mul(qx, inv_len);
+  qy = L::Mul(qy, inv_len);
+  qz = L::Mul(qz, inv_len);
+  qw = L::Mul(qw, inv_len);
+  if (_subtract) {
+    // Conjugate.
+    qx = L::Neg(qx);
+    qy = L::Neg(qy);
+    qz = L::Neg(qz);
+  }
+
+  // Multiplies output rotation by the interpolated quaternion.
+  const Value rx = _out->rx, ry = _out->ry, rz = _out->rz, rw = _out->rw;
+  _out->rx = L::Sub(
+      L::Add(L::Add(L::Mul(rw, qx), L::Mul(rx, qw)), L::Mul(ry, qz)),
+      L::Mul(rz, qy));
+  _out->ry = L::Sub(
+      L::Add(L::Add(L::Mul(rw, qy), L::Mul(ry, qw)), L::Mul(rz, qx)),
+      L::Mul(rx, qz));
+  _out->rz = L::Sub(
+      L::Add(L::Add(L::Mul(rw, qz), L::Mul(rz, qw)), L::Mul(rx, qy)),
+      L::Mul(ry, qx));
+  _out->rw = L::Sub(
+      L::Sub(L::Sub(L::Mul(rw, qw), L::Mul(rx, qx)), L::Mul(ry, qy)),
+      L::Mul(rz, qz));
+
+  // Scale.
+  const Value sx = L::MAdd(_in.sx, _weight, one_minus_weight);
+  const Value sy = L::MAdd(_in.sy, _weight, one_minus_weight);
+  const Value sz = L::MAdd(_in.sz, _weight, one_minus_weight);
+  if (_subtract) {
+    _out->sx = L::Mul(_out->sx, L::RcpEst(sx));
+    _out->sy = L::Mul(_out->sy, L::RcpEst(sy));
+    _out->sz = L::Mul(_out->sz, L::RcpEst(sz));
+  } else {
+    _out->sx = L::Mul(_out->sx, sx);
+    _out->sy = L::Mul(_out->sy, sy);
+    _out->sz = L::Mul(_out->sz, sz);
+  }
+}
+
+// Defines parameters that are computed once for all blocks.
 struct ProcessArgs {
   ProcessArgs(const BlendingJob& _job)
       : job(_job),
         num_soa_joints(_job.rest_pose.size()),
         num_passes(0),
         num_partial_passes(0),
-        accumulated_weight(0.f) {
+        accumulated_weight(0.f),
+        rest_pose_weight(0.f),
+        ratio(1.f) {
     // The range of all buffers has already been validated.
     assert(job.output.size() >= num_soa_joints);
-    assert(OZZ_ARRAY_SIZE(accumulated_weights) >= num_soa_joints);
-  }
+    for (const BlendingJob::Layer& layer : job.additive_layers) {
+      assert(layer.transform.size() >= num_soa_joints);
+      assert(layer.joint_weights.empty() ||
+             (layer.joint_weights.size() >= num_soa_joints));
+      (void)layer;
+    }
+
+    // Accumulates global weights, skipping irrelevant layers.
+    for (const BlendingJob::Layer& layer : job.layers) {
+      assert(layer.transform.size() >= num_soa_joints);
+      assert(layer.joint_weights.empty() ||
+             (layer.joint_weights.size() >= num_soa_joints));
+      if (layer.weight <= 0.f) {
+        continue;
+      }
+      accumulated_weight += layer.weight;
+      ++num_passes;
+      num_partial_passes += !layer.joint_weights.empty();
+    }
 
-  // Allocates enough space to store a accumulated weights per-joint.
-  // It will be initialized by the first pass processed, if any.
-  // This is quite big for a stack allocation (4 byte * maximum number of
-  // joints). This is one of the reasons why the number of joints is limited
-  // by the API.
-  // Note that this array is used with SoA data.
-  // This is the first argument in order to avoid wasting too much space with
-  // alignment padding.
-  math::SimdFloat4 accumulated_weights[Skeleton::kMaxSoAJoints];
+    // Without partial blending pass, the threshold can be tested globally. The
+    // rest pose is needed if it has a weight.
+    if (num_partial_passes == 0) {
+      const float bp_weight = job.threshold - accumulated_weight;
+      if (bp_weight > 0.f) {
+        rest_pose_weight = bp_weight;
+        // Rest pose is strictly copied if there was no pass.
+        accumulated_weight = num_passes == 0 ? 1.f : job.threshold;
+      }
+      // Normalization of a non-partial blending requires to apply the same
+      // division to all joints.
+      ratio = 1.f / accumulated_weight;
+    }
+  }
 
   // The job to process.
   const BlendingJob& job;
@@ -839,244 +1473,118 @@ struct ProcessArgs {
   // pose.
   size_t num_soa_joints;
 
-  // Number of processed blended passes (excluding passes with a weight <= 0.f),
+  // Number of blended passes (excluding passes with a weight <= 0.f),
   // including partial passes.
   int num_passes;
 
-  // Number of processed partial blending passes (aka with a weight per-joint).
+  // Number of partial blending passes (aka with a weight per-joint).
   int num_partial_passes;
 
-  // The accumulated weight of all layers.
+  // The accumulated weight of all layers, and rest pose.
   float accumulated_weight;
 
+  // Rest pose global weight, only used without partial pass.
+  float rest_pose_weight;
+
+  // Normalization ratio, only used without partial pass.
+  float ratio;
+
  private:
   // Disables assignment operators.
   ProcessArgs(const ProcessArgs&);
   void operator=(const ProcessArgs&);
 };
 
-// Blends all layers of the job to its output.
-void BlendLayers(ProcessArgs* _args) {
-  assert(_args);
-
-  // Iterates through all layers and blend them to the output.
-  for (const BlendingJob::Layer& layer : _args->job.layers) {
-    // Asserts buffer sizes, which must never fail as it has been validated.
-    assert(layer.transform.size() >= _args->num_soa_joints);
-    assert(layer.joint_weights.empty() ||
-           (layer.joint_weights.size() >= _args->num_soa_joints));
-
+// Runs all blending stages on the block of joints starting at SoA joint
+// _index.
+template <typename _Lanes>
+void BlendBlock(const ProcessArgs& _args, size_t _index) {
+  typedef _Lanes L;
+  typedef typename L::Value Value;
+  const BlendingJob& job = _args.job;
+
+  // Blends all layers. Accumulated weights are per joint, but only used by
+  // partial blending. The first pass always writes out, but that's out of the
+  // compiler sight, so it's zeroed (which is free) rather than left
+  // uninitialized.
+  typename L::Block out = {}, in;
+  Value accumulated_weight = L::Load1(0.f);
+  bool first = true;
+  for (const BlendingJob::Layer& layer : job.layers) {
     // Skip irrelevant layers.
     if (layer.weight <= 0.f) {
       continue;
     }
-
-    // Accumulates global weights.
-    _args->accumulated_weight += layer.weight;
-    const math::SimdFloat4 layer_weight =
-        math::simd_float4::Load1(layer.weight);
-
+    Value weight = L::Load1(layer.weight);
     if (!layer.joint_weights.empty()) {
-      // This layer has per-joint weights.
-      ++_args->num_partial_passes;
-
-      if (_args->num_passes == 0) {
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          const math::SimdFloat4 weight =
-              layer_weight * math::Max0(layer.joint_weights[i]);
-          _args->accumulated_weights[i] = weight;
-          OZZ_BLEND_1ST_PASS(src, weight, dest);
-        }
-      } else {
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          const math::SimdFloat4 weight =
-              layer_weight * math::Max0(layer.joint_weights[i]);
-          _args->accumulated_weights[i] =
-              _args->accumulated_weights[i] + weight;
-          OZZ_BLEND_N_PASS(src, weight, dest);
-        }
+      // This layer has per-joint weights, skipped if none of the block joints
+      // is affected.
+      weight = L::Mul(weight,
+                      L::Max0(L::LoadWeights(&layer.joint_weights[_index])));
+      if (!L::AnyPositive(weight)) {
+        continue;
       }
+    }
+    accumulated_weight = L::Add(accumulated_weight, weight);
+    L::Load(&layer.transform[_index], &in);
+    if (first) {
+      Blend1stPass<L>(in, weight, &out);
+      first = false;
     } else {
-      // This is a full layer.
-      if (_args->num_passes == 0) {
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          _args->accumulated_weights[i] = layer_weight;
-          OZZ_BLEND_1ST_PASS(src, layer_weight, dest);
-        }
-      } else {
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          _args->accumulated_weights[i] =
-              _args->accumulated_weights[i] + layer_weight;
-          OZZ_BLEND_N_PASS(src, layer_weight, dest);
-        }
-      }
+      BlendNPass<L>(in, weight, &out);
     }
-    // One more pass blended.
-    ++_args->num_passes;
   }
-}
-
-// Blends rest pose to the output if accumulated weight is less than the
-// threshold value.
-void BlendRestPose(ProcessArgs* _args) {
-  assert(_args);
-
-  // Asserts buffer sizes, which must never fail as it has been validated.
-  assert(_args->job.rest_pose.size() >= _args->num_soa_joints);
-
-  if (_args->num_partial_passes == 0) {
-    // No partial blending pass detected, threshold can be tested globally.
-    const float bp_weight = _args->job.threshold - _args->accumulated_weight;
 
-    if (bp_weight > 0.f) {  // The rest-pose is needed if it has a weight.
-      if (_args->num_passes == 0) {
+  // Blends rest pose if accumulated weight is less than the threshold value,
+  // and normalizes.
+  if (_args.num_partial_passes == 0) {
+    if (_args.rest_pose_weight > 0.f) {
+      L::Load(&job.rest_pose[_index], &in);
+      if (first) {
         // Strictly copying rest-pose.
-        _args->accumulated_weight = 1.f;
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          _args->job.output[i] = _args->job.rest_pose[i];
-        }
+        out = in;
       } else {
-        // Updates global accumulated weight, but not per-joint weight any more
-        // because normalization stage will be global also.
-        _args->accumulated_weight = _args->job.threshold;
-
-        const math::SimdFloat4 simd_bp_weight =
-            math::simd_float4::Load1(bp_weight);
-
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = _args->job.rest_pose[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          OZZ_BLEND_N_PASS(src, simd_bp_weight, dest);
-        }
+        BlendNPass<L>(in, L::Load1(_args.rest_pose_weight), &out);
       }
     }
+    NormalizePass<L>(L::Load1(_args.ratio), &out);
   } else {
     // Blending passes contain partial blending, threshold must be tested for
     // each joint.
-    const math::SimdFloat4 threshold =
-        math::simd_float4::Load1(_args->job.threshold);
-
-    // There's been at least 1 pass as num_partial_passes != 0.
-    assert(_args->num_passes != 0);
-
-    for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-      const math::SoaTransform& src = _args->job.rest_pose[i];
-      math::SoaTransform& dest = _args->job.output[i];
-      const math::SimdFloat4 bp_weight =
-          math::Max0(threshold - _args->accumulated_weights[i]);
-      _args->accumulated_weights[i] =
-          math::Max(threshold, _args->accumulated_weights[i]);
-      OZZ_BLEND_N_PASS(src, bp_weight, dest);
+    const Value threshold = L::Load1(job.threshold);
+    const Value bp_weight = L::Max0(L::Sub(threshold, accumulated_weight));
+    accumulated_weight = L::Max(threshold, accumulated_weight);
+    if (first) {
+      // No layer affects block joints.
+      L::Load(&job.rest_pose[_index], &in);
+      Blend1stPass<L>(in, bp_weight, &out);
+    } else if (L::AnyPositive(bp_weight)) {
+      L::Load(&job.rest_pose[_index], &in);
+      BlendNPass<L>(in, bp_weight, &out);
     }
+    NormalizePass<L>(L::RcpEstNR(accumulated_weight), &out);
   }
-}
 
-// Normalizes output rotations. Quaternion length cannot be zero as opposed
-// quaternions have been fixed up during blending passes.
-// Translations and scales are already normalized because weights were
-// pre-multiplied by the normalization ratio.
-void Normalize(ProcessArgs* _args) {
-  assert(_args);
-
-  if (_args->num_partial_passes == 0) {
-    // Normalization of a non-partial blending requires to apply the same
-    // division to all joints.
-    const math::SimdFloat4 ratio =
-        math::simd_float4::Load1(1.f / _args->accumulated_weight);
-    for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-      math::SoaTransform& dest = _args->job.output[i];
-      dest.rotation = NormalizeEst(dest.rotation);
-      dest.translation = dest.translation * ratio;
-      dest.scale = dest.scale * ratio;
-    }
-  } else {
-    // Partial blending normalization requires to compute the divider per-joint.
-    const math::SimdFloat4 one = math::simd_float4::one();
-    for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-      const math::SimdFloat4 ratio = one / _args->accumulated_weights[i];
-      math::SoaTransform& dest = _args->job.output[i];
-      dest.rotation = NormalizeEst(dest.rotation);
-      dest.translation = dest.translation * ratio;
-      dest.scale = dest.scale * ratio;
+  // Process additive blending.
+  for (const BlendingJob::Layer& layer : job.additive_layers) {
+    // Skip layer as its weight is 0. Negative weights are subtracted.
+    if (layer.weight == 0.f) {
+      continue;
     }
-  }
-}
-
-// Process additive blending pass.
-void AddLayers(ProcessArgs* _args) {
-  assert(_args);
-
-  // Iterates through all layers and blend them to the output.
-  for (const BlendingJob::Layer& layer : _args->job.additive_layers) {
-    // Asserts buffer sizes, which must never fail as it has been validated.
-    assert(layer.transform.size() >= _args->num_soa_joints);
-    assert(layer.joint_weights.empty() ||
-           (layer.joint_weights.size() >= _args->num_soa_joints));
-
-    // Prepares constants.
-    const math::SimdFloat4 one = math::simd_float4::one();
-
-    if (layer.weight > 0.f) {
-      // Weight is positive, need to perform additive blending.
-      const math::SimdFloat4 layer_weight =
-          math::simd_float4::Load1(layer.weight);
-
-      if (!layer.joint_weights.empty()) {
-        // This layer has per-joint weights.
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          const math::SimdFloat4 weight =
-              layer_weight * math::Max0(layer.joint_weights[i]);
-          const math::SimdFloat4 one_minus_weight = one - weight;
-          OZZ_ADD_PASS(src, weight, dest);
-        }
-      } else {
-        // This is a full layer.
-        const math::SimdFloat4 one_minus_weight = one - layer_weight;
-
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          OZZ_ADD_PASS(src, layer_weight, dest);
-        }
-      }
-    } else if (layer.weight < 0.f) {
-      // Weight is negative, need to perform subtractive blending.
-      const math::SimdFloat4 layer_weight =
-          math::simd_float4::Load1(-layer.weight);
-
-      if (!layer.joint_weights.empty()) {
-        // This layer has per-joint weights.
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          const math::SimdFloat4 weight =
-              layer_weight * math::Max0(layer.joint_weights[i]);
-          const math::SimdFloat4 one_minus_weight = one - weight;
-          OZZ_SUB_PASS(src, weight, dest);
-        }
-      } else {
-        // This is a full layer.
-        const math::SimdFloat4 one_minus_weight = one - layer_weight;
-        for (size_t i = 0; i < _args->num_soa_joints; ++i) {
-          const math::SoaTransform& src = layer.transform[i];
-          math::SoaTransform& dest = _args->job.output[i];
-          OZZ_SUB_PASS(src, layer_weight, dest);
-        }
+    const bool subtract = layer.weight < 0.f;
+    Value weight = L::Load1(subtract ? -layer.weight : layer.weight);
+    if (!layer.joint_weights.empty()) {
+      weight = L::Mul(weight,
+                      L::Max0(L::LoadWeights(&layer.joint_weights[_index])));
+      if (!L::AnyPositive(weight)) {
+        continue;
       }
-    } else {
-      // Skip layer as its weight is 0.
     }
+    L::Load(&layer.transform[_index], &in);
+    AddPass<L>(in, weight, subtract, &out);
   }
+
+  L::Store(out, &job.output[_index]);
 }
 }  // namespace
 
@@ -1085,20 +1593,20 @@ bool BlendingJob::Run() const {
     return false;
   }
 
-  // Initializes blended parameters that are exchanged across blend stages.
-  ProcessArgs process_args(*this);
+  // Initializes blended parameters that are shared by all blocks.
+  const ProcessArgs process_args(*this);
 
-  // Blends all layers to the job output buffers.
-  BlendLayers(&process_args);
-
-  // Applies rest pose.
-  BlendRestPose(&process_args);
-
-  // Normalizes output.
-  Normalize(&process_args);
-
-  // Process additive blending.
-  AddLayers(&process_args);
+  // Blends 8 joints at a time if possible, then remaining ones 4 at a time.
+  size_t i = 0;
+#if defined(OZZ_SIMD_AVX)
+  for (; i + Lanes8::kWidth <= process_args.num_soa_joints;
+       i += Lanes8::kWidth) {
+    BlendBlock<Lanes8>(process_args, i);
+  }
+#endif  // OZZ_SIMD_AVX
+  for (; i < process_args.num_soa_joints; ++i) {
+    BlendBlock<Lanes4>(process_args, i);
+  }
 
   return true;
 }
@@ -1756,14 +2264,17 @@ bool IKTwoBoneJob::Run() const {
 
 #include "ozz/animation/runtime/local_to_model_job.h"
 
+#include <algorithm>
 #include <cassert>
 
 #include "ozz/base/maths/math_ex.h"
+#include "ozz/base/maths/simd_float3x4.h"
 #include "ozz/base/maths/simd_math.h"
 #include "ozz/base/maths/soa_float4x4.h"
 #include "ozz/base/maths/soa_transform.h"
 
 #include "ozz/animation/runtime/skeleton.h"
+#include "ozz/animation/runtime/skeleton_utils.h"
 
 namespace ozz {
 namespace animation {
@@ -1790,51 +2301,233 @@ bool LocalToModelJob::Validate() const {
   const size_t num_soa_joints = (num_joints + 3) / 4;
 
   // Test input and output ranges, implicitly tests for nullptr end pointers.
+  // Only one of the output ranges can be used.
   valid &= input.size() >= num_soa_joints;
-  valid &= output.size() >= num_joints;
+  valid &= dirty.empty() || dirty.size() >= (num_joints + 7) / 8;
+  valid &= joint_mask.empty() || joint_mask.size() >= (num_joints + 7) / 8;
+  if (output3x4.empty()) {
+    valid &= output.size() >= num_joints;
+  } else {
+    valid &= output.empty();
+    valid &= output3x4.size() >= num_joints;
+  }
 
   return valid;
 }
 
+namespace {
+
+// Multiplies _parent matrix by the affine matrix stored in lane _lane of soa
+// matrix _local. Local matrix components are splat directly from soa matrix
+// memory, which saves transposing it to aos. As local matrix last row is
+// (0, 0, 0, 1), the corresponding products are skipped.
+OZZ_INLINE void MultiplyAffine(const math::Float4x4& _parent,
+                               const math::SoaFloat4x4& _local, int _lane,
+                               math::Float4x4* _output) {
+  const float* local =
+      reinterpret_cast<const float*>(&_local.cols[0].x) + _lane;
+  for (int i = 0; i < 3; ++i, local += 16) {
+    const math::SimdFloat4 xxxx =
+        math::simd_float4::Load1PtrU(local) * _parent.cols[0];
+    const math::SimdFloat4 zzzz =
+        math::simd_float4::Load1PtrU(local + 8) * _parent.cols[2];
+    const math::SimdFloat4 a01 = math::MAdd(
+        math::simd_float4::Load1PtrU(local + 4), _parent.cols[1], xxxx);
+    _output->cols[i] = a01 + zzzz;
+  }
+  const math::SimdFloat4 xxxx =
+      math::simd_float4::Load1PtrU(local) * _parent.cols[0];
+  const math::SimdFloat4 zzzz =
+      math::simd_float4::Load1PtrU(local + 8) * _parent.cols[2];
+  const math::SimdFloat4 a01 = math::MAdd(
+      math::simd_float4::Load1PtrU(local + 4), _parent.cols[1], xxxx);
+  const math::SimdFloat4 a23 = zzzz + _parent.cols[3];
+  _output->cols[3] = a01 + a23;
+}
+
+// Local matrices of a soa transform, as rows of affine matrices. Rows are
+// indexed by row and then by soa lane.
+struct SoaAffineRows {
+  math::SimdFloat4 rows[3][4];
+};
+
+// Multiplies _parent matrix by the affine matrix stored in lane _lane of
+// _local. Parent components are splat, and its translation is added as local
+// matrix last row is (0, 0, 0, 1).
+OZZ_INLINE void MultiplyAffine(const math::Float3x4& _parent,
+                               const SoaAffineRows& _local, int _lane,
+                               math::Float3x4* _output) {
+  const math::SimdInt4 mask_w = math::simd_int4::mask_000f();
+  for (int i = 0; i < 3; ++i) {
+    const math::SimdFloat4 row = _parent.rows[i];
+    const math::SimdFloat4 zzzz = math::MAdd(
+        math::SplatZ(row), _local.rows[2][_lane], math::And(row, mask_w));
+    const math::SimdFloat4 xxxx = math::SplatX(row) * _local.rows[0][_lane];
+    const math::SimdFloat4 a01 =
+        math::MAdd(math::SplatY(row), _local.rows[1][_lane], xxxx);
+    _output->rows[i] = a01 + zzzz;
+  }
+}
+
+// Builds local matrices of soa transform _transform, in the layout expected by
+// MultiplyAffine for each output matrix type.
+OZZ_INLINE void ToLocal(const math::SoaTransform& _transform,
+                        math::SoaFloat4x4* _local) {
+  *_local = math::SoaFloat4x4::FromAffine(
+      _transform.translation, _transform.rotation, _transform.scale);
+}
+
+// Float3x4 are multiplied row by row, so soa matrices are transposed to rows
+// once per soa transform.
+OZZ_INLINE void ToLocal(const math::SoaTransform& _transform,
+                        SoaAffineRows* _local) {
+  const math::SoaFloat4x4 soa = math::SoaFloat4x4::FromAffine(
+      _transform.translation, _transform.rotation, _transform.scale);
+  const math::SimdFloat4 soa_rows[3][4] = {
+      {soa.cols[0].x, soa.cols[1].x, soa.cols[2].x, soa.cols[3].x},
+      {soa.cols[0].y, soa.cols[1].y, soa.cols[2].y, soa.cols[3].y},
+      {soa.cols[0].z, soa.cols[1].z, soa.cols[2].z, soa.cols[3].z}};
+  for (int i = 0; i < 3; ++i) {
+    math::Transpose4x4(soa_rows[i], _local->rows[i]);
+  }
+}
+
+template <typename _Matrix>
+struct LocalMatrices;
+
+template <>
+struct LocalMatrices<math::Float4x4> {
+  typedef math::SoaFloat4x4 Type;
+};
+
+template <>
+struct LocalMatrices<math::Float3x4> {
+  typedef SoaAffineRows Type;
+};
+
+// Computes model-space matrices of joints in range [_begin,_end[. Parents of
+// range joints are either part of the range, or already computed.
+// If _mask isn't empty, only masked joints are updated. If _dirty isn't empty,
+// only dirty joints and their descendants are updated, and descendants are
+// flagged dirty too. Soa transforms without any joint to update are skipped.
+template <typename _Matrix>
+void LocalToModel(span<const int16_t> _parents, const _Matrix& _root,
+                  span<const math::SoaTransform> _input, int _begin, int _end,
+                  span<const byte> _mask, span<byte> _dirty,
+                  span<_Matrix> _output) {
+  for (int i = _begin; i < _end;) {
+    const int soa_end = math::Min((i + 4) & ~3, _end);
+
+    // A soa transform lanes share the same half byte of the mask.
+    int lanes = 0xf;
+    if (!_mask.empty()) {
+      lanes = (_mask[i / 8] >> (i & 4)) & 0xf;
+    }
+
+    // Propagates parents dirtiness. Parents are always before their children,
+    // including inside a soa transform.
+    if (!_dirty.empty() && lanes != 0) {
+      int dirty_lanes = 0;
+      for (int j = i; j < soa_end; ++j) {
+        if (!(lanes & (1 << (j & 3)))) {
+          continue;
+        }
+        const int parent = _parents[j];
+        if (parent != Skeleton::kNoParent && TestJointBit(_dirty, parent)) {
+          SetJointBit(_dirty, j);
+        }
+        dirty_lanes |= TestJointBit(_dirty, j) << (j & 3);
+      }
+      lanes = dirty_lanes;
+    }
+
+    if (lanes == 0) {
+      i = soa_end;
+      continue;
+    }
+
+    // Builds local matrices from soa transforms.
+    typename LocalMatrices<_Matrix>::Type local;
+    ToLocal(_input[i / 4], &local);
+
+    for (; i < soa_end; ++i) {
+      if (!(lanes & (1 << (i & 3)))) {
+        continue;
+      }
+      const int parent = _parents[i];
+      const _Matrix& parent_matrix =
+          parent == Skeleton::kNoParent ? _root : _output[parent];
+      MultiplyAffine(parent_matrix, local, i & 3, &_output[i]);
+    }
+  }
+}
+
+// Updates joints from _from to _to, see LocalToModelJob members. _Matrix is
+// either Float4x4 or Float3x4.
+template <typename _Matrix>
+void Update(const Skeleton& _skeleton, const _Matrix& _root, int _from,
+            int _to, bool _from_excluded,
+            span<const math::SoaTransform> _input, span<const byte> _mask,
+            span<byte> _dirty, span<_Matrix> _output) {
+  const span<const int16_t>& parents = _skeleton.joint_parents();
+
+  // Applies hierarchical transformation.
+  // Loop ends after "to".
+  const int end = math::Min(_to + 1, _skeleton.num_joints());
+
+  // Breadth-first skeletons parents are sorted, so children of a range of
+  // joints are a range of joints too. "from" hierarchy is updated one range
+  // (depth level) at a time.
+  if (_skeleton.ordering() == Skeleton::kBreadthFirst && _from >= 0) {
+    for (int begin = _from, range_end = _from + 1;
+         begin < range_end && begin < end;) {
+      if (begin != _from || !_from_excluded) {
+        LocalToModel(parents, _root, _input, begin, math::Min(range_end, end),
+                     _mask, _dirty, _output);
+      }
+      const int16_t* children = parents.begin() + range_end;
+      begin = static_cast<int>(
+          std::lower_bound(children, parents.end(), begin) - parents.begin());
+      range_end = static_cast<int>(
+          std::lower_bound(children, parents.end(), range_end) -
+          parents.begin());
+    }
+    return;
+  }
+
+  // Begins iteration from "from", or the next joint if "from" is excluded.
+  // Depth-first hierarchies are contiguous: parents[i] >= from is true as long
+  // as "i" is a child of "from".
+  const int begin = math::Max(_from + _from_excluded, 0);
+  int range_end = begin;
+  if (range_end < end && (!_from_excluded || parents[range_end] >= _from)) {
+    for (++range_end; range_end < end && parents[range_end] >= _from;
+         ++range_end) {
+    }
+  }
+  LocalToModel(parents, _root, _input, begin, range_end, _mask, _dirty,
+               _output);
+}
+}  // namespace
+
 bool LocalToModelJob::Run() const {
   if (!Validate()) {
     return false;
   }
 
-  const span<const int16_t>& parents = skeleton->joint_parents();
-
   // Initializes an identity matrix that will be used to compute roots model
   // matrices without requiring a branch.
   const math::Float4x4 identity = math::Float4x4::identity();
-  const math::Float4x4* root_matrix = (root == nullptr) ? &identity : root;
+  const math::Float4x4& root_matrix = (root == nullptr) ? identity : *root;
 
-  // Applies hierarchical transformation.
-  // Loop ends after "to".
-  const int end = math::Min(to + 1, skeleton->num_joints());
-  // Begins iteration from "from", or the next joint if "from" is excluded.
-  // Process next joint if end is not reach. parents[begin] >= from is true as
-  // long as "begin" is a child of "from".
-  for (int i = math::Max(from + from_excluded, 0),
-           process = i < end && (!from_excluded || parents[i] >= from);
-       process;) {
-    // Builds soa matrices from soa transforms.
-    const math::SoaTransform& transform = input[i / 4];
-    const math::SoaFloat4x4 local_soa_matrices = math::SoaFloat4x4::FromAffine(
-        transform.translation, transform.rotation, transform.scale);
-
-    // Converts to aos matrices.
-    math::Float4x4 local_aos_matrices[4];
-    math::Transpose16x16(&local_soa_matrices.cols[0].x,
-                         local_aos_matrices->cols);
-
-    // parents[i] >= from is true as long as "i" is a child of "from".
-    for (const int soa_end = (i + 4) & ~3; i < soa_end && process;
-         ++i, process = i < end && parents[i] >= from) {
-      const int parent = parents[i];
-      const math::Float4x4* parent_matrix =
-          parent == Skeleton::kNoParent ? root_matrix : &output[parent];
-      output[i] = *parent_matrix * local_aos_matrices[i & 3];
-    }
+  if (!output3x4.empty()) {
+    const math::Float3x4 root_matrix3x4 =
+        math::Float3x4::FromFloat4x4(root_matrix);
+    Update(*skeleton, root_matrix3x4, from, to, from_excluded, input,
+           joint_mask, dirty, output3x4);
+  } else {
+    Update(*skeleton, root_matrix, from, to, from_excluded, input, joint_mask,
+           dirty, output);
   }
   return true;
 }
@@ -1874,10 +2567,12 @@ bool LocalToModelJob::Run() const {
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <limits>
 
 #include "ozz/animation/runtime/animation.h"
 #include "ozz/base/encode/group_varint.h"
+#include "ozz/base/endianness.h"
 #include "ozz/base/maths/math_constant.h"
 #include "ozz/base/maths/math_ex.h"
 #include "ozz/base/maths/soa_transform.h"
@@ -1969,6 +2664,13 @@ struct QuaternionKey {
   static constexpr float kfScale = 1.f * kiScale;
 };
 
+// Defines the tangent key frame type of rotations, used by cubic Hermite
+// spline animations. Quaternion tangents aren't normalized, so the 4
+// components are stored as half precision floats.
+struct Float4Key {
+  uint16_t values[4];
+};
+
 // Endianness independent load and store
 inline void pack(int _largest, int _sign, const int _cpnt[3],
                  QuaternionKey* _key) {
@@ -1992,6 +2694,39 @@ inline void unpack(const QuaternionKey& _key, int& _biggest, int& _sign,
   _cpnt[2] = _key.values[2] >> 1;
 }
 
+// Variable bit-rate quantization of a keyed SoA track of float3 (translations
+// and scales). Keyframes of each of the 4 tracks are stored consecutively in a
+// bit stream. Each component is quantized on the same number of bits within
+// the track range, so that value = min + quantized * scale.
+struct Float3Quantization {
+  float min[3][4];
+  float scale[3][4];
+
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range [0,kMaxBits]. A
+  // keyframe is made of 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMaxBits = 16;
+};
+
+// Variable bit-rate quantization of a keyed SoA track of quaternions.
+// Keyframes use QuaternionKey bit layout (largest component index, sign, then
+// the 3 smallest components), with a number of bits per component chosen per
+// track.
+struct QuaternionQuantization {
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range
+  // [kMinBits,QuaternionKey::kBits]. A keyframe is made of 3 + 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMinBits = 4;
+};
+
 }  // namespace internal
 }  // namespace animation
 }  // namespace ozz
@@ -2010,6 +2745,12 @@ struct InterpSoaQuaternion {
   math::SimdFloat4 ratio[2];
   math::SoaQuaternion value[2];
 };
+struct TangentSoaFloat3 {
+  math::SoaFloat3 value[2];
+};
+struct TangentSoaQuaternion {
+  math::SoaQuaternion value[2];
+};
 }  // namespace internal
 
 bool SamplingJob::Validate() const {
@@ -2029,6 +2770,15 @@ bool SamplingJob::Validate() const {
   // Tests context size.
   valid &= context->max_soa_tracks() >= num_soa_tracks;
 
+  // Tests optional mask and rest pose sizes.
+  valid &= track_mask.empty() ||
+           track_mask.size() >= static_cast<size_t>(num_soa_tracks + 7) / 8;
+  valid &= rest_pose.empty() ||
+           rest_pose.size() >=
+               math::Min(output.size(), static_cast<size_t>(num_soa_tracks));
+  valid &= dirty.empty() ||
+           dirty.size() >= static_cast<size_t>(num_soa_tracks * 4 + 7) / 8;
+
   return valid;
 }
 
@@ -2107,16 +2857,23 @@ inline ozz::math::SimdFloat4 KeysRatio(
       _timepoints[index[3]]);
 }
 
+// _locals is empty if the animation doesn't use variable bit-rate keyframes.
 inline uint32_t InitializeCache(const Animation::KeyframesCtrlConst& _ctrl,
                                 size_t _iframe,
-                                const ozz::span<uint32_t>& _entries) {
+                                const ozz::span<uint32_t>& _entries,
+                                const ozz::span<uint32_t>& _locals) {
   if (_iframe > 0) {
-    // Initializes cache entries from a compressed cache iframe.
+    // Initializes cache entries from a compressed cache iframe. Local indices
+    // follow entries for variable bit-rate animations.
     size_t iframe = (_iframe - 1) * 2;
     const size_t offset = _ctrl.iframe_desc[iframe];
-    ozz::DecodeGV4Stream(_ctrl.iframe_entries.subspan(
-                             offset, _ctrl.iframe_entries.size() - offset),
-                         _entries);
+    const auto& remain = ozz::DecodeGV4Stream(
+        _ctrl.iframe_entries.subspan(offset,
+                                     _ctrl.iframe_entries.size() - offset),
+        _entries);
+    if (!_locals.empty()) {
+      ozz::DecodeGV4Stream(remain, _locals);
+    }
 
     // Find "next" keyframe, aka the one after the last cached one.
     return _ctrl.iframe_desc[iframe + 1] + 1;
@@ -2128,6 +2885,7 @@ inline uint32_t InitializeCache(const Animation::KeyframesCtrlConst& _ctrl,
     for (uint32_t i = 0; i < num_tracks; ++i) {
       _entries[i] = i + num_tracks;
     }
+    std::fill(_locals.begin(), _locals.end(), 1u);
 
     // Next is set to the next unprocessed keyframe
     return num_tracks * 2;
@@ -2147,12 +2905,15 @@ inline void OutdateCache(const ozz::span<byte>& _outdated,
 }
 
 // Loops through the sorted key frames and update cache structure.
+// Cache local indices are maintained only if _variable is true.
 void UpdateCache(float _ratio, float _previous_ratio, size_t _num_soa_tracks,
                  const ozz::span<const float>& _timepoints,
-                 const Animation::KeyframesCtrlConst& _ctrl,
+                 const Animation::KeyframesCtrlConst& _ctrl, bool _variable,
                  SamplingJob::Context::Cache& _cache) {
   assert(_num_soa_tracks > 0);
   const uint32_t num_tracks = static_cast<uint32_t>(_num_soa_tracks * 4);
+  const ozz::span<uint32_t> locals =
+      _variable ? _cache.locals.first(num_tracks) : ozz::span<uint32_t>();
   assert(_ctrl.previouses.begin() + num_tracks * 2 <= _ctrl.previouses.end());
   const uint32_t num_keys = static_cast<uint32_t>(_ctrl.previouses.size());
 
@@ -2178,7 +2939,8 @@ void UpdateCache(float _ratio, float _previous_ratio, size_t _num_soa_tracks,
 
     // Seek to defined keyframe
     if (iframe >= 0) {
-      next = InitializeCache(_ctrl, iframe, _cache.entries.first(num_tracks));
+      next = InitializeCache(_ctrl, iframe, _cache.entries.first(num_tracks),
+                             locals);
       assert(next >= num_tracks * 2 && next <= num_keys);
 
       // Cache was overwritten, all entries must be flagged as outdated.
@@ -2207,6 +2969,9 @@ void UpdateCache(float _ratio, float _previous_ratio, size_t _num_soa_tracks,
 
     // Updates cache.
     _cache.entries[track] = next;
+    if (!locals.empty()) {
+      ++locals[track];
+    }
   }
 
   // Rewinds.
@@ -2228,6 +2993,9 @@ void UpdateCache(float _ratio, float _previous_ratio, size_t _num_soa_tracks,
     const uint32_t previous = _ctrl.previouses[_cache.entries[track]];
     assert(_cache.entries[track] >= previous + num_tracks);
     _cache.entries[track] -= previous;
+    if (!locals.empty()) {
+      --locals[track];
+    }
   }
 
   // Updates next output.
@@ -2235,19 +3003,25 @@ void UpdateCache(float _ratio, float _previous_ratio, size_t _num_soa_tracks,
   _cache.next = next;
 }
 
-template <typename _CompressedKey, typename _DecompressedKey,
-          typename _Decompress>
+// Decompresses outdated SoA entries, using _decoder to decode the left and
+// right keyframe values of a SoA track. See FixedDecoder and variable bit-rate
+// decoders.
+template <typename _DecompressedKey, typename _Decoder>
 inline void Decompress(size_t _num_soa_tracks,
                        const ozz::span<const float>& _timepoints,
                        const Animation::KeyframesCtrlConst& _ctrl,
-                       const ozz::span<const _CompressedKey>& _compressed,
                        const SamplingJob::Context::Cache& _cache,
+                       const ozz::span<const byte>& _mask,
                        const ozz::span<_DecompressedKey>& _decompressed,
-                       const _Decompress& _decompress) {
+                       const _Decoder& _decoder) {
   const size_t num_outdated_flags = (_num_soa_tracks + 7) / 8;
   for (size_t j = 0; j < num_outdated_flags; ++j) {
-    byte outdated = _cache.outdated[j];  // Copy outdated flag
-    _cache.outdated[j] = 0;  // Reset outdated entries as all will be processed.
+    // Masked out entries are kept outdated, so they're decompressed as soon as
+    // they're unmasked.
+    const byte mask = _mask.empty() ? 0xff : _mask[j];
+    byte outdated = _cache.outdated[j] & mask;  // Copy outdated flag
+    // Reset outdated entries as all unmasked ones will be processed.
+    _cache.outdated[j] &= static_cast<byte>(~mask);
     for (size_t i = j * 8; outdated != 0; ++i, outdated >>= 1) {
       if (!(outdated & 1)) {
         continue;
@@ -2263,25 +3037,38 @@ inline void Decompress(size_t _num_soa_tracks,
                                  rights[2] - _ctrl.previouses[rights[2]],
                                  rights[3] - _ctrl.previouses[rights[3]]};
 
-      // Decompress left side keyframes and store them in soa structures.
-      const _CompressedKey& k00 = _compressed[lefts[0]];
-      const _CompressedKey& k10 = _compressed[lefts[1]];
-      const _CompressedKey& k20 = _compressed[lefts[2]];
-      const _CompressedKey& k30 = _compressed[lefts[3]];
+      // Decompress left and right side keyframes and store them in soa
+      // structures.
       _decompressed[i].ratio[0] = KeysRatio(_timepoints, _ctrl.ratios, lefts);
-      _decompress(k00, k10, k20, k30, &_decompressed[i].value[0]);
-
-      // Decompress right side keyframes and store them in soa structures.
-      const _CompressedKey& k01 = _compressed[rights[0]];
-      const _CompressedKey& k11 = _compressed[rights[1]];
-      const _CompressedKey& k21 = _compressed[rights[2]];
-      const _CompressedKey& k31 = _compressed[rights[3]];
       _decompressed[i].ratio[1] = KeysRatio(_timepoints, _ctrl.ratios, rights);
-      _decompress(k01, k11, k21, k31, &_decompressed[i].value[1]);
+      _decoder(i, lefts, rights.data(), _cache.locals.begin() + i * 4,
+               _decompressed[i].value);
     }
   }
 }
 
+#if defined(OZZ_SIMD_F16C)
+inline void DecompressFloat3(const internal::Float3Key& _k0,
+                             const internal::Float3Key& _k1,
+                             const internal::Float3Key& _k2,
+                             const internal::Float3Key& _k3,
+                             math::SoaFloat3* _soa_float3) {
+  // Transposes the 4 keys to SoA half vectors, x and y sharing the same
+  // register. F16C converts 4 halves at a time from the low 64 bits.
+  const __m128i xy = _mm_setr_epi16(
+      static_cast<short>(_k0.values[0]), static_cast<short>(_k1.values[0]),
+      static_cast<short>(_k2.values[0]), static_cast<short>(_k3.values[0]),
+      static_cast<short>(_k0.values[1]), static_cast<short>(_k1.values[1]),
+      static_cast<short>(_k2.values[1]), static_cast<short>(_k3.values[1]));
+  const __m128i z = _mm_setr_epi16(
+      static_cast<short>(_k0.values[2]), static_cast<short>(_k1.values[2]),
+      static_cast<short>(_k2.values[2]), static_cast<short>(_k3.values[2]), 0,
+      0, 0, 0);
+  _soa_float3->x = _mm_cvtph_ps(xy);
+  _soa_float3->y = _mm_cvtph_ps(_mm_unpackhi_epi64(xy, xy));
+  _soa_float3->z = _mm_cvtph_ps(z);
+}
+#else   // OZZ_SIMD_F16C
 inline void DecompressFloat3(const internal::Float3Key& _k0,
                              const internal::Float3Key& _k1,
                              const internal::Float3Key& _k2,
@@ -2294,7 +3081,97 @@ inline void DecompressFloat3(const internal::Float3Key& _k0,
   _soa_float3->z = math::HalfToFloat(math::simd_int4::Load(
       _k0.values[2], _k1.values[2], _k2.values[2], _k3.values[2]));
 }
+#endif  // OZZ_SIMD_F16C
+
+// Rebuilds 4 quaternions from their quantized representation: index of the
+// largest component, sign of the largest component (as a sign bit mask) and the
+// 3 smallest components, that are dequantized with _scale.
+inline void RestoreQuaternion(const math::SimdInt4& _largest,
+                              const math::SimdInt4& _sign,
+                              const math::SimdInt4 _cpnts[3],
+                              const math::SimdFloat4& _scale,
+                              math::SoaQuaternion* _quaternion) {
+  // Restores components order, which depends on the largest component index.
+  // Largest component slot content doesn't matter as it's overwritten below.
+  const math::SimdInt4 two = math::simd_int4::Load(2, 2, 2, 2);
+  const math::SimdInt4 is_largest[4] = {
+      math::CmpEq(_largest, math::simd_int4::zero()),
+      math::CmpEq(_largest, math::simd_int4::one()),
+      math::CmpEq(_largest, two),
+      math::CmpEq(_largest, math::simd_int4::Load(3, 3, 3, 3))};
+  const math::SimdInt4 below_2 = math::CmpLt(_largest, two);
+  const math::SimdInt4 cmp_keys[4] = {
+      _cpnts[0], math::Select(below_2, _cpnts[0], _cpnts[1]),
+      math::Select(is_largest[3], _cpnts[2], _cpnts[1]), _cpnts[2]};
+
+  const math::SimdFloat4 kOffset = math::simd_float4::Load1(-math::kSqrt2_2);
+  math::SimdFloat4 cpnt[4];
+  for (int i = 0; i < 4; ++i) {
+    // Zeroed largest components so they're not part of the dot.
+    cpnt[i] = math::AndNot(
+        _scale * math::simd_float4::FromInt(cmp_keys[i]) + kOffset,
+        is_largest[i]);
+  }
+
+  // Get back length of 4th component. Favors performance over accuracy by using
+  // x * RSqrtEst(x) instead of Sqrt(x).
+  // ww0 cannot be 0 because we 're recomputing the largest component.
+  const math::SimdFloat4 dot = cpnt[0] * cpnt[0] + cpnt[1] * cpnt[1] +
+                               cpnt[2] * cpnt[2] + cpnt[3] * cpnt[3];
+  const math::SimdFloat4 ww0 = math::simd_float4::one() - dot;
+  const math::SimdFloat4 w0 = ww0 * math::RSqrtEst(ww0);
+
+  // Re-applies 4th component's sign and re-injects it inside the SoA
+  // structure.
+  const math::SimdFloat4 restored = math::Or(w0, _sign);
+  _quaternion->x = math::Or(cpnt[0], math::And(restored, is_largest[0]));
+  _quaternion->y = math::Or(cpnt[1], math::And(restored, is_largest[1]));
+  _quaternion->z = math::Or(cpnt[2], math::And(restored, is_largest[2]));
+  _quaternion->w = math::Or(cpnt[3], math::And(restored, is_largest[3]));
+}
 
+#if defined(OZZ_SIMD_AVX2)
+// Packs the 48 bits of a quaternion key in the lower bits of a 64 bits integer.
+inline int64_t LoadQuaternionKey(const internal::QuaternionKey& _key) {
+  return static_cast<int64_t>(uint64_t(_key.values[0]) |
+                              uint64_t(_key.values[1]) << 16 |
+                              uint64_t(_key.values[2]) << 32);
+}
+
+inline void DecompressQuaternion(const internal::QuaternionKey& _k0,
+                                 const internal::QuaternionKey& _k1,
+                                 const internal::QuaternionKey& _k2,
+                                 const internal::QuaternionKey& _k3,
+                                 math::SoaQuaternion* _quaternion) {
+  // Loads the 4 keys and splits their low (bits 0 to 31) and high (bits 32 to
+  // 47) parts, so that the remaining unpacking is done 4 keys at a time.
+  const __m256i keys =
+      _mm256_setr_epi64x(LoadQuaternionKey(_k0), LoadQuaternionKey(_k1),
+                         LoadQuaternionKey(_k2), LoadQuaternionKey(_k3));
+  const __m256i split = _mm256_permutevar8x32_epi32(
+      keys, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+  const math::SimdInt4 lo = _mm256_castsi256_si128(split);
+  const math::SimdInt4 hi = _mm256_extracti128_si256(split, 1);
+
+  // Unpacks largest component index, sign and the 3 quantized components. See
+  // internal::unpack for the bit layout.
+  const math::SimdInt4 mask_15b = _mm_set1_epi32(0x7fff);
+  const math::SimdInt4 largest = math::And(lo, _mm_set1_epi32(0x3));
+  const math::SimdInt4 sign =
+      math::And(math::ShiftL(lo, 29), _mm_set1_epi32(0x80000000));
+  const math::SimdInt4 c0 = math::And(math::ShiftRu(lo, 3), mask_15b);
+  const math::SimdInt4 c1 = math::And(
+      math::Or(math::ShiftRu(lo, 18), math::ShiftL(hi, 14)), mask_15b);
+  const math::SimdInt4 c2 = math::And(math::ShiftRu(hi, 1), mask_15b);
+
+  // Rebuilds quaternion from quantized values.
+  const math::SimdInt4 cpnts[3] = {c0, c1, c2};
+  RestoreQuaternion(largest, sign, cpnts,
+                    math::simd_float4::Load1(math::kSqrt2 /
+                                             internal::QuaternionKey::kfScale),
+                    _quaternion);
+}
+#else   // OZZ_SIMD_AVX2
 // Defines a mapping table that defines components assignation in the output
 // quaternion.
 static constexpr uint8_t kCpntMapping[4][4] = {
@@ -2385,32 +3262,470 @@ inline void DecompressQuaternion(const internal::QuaternionKey& _k0,
   _quaternion->z = cpnt[2];
   _quaternion->w = cpnt[3];
 }
+#endif  // OZZ_SIMD_AVX2
+
+// Decodes fixed precision keyframes with _Decompress function.
+template <typename _CompressedKey, typename _DecompressedValue,
+          void (*_Decompress)(const _CompressedKey&, const _CompressedKey&,
+                              const _CompressedKey&, const _CompressedKey&,
+                              _DecompressedValue*)>
+struct FixedDecoder {
+  void operator()(size_t, const uint32_t _lefts[4], const uint32_t _rights[4],
+                  const uint32_t*, _DecompressedValue _values[2]) const {
+    _Decompress(keys[_lefts[0]], keys[_lefts[1]], keys[_lefts[2]],
+                keys[_lefts[3]], &_values[0]);
+    _Decompress(keys[_rights[0]], keys[_rights[1]], keys[_rights[2]],
+                keys[_rights[3]], &_values[1]);
+  }
+  span<const _CompressedKey> keys;
+};
+
+typedef FixedDecoder<internal::Float3Key, math::SoaFloat3, &DecompressFloat3>
+    FixedFloat3Decoder;
+typedef FixedDecoder<internal::QuaternionKey, math::SoaQuaternion,
+                     &DecompressQuaternion>
+    FixedQuaternionDecoder;
+
+// Loads the 64 bits of _stream starting at byte _bit / 8. Stream is padded so
+// that it can always be read from any keyframe.
+inline uint64_t LoadBits(const span<const byte>& _stream, uint32_t _bit) {
+  assert(_bit / 8 + sizeof(uint64_t) <= _stream.size());
+  uint64_t bits;
+  std::memcpy(&bits, _stream.data() + _bit / 8, sizeof(bits));
+  return GetNativeEndianness() == kLittleEndian ? bits : EndianSwap(bits);
+}
+
+// Extracts from each of the 4 _words the _bits wide field starting at bit
+// _shifts.
+#if defined(OZZ_SIMD_AVX2)
+inline math::SimdInt4 ExtractFields(const uint64_t _words[4],
+                                    const uint32_t _shifts[4],
+                                    const uint32_t _bits[4]) {
+  const __m256i words =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_words));
+  const __m256i shifts = _mm256_cvtepu32_epi64(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(_shifts)));
+  const __m256i bits = _mm256_cvtepu32_epi64(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(_bits)));
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i masks = _mm256_sub_epi64(_mm256_sllv_epi64(one, bits), one);
+  const __m256i fields =
+      _mm256_and_si256(_mm256_srlv_epi64(words, shifts), masks);
+  // Fields fit in 32 bits, so only the low part of each 64 bits is kept.
+  return _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+      fields, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7)));
+}
+#else   // OZZ_SIMD_AVX2
+inline math::SimdInt4 ExtractFields(const uint64_t _words[4],
+                                    const uint32_t _shifts[4],
+                                    const uint32_t _bits[4]) {
+  alignas(16) int fields[4];
+  for (int i = 0; i < 4; ++i) {
+    fields[i] = static_cast<int>((_words[i] >> _shifts[i]) &
+                                 ((uint64_t(1) << _bits[i]) - 1));
+  }
+  return math::simd_int4::LoadPtr(fields);
+}
+#endif  // OZZ_SIMD_AVX2
+
+// Decodes variable bit-rate float3 keyframes. See
+// internal::Float3Quantization.
+struct VariableFloat3Decoder {
+  void operator()(size_t _soa_track, const uint32_t*, const uint32_t*,
+                  const uint32_t _locals[4], math::SoaFloat3 _values[2]) const {
+    const internal::Float3Quantization& track = tracks[_soa_track];
+    const math::SimdFloat4 min[3] = {math::simd_float4::LoadPtrU(track.min[0]),
+                                     math::simd_float4::LoadPtrU(track.min[1]),
+                                     math::simd_float4::LoadPtrU(track.min[2])};
+    const math::SimdFloat4 scale[3] = {
+        math::simd_float4::LoadPtrU(track.scale[0]),
+        math::simd_float4::LoadPtrU(track.scale[1]),
+        math::simd_float4::LoadPtrU(track.scale[2])};
+
+    // Right key local index is _locals, left one is the previous.
+    for (uint32_t side = 0; side < 2; ++side) {
+      uint64_t words[4];
+      uint32_t shifts[4];
+      for (int i = 0; i < 4; ++i) {
+        const uint32_t bit =
+            track.offset[i] + (_locals[i] + side - 1) * 3 * track.bits[i];
+        words[i] = LoadBits(stream, bit);
+        shifts[i] = bit & 7;
+      }
+      math::SimdFloat4 cpnts[3];
+      for (int c = 0; c < 3; ++c) {
+        const math::SimdInt4 fields = ExtractFields(words, shifts, track.bits);
+        cpnts[c] = math::MAdd(math::simd_float4::FromInt(fields), scale[c],
+                              min[c]);
+        for (int i = 0; i < 4; ++i) {
+          shifts[i] += track.bits[i];
+        }
+      }
+      _values[side].x = cpnts[0];
+      _values[side].y = cpnts[1];
+      _values[side].z = cpnts[2];
+    }
+  }
+  span<const internal::Float3Quantization> tracks;
+  span<const byte> stream;
+};
+
+// Decodes variable bit-rate quaternion keyframes. See
+// internal::QuaternionQuantization.
+struct VariableQuaternionDecoder {
+  void operator()(size_t _soa_track, const uint32_t*, const uint32_t*,
+                  const uint32_t _locals[4],
+                  math::SoaQuaternion _values[2]) const {
+    const internal::QuaternionQuantization& track = tracks[_soa_track];
+
+    // Dequantization scale depends on the number of bits of each track.
+    alignas(16) float scales[4];
+    for (int i = 0; i < 4; ++i) {
+      scales[i] = math::kSqrt2 / ((1 << track.bits[i]) - 1);
+    }
+    const math::SimdFloat4 scale = math::simd_float4::LoadPtr(scales);
+    static const uint32_t kLargestBits[4] = {2, 2, 2, 2};
+    static const uint32_t kSignBits[4] = {1, 1, 1, 1};
+
+    // Right key local index is _locals, left one is the previous.
+    for (uint32_t side = 0; side < 2; ++side) {
+      uint64_t words[4];
+      uint32_t shifts[4];
+      for (int i = 0; i < 4; ++i) {
+        const uint32_t bit =
+            track.offset[i] + (_locals[i] + side - 1) * (3 + 3 * track.bits[i]);
+        words[i] = LoadBits(stream, bit);
+        shifts[i] = bit & 7;
+      }
+      const math::SimdInt4 largest = ExtractFields(words, shifts, kLargestBits);
+      for (int i = 0; i < 4; ++i) {
+        shifts[i] += 2;
+      }
+      const math::SimdInt4 sign =
+          math::ShiftL(ExtractFields(words, shifts, kSignBits), 31);
+      math::SimdInt4 cpnts[3];
+      for (int c = 0; c < 3; ++c) {
+        for (int i = 0; i < 4; ++i) {
+          shifts[i] += c == 0 ? 1 : track.bits[i];
+        }
+        cpnts[c] = ExtractFields(words, shifts, track.bits);
+      }
+      RestoreQuaternion(largest, sign, cpnts, scale, &_values[side]);
+    }
+  }
+  span<const internal::QuaternionQuantization> tracks;
+  span<const byte> stream;
+};
+
+// Decompresses 4 keyframes tangents to SoA. Translation and scale tangents
+// share float3 keyframes format.
+inline void DecompressTangent(const internal::Float3Key& _k0,
+                              const internal::Float3Key& _k1,
+                              const internal::Float3Key& _k2,
+                              const internal::Float3Key& _k3,
+                              math::SoaFloat3* _soa_float3) {
+  DecompressFloat3(_k0, _k1, _k2, _k3, _soa_float3);
+}
+
+#if defined(OZZ_SIMD_F16C)
+inline void DecompressTangent(const internal::Float4Key& _k0,
+                              const internal::Float4Key& _k1,
+                              const internal::Float4Key& _k2,
+                              const internal::Float4Key& _k3,
+                              math::SoaQuaternion* _soa_quaternion) {
+  const __m128i xy = _mm_setr_epi16(
+      static_cast<short>(_k0.values[0]), static_cast<short>(_k1.values[0]),
+      static_cast<short>(_k2.values[0]), static_cast<short>(_k3.values[0]),
+      static_cast<short>(_k0.values[1]), static_cast<short>(_k1.values[1]),
+      static_cast<short>(_k2.values[1]), static_cast<short>(_k3.values[1]));
+  const __m128i zw = _mm_setr_epi16(
+      static_cast<short>(_k0.values[2]), static_cast<short>(_k1.values[2]),
+      static_cast<short>(_k2.values[2]), static_cast<short>(_k3.values[2]),
+      static_cast<short>(_k0.values[3]), static_cast<short>(_k1.values[3]),
+      static_cast<short>(_k2.values[3]), static_cast<short>(_k3.values[3]));
+  _soa_quaternion->x = _mm_cvtph_ps(xy);
+  _soa_quaternion->y = _mm_cvtph_ps(_mm_unpackhi_epi64(xy, xy));
+  _soa_quaternion->z = _mm_cvtph_ps(zw);
+  _soa_quaternion->w = _mm_cvtph_ps(_mm_unpackhi_epi64(zw, zw));
+}
+#else   // OZZ_SIMD_F16C
+inline void DecompressTangent(const internal::Float4Key& _k0,
+                              const internal::Float4Key& _k1,
+                              const internal::Float4Key& _k2,
+                              const internal::Float4Key& _k3,
+                              math::SoaQuaternion* _soa_quaternion) {
+  _soa_quaternion->x = math::HalfToFloat(math::simd_int4::Load(
+      _k0.values[0], _k1.values[0], _k2.values[0], _k3.values[0]));
+  _soa_quaternion->y = math::HalfToFloat(math::simd_int4::Load(
+      _k0.values[1], _k1.values[1], _k2.values[1], _k3.values[1]));
+  _soa_quaternion->z = math::HalfToFloat(math::simd_int4::Load(
+      _k0.values[2], _k1.values[2], _k2.values[2], _k3.values[2]));
+  _soa_quaternion->w = math::HalfToFloat(math::simd_int4::Load(
+      _k0.values[3], _k1.values[3], _k2.values[3], _k3.values[3]));
+}
+#endif  // OZZ_SIMD_F16C
+
+// Decodes keyframes values with _Decoder, along with their tangents for
+// animations interpolated with cubic Hermite splines.
+template <typename _Decoder, typename _TangentKey, typename _Tangent>
+struct HermiteDecoder {
+  template <typename _DecompressedValue>
+  void operator()(size_t _soa, const uint32_t _lefts[4],
+                  const uint32_t _rights[4], const uint32_t* _locals,
+                  _DecompressedValue _values[2]) const {
+    decoder(_soa, _lefts, _rights, _locals, _values);
+    _Tangent& tangent = tangents[_soa];
+    DecompressTangent(keys[_lefts[0]], keys[_lefts[1]], keys[_lefts[2]],
+                      keys[_lefts[3]], &tangent.value[0]);
+    DecompressTangent(keys[_rights[0]], keys[_rights[1]], keys[_rights[2]],
+                      keys[_rights[3]], &tangent.value[1]);
+  }
+  _Decoder decoder;
+  span<const _TangentKey> keys;
+  span<_Tangent> tangents;
+};
+
+// Decompresses outdated SoA entries with _decoder, and their tangents too if
+// keyframes are interpolated with cubic Hermite splines (_keys isn't empty).
+template <typename _DecompressedKey, typename _Decoder, typename _TangentKey,
+          typename _Tangent>
+inline void Decompress(size_t _num_soa_tracks,
+                       const ozz::span<const float>& _timepoints,
+                       const Animation::KeyframesCtrlConst& _ctrl,
+                       const SamplingJob::Context::Cache& _cache,
+                       const ozz::span<const byte>& _mask,
+                       const ozz::span<_DecompressedKey>& _decompressed,
+                       const _Decoder& _decoder,
+                       const ozz::span<const _TangentKey>& _keys,
+                       const ozz::span<_Tangent>& _tangents) {
+  if (_keys.empty()) {
+    Decompress(_num_soa_tracks, _timepoints, _ctrl, _cache, _mask,
+               _decompressed, _decoder);
+  } else {
+    const HermiteDecoder<_Decoder, _TangentKey, _Tangent> decoder = {
+        _decoder, _keys, _tangents};
+    Decompress(_num_soa_tracks, _timepoints, _ctrl, _cache, _mask,
+               _decompressed, decoder);
+  }
+}
+
+// Compacts _mask to the keyed SoA tracks of a transformation type, so it
+// matches cache entries and decompressed values order.
+inline span<const byte> CompactMask(const span<const byte>& _mask,
+                                    const Animation::ConstantsConst& _constants,
+                                    size_t _num_soa_tracks,
+                                    const span<byte>& _compacted) {
+  if (_mask.empty() || _constants.flags.empty()) {
+    return _mask;
+  }
+  std::fill(_compacted.begin(), _compacted.end(), 0);
+  size_t keyed = 0;
+  for (size_t i = 0; i < _num_soa_tracks; ++i) {
+    if (_constants.constant(i)) {
+      continue;
+    }
+    if (_mask[i / 8] & (1 << (i & 7))) {
+      _compacted[keyed / 8] |= 1 << (keyed & 7);
+    }
+    ++keyed;
+  }
+  return _compacted;
+}
+
+inline math::SoaFloat3 LoadConstantFloat3(const span<const float>& _values,
+                                          size_t _index) {
+  const float* values = &_values[_index * Animation::kFloat3ConstantSize];
+  const math::SoaFloat3 value = {math::simd_float4::LoadPtrU(values + 0),
+                                 math::simd_float4::LoadPtrU(values + 4),
+                                 math::simd_float4::LoadPtrU(values + 8)};
+  return value;
+}
+
+inline math::SoaQuaternion LoadConstantQuaternion(
+    const span<const float>& _values, size_t _index) {
+  const float* values = &_values[_index * Animation::kQuaternionConstantSize];
+  const math::SoaQuaternion value = {math::simd_float4::LoadPtrU(values + 0),
+                                     math::simd_float4::LoadPtrU(values + 4),
+                                     math::simd_float4::LoadPtrU(values + 8),
+                                     math::simd_float4::LoadPtrU(values + 12)};
+  return value;
+}
+
+// Sets _dirty bits of soa track _track joints (soa lanes) whose transform
+// differs from _previous one.
+inline void FlagChanges(const math::SoaTransform& _previous,
+                        const math::SoaTransform& _current, size_t _track,
+                        const span<byte>& _dirty) {
+  const math::SoaFloat3& pt = _previous.translation;
+  const math::SoaFloat3& ct = _current.translation;
+  const math::SoaQuaternion& pr = _previous.rotation;
+  const math::SoaQuaternion& cr = _current.rotation;
+  const math::SoaFloat3& ps = _previous.scale;
+  const math::SoaFloat3& cs = _current.scale;
+  const math::SimdInt4 t = math::Or(
+      math::Or(math::CmpNe(pt.x, ct.x), math::CmpNe(pt.y, ct.y)),
+      math::CmpNe(pt.z, ct.z));
+  const math::SimdInt4 r = math::Or(
+      math::Or(math::CmpNe(pr.x, cr.x), math::CmpNe(pr.y, cr.y)),
+      math::Or(math::CmpNe(pr.z, cr.z), math::CmpNe(pr.w, cr.w)));
+  const math::SimdInt4 s = math::Or(
+      math::Or(math::CmpNe(ps.x, cs.x), math::CmpNe(ps.y, cs.y)),
+      math::CmpNe(ps.z, cs.z));
+  const int changed = math::MoveMask(math::Or(math::Or(t, r), s));
+  _dirty[_track / 2] |= static_cast<byte>(changed << ((_track & 1) * 4));
+}
+
+// Computes cubic Hermite basis functions at _alpha. Tangents basis are scaled
+// by _interval, the ratio interval between the 2 keyframes, as tangents are
+// derivatives relative to the animation ratio.
+inline void HermiteBasis(const math::SimdFloat4& _alpha,
+                         const math::SimdFloat4& _interval,
+                         math::SimdFloat4 _basis[4]) {
+  const math::SimdFloat4 one = math::simd_float4::one();
+  const math::SimdFloat4 two = math::simd_float4::Load1(2.f);
+  const math::SimdFloat4 three = math::simd_float4::Load1(3.f);
+  const math::SimdFloat4 alpha2 = _alpha * _alpha;
+  const math::SimdFloat4 alpha3 = alpha2 * _alpha;
+  _basis[1] = alpha2 * three - alpha3 * two;
+  _basis[0] = one - _basis[1];
+  _basis[2] = (alpha3 - alpha2 * two + _alpha) * _interval;
+  _basis[3] = (alpha3 - alpha2) * _interval;
+}
+
+inline math::SoaFloat3 Hermite(const math::SoaFloat3 _values[2],
+                               const math::SoaFloat3 _tangents[2],
+                               const math::SimdFloat4 _basis[4]) {
+  return _values[0] * _basis[0] + _values[1] * _basis[1] +
+         _tangents[0] * _basis[2] + _tangents[1] * _basis[3];
+}
+
+// Quaternions are interpolated component-wise, and then normalized like
+// NLerpEst does.
+inline math::SoaQuaternion Hermite(const math::SoaQuaternion _values[2],
+                                   const math::SoaQuaternion _tangents[2],
+                                   const math::SimdFloat4 _basis[4]) {
+  return NormalizeEst(_values[0] * _basis[0] + _values[1] * _basis[1] +
+                      _tangents[0] * _basis[2] + _tangents[1] * _basis[3]);
+}
 
 void Interpolates(float _anim_ratio, size_t _num_soa_tracks,
+                  const Animation& _animation,
                   const span<const internal::InterpSoaFloat3>& _translations,
                   const span<const internal::InterpSoaQuaternion>& _rotations,
                   const span<const internal::InterpSoaFloat3>& _scales,
+                  const span<const internal::TangentSoaFloat3>& _t_tangents,
+                  const span<const internal::TangentSoaQuaternion>& _r_tangents,
+                  const span<const internal::TangentSoaFloat3>& _s_tangents,
+                  const span<const byte>& _mask,
+                  const span<const math::SoaTransform>& _rest_pose,
+                  const span<byte>& _dirty,
                   const span<math::SoaTransform>& _output) {
   const math::SimdFloat4 anim_ratio = math::simd_float4::Load1(_anim_ratio);
+  const Animation::ConstantsConst& t_constants =
+      _animation.translations_constants();
+  const Animation::ConstantsConst& r_constants =
+      _animation.rotations_constants();
+  const Animation::ConstantsConst& s_constants = _animation.scales_constants();
+  const bool has_scale = _animation.has_scale();
+
+  // Keyframes are interpolated with cubic Hermite splines if they have
+  // tangents.
+  const bool t_spline = !_animation.translations_tangents().empty();
+  const bool r_spline = !_animation.rotations_tangents().empty();
+  const bool s_spline = !_animation.scales_tangents().empty();
+
+  // Keyed and constant SoA tracks are stored separately, so each
+  // transformation type has its own cursor in both.
+  size_t t_keyed = 0, t_constant = 0;
+  size_t r_keyed = 0, r_constant = 0;
+  size_t s_keyed = 0, s_constant = 0;
   for (size_t i = 0; i < _num_soa_tracks; ++i) {
-    // Prepares interpolation coefficients.
-    const internal::InterpSoaFloat3& t = _translations[i];
-    const math::SimdFloat4 t_ratio =
-        (anim_ratio - t.ratio[0]) * math::RcpEst(t.ratio[1] - t.ratio[0]);
-    const internal::InterpSoaQuaternion& r = _rotations[i];
-    const math::SimdFloat4 r_ratio =
-        (anim_ratio - r.ratio[0]) * math::RcpEst(r.ratio[1] - r.ratio[0]);
-    const internal::InterpSoaFloat3& s = _scales[i];
-    const math::SimdFloat4 s_ratio =
-        (anim_ratio - s.ratio[0]) * math::RcpEst(s.ratio[1] - s.ratio[0]);
-
-    // Processes interpolations.
-    // The lerp of the rotation uses the shortest path, because opposed
-    // quaternions were negated during animation build stage (see
-    // AnimationBuilder).
-    _output[i].translation = Lerp(t.value[0], t.value[1], t_ratio);
-    _output[i].rotation = NLerpEst(r.value[0], r.value[1], r_ratio);
-    _output[i].scale = Lerp(s.value[0], s.value[1], s_ratio);
+    const bool t_is_constant = t_constants.constant(i);
+    const bool r_is_constant = r_constants.constant(i);
+    const bool s_is_constant = s_constants.constant(i);
+
+    // Previous output is kept to detect changes.
+    const bool flag_changes = !_dirty.empty();
+    const math::SoaTransform previous =
+        flag_changes ? _output[i] : math::SoaTransform::identity();
+
+    if (!_mask.empty() && !(_mask[i / 8] & (1 << (i & 7)))) {
+      // Masked out tracks fall back to the rest pose.
+      if (!_rest_pose.empty()) {
+        _output[i] = _rest_pose[i];
+      }
+    } else {
+      // Processes interpolations.
+      // The lerp of the rotation uses the shortest path, because opposed
+      // quaternions were negated during animation build stage (see
+      // AnimationBuilder).
+      if (t_is_constant) {
+        _output[i].translation =
+            LoadConstantFloat3(t_constants.values, t_constant);
+      } else {
+        const internal::InterpSoaFloat3& t = _translations[t_keyed];
+        const math::SimdFloat4 t_interval = t.ratio[1] - t.ratio[0];
+        const math::SimdFloat4 t_ratio =
+            (anim_ratio - t.ratio[0]) * math::RcpEst(t_interval);
+        if (t_spline) {
+          math::SimdFloat4 basis[4];
+          HermiteBasis(t_ratio, t_interval, basis);
+          _output[i].translation =
+              Hermite(t.value, _t_tangents[t_keyed].value, basis);
+        } else {
+          _output[i].translation = Lerp(t.value[0], t.value[1], t_ratio);
+        }
+      }
+
+      if (r_is_constant) {
+        _output[i].rotation =
+            LoadConstantQuaternion(r_constants.values, r_constant);
+      } else {
+        const internal::InterpSoaQuaternion& r = _rotations[r_keyed];
+        const math::SimdFloat4 r_interval = r.ratio[1] - r.ratio[0];
+        const math::SimdFloat4 r_ratio =
+            (anim_ratio - r.ratio[0]) * math::RcpEst(r_interval);
+        if (r_spline) {
+          math::SimdFloat4 basis[4];
+          HermiteBasis(r_ratio, r_interval, basis);
+          _output[i].rotation =
+              Hermite(r.value, _r_tangents[r_keyed].value, basis);
+        } else {
+          _output[i].rotation = NLerpEst(r.value[0], r.value[1], r_ratio);
+        }
+      }
+
+      if (!has_scale) {
+        _output[i].scale = math::SoaFloat3::one();
+      } else if (s_is_constant) {
+        _output[i].scale = LoadConstantFloat3(s_constants.values, s_constant);
+      } else {
+        const internal::InterpSoaFloat3& s = _scales[s_keyed];
+        const math::SimdFloat4 s_interval = s.ratio[1] - s.ratio[0];
+        const math::SimdFloat4 s_ratio =
+            (anim_ratio - s.ratio[0]) * math::RcpEst(s_interval);
+        if (s_spline) {
+          math::SimdFloat4 basis[4];
+          HermiteBasis(s_ratio, s_interval, basis);
+          _output[i].scale =
+              Hermite(s.value, _s_tangents[s_keyed].value, basis);
+        } else {
+          _output[i].scale = Lerp(s.value[0], s.value[1], s_ratio);
+        }
+      }
+    }
+
+    if (flag_changes) {
+      FlagChanges(previous, _output[i], i, _dirty);
+    }
+
+    // Steps cursors.
+    t_constant += t_is_constant;
+    t_keyed += !t_is_constant;
+    r_constant += r_is_constant;
+    r_keyed += !r_is_constant;
+    s_constant += s_is_constant;
+    s_keyed += !s_is_constant;
   }
 }
 }  // namespace
@@ -2439,42 +3754,114 @@ bool SamplingJob::Run() const {
   const float previous_ratio = context->Step(*animation, clamped_ratio);
 
   // Update cache with animation keyframe indexes for t = ratio.
-  // Decompresses outdated soa hot values.
+  // Decompresses outdated soa hot values. Constant SoA tracks have no keyframe,
+  // so only keyed SoA tracks are processed.
+  const span<const float>& timepoints = animation->timepoints();
 
   // Translations
-  const Animation::KeyframesCtrlConst& translations_ctrl =
-      animation->translations_ctrl();
-  UpdateCache(clamped_ratio, previous_ratio, num_soa_tracks,
-              animation->timepoints(), translations_ctrl,
-              context->translations_cache_);
-  Decompress(num_soa_tracks, animation->timepoints(), translations_ctrl,
-             animation->translations_values(), context->translations_cache_,
-             context->translations_, &DecompressFloat3);
+  const Animation::ConstantsConst& translations_constants =
+      animation->translations_constants();
+  if (translations_constants.num_keyed_soa_tracks > 0) {
+    const size_t num_keyed =
+        static_cast<size_t>(translations_constants.num_keyed_soa_tracks);
+    const Animation::KeyframesCtrlConst& translations_ctrl =
+        animation->translations_ctrl();
+    const Animation::Float3QuantizationConst& translations_quantization =
+        animation->translations_quantization();
+    UpdateCache(clamped_ratio, previous_ratio, num_keyed, timepoints,
+                translations_ctrl, translations_quantization.variable(),
+                context->translations_cache_);
+    const span<const byte>& translations_mask =
+        CompactMask(track_mask, translations_constants, num_soa_tracks,
+                    context->keyed_mask_);
+    if (translations_quantization.variable()) {
+      const VariableFloat3Decoder decoder = {translations_quantization.tracks,
+                                             translations_quantization.stream};
+      Decompress(num_keyed, timepoints, translations_ctrl,
+                 context->translations_cache_, translations_mask,
+                 context->translations_, decoder,
+                 animation->translations_tangents(),
+                 context->translations_tangents_);
+    } else {
+      const FixedFloat3Decoder decoder = {animation->translations_values()};
+      Decompress(num_keyed, timepoints, translations_ctrl,
+                 context->translations_cache_, translations_mask,
+                 context->translations_, decoder,
+                 animation->translations_tangents(),
+                 context->translations_tangents_);
+    }
+  }
 
   // Rotations
-  const Animation::KeyframesCtrlConst& rotations_ctrl =
-      animation->rotations_ctrl();
-  UpdateCache(clamped_ratio, previous_ratio, num_soa_tracks,
-              animation->timepoints(), rotations_ctrl,
-              context->rotations_cache_);
-  Decompress(num_soa_tracks, animation->timepoints(), rotations_ctrl,
-             animation->rotations_values(), context->rotations_cache_,
-             context->rotations_, &DecompressQuaternion);
+  const Animation::ConstantsConst& rotations_constants =
+      animation->rotations_constants();
+  if (rotations_constants.num_keyed_soa_tracks > 0) {
+    const size_t num_keyed =
+        static_cast<size_t>(rotations_constants.num_keyed_soa_tracks);
+    const Animation::KeyframesCtrlConst& rotations_ctrl =
+        animation->rotations_ctrl();
+    const Animation::QuaternionQuantizationConst& rotations_quantization =
+        animation->rotations_quantization();
+    UpdateCache(clamped_ratio, previous_ratio, num_keyed, timepoints,
+                rotations_ctrl, rotations_quantization.variable(),
+                context->rotations_cache_);
+    const span<const byte>& rotations_mask =
+        CompactMask(track_mask, rotations_constants, num_soa_tracks,
+                    context->keyed_mask_);
+    if (rotations_quantization.variable()) {
+      const VariableQuaternionDecoder decoder = {rotations_quantization.tracks,
+                                                 rotations_quantization.stream};
+      Decompress(num_keyed, timepoints, rotations_ctrl,
+                 context->rotations_cache_, rotations_mask, context->rotations_,
+                 decoder, animation->rotations_tangents(),
+                 context->rotations_tangents_);
+    } else {
+      const FixedQuaternionDecoder decoder = {animation->rotations_values()};
+      Decompress(num_keyed, timepoints, rotations_ctrl,
+                 context->rotations_cache_, rotations_mask, context->rotations_,
+                 decoder, animation->rotations_tangents(),
+                 context->rotations_tangents_);
+    }
+  }
 
   // Scales
-  const Animation::KeyframesCtrlConst& scales_ctrl = animation->scales_ctrl();
-  UpdateCache(clamped_ratio, previous_ratio, num_soa_tracks,
-              animation->timepoints(), scales_ctrl, context->scales_cache_);
-  Decompress(num_soa_tracks, animation->timepoints(), scales_ctrl,
-             animation->scales_values(), context->scales_cache_,
-             context->scales_, &DecompressFloat3);
+  const Animation::ConstantsConst& scales_constants =
+      animation->scales_constants();
+  if (scales_constants.num_keyed_soa_tracks > 0) {
+    const size_t num_keyed =
+        static_cast<size_t>(scales_constants.num_keyed_soa_tracks);
+    const Animation::KeyframesCtrlConst& scales_ctrl = animation->scales_ctrl();
+    const Animation::Float3QuantizationConst& scales_quantization =
+        animation->scales_quantization();
+    UpdateCache(clamped_ratio, previous_ratio, num_keyed, timepoints,
+                scales_ctrl, scales_quantization.variable(),
+                context->scales_cache_);
+    const span<const byte>& scales_mask =
+        CompactMask(track_mask, scales_constants, num_soa_tracks,
+                    context->keyed_mask_);
+    if (scales_quantization.variable()) {
+      const VariableFloat3Decoder decoder = {scales_quantization.tracks,
+                                             scales_quantization.stream};
+      Decompress(num_keyed, timepoints, scales_ctrl, context->scales_cache_,
+                 scales_mask, context->scales_, decoder,
+                 animation->scales_tangents(), context->scales_tangents_);
+    } else {
+      const FixedFloat3Decoder decoder = {animation->scales_values()};
+      Decompress(num_keyed, timepoints, scales_ctrl, context->scales_cache_,
+                 scales_mask, context->scales_, decoder,
+                 animation->scales_tangents(), context->scales_tangents_);
+    }
+  }
 
   // Only interp as much as we have output for.
   const size_t num_soa_interp_tracks = math::Min(output.size(), num_soa_tracks);
 
   // Interpolates soa hot data.
-  Interpolates(clamped_ratio, num_soa_interp_tracks, context->translations_,
-               context->rotations_, context->scales_, output);
+  Interpolates(clamped_ratio, num_soa_interp_tracks, *animation,
+               context->translations_, context->rotations_, context->scales_,
+               context->translations_tangents_, context->rotations_tangents_,
+               context->scales_tangents_, track_mask, rest_pose, dirty,
+               output);
 
   return true;
 }
@@ -2487,17 +3874,22 @@ SamplingJob::Context::Context(int _max_tracks) : max_soa_tracks_(0) {
 
 SamplingJob::Context::~Context() {
   // translations interp is the allocation pointer, so this deallocates
-  // everything at once.
+  // everything at once. Tangents have their own allocation.
   memory::default_allocator()->Deallocate(translations_.data());
+  memory::default_allocator()->Deallocate(translations_tangents_.data());
 }
 
 void SamplingJob::Context::Resize(int _max_tracks) {
   using internal::InterpSoaFloat3;
   using internal::InterpSoaQuaternion;
 
-  // Reset existing data.
+  // Reset existing data. Tangents are reallocated on demand.
   Invalidate();
   memory::default_allocator()->Deallocate(translations_.data());
+  memory::default_allocator()->Deallocate(translations_tangents_.data());
+  translations_tangents_ = {};
+  rotations_tangents_ = {};
+  scales_tangents_ = {};
 
   // Updates maximum supported soa tracks.
   max_soa_tracks_ = (math::Max(0, _max_tracks) + 3) / 4;
@@ -2516,7 +3908,9 @@ void SamplingJob::Context::Resize(int _max_tracks) {
       sizeof(InterpSoaQuaternion) * max_soa_tracks +
       sizeof(InterpSoaFloat3) * max_soa_tracks +
       sizeof(uint32_t) * max_tracks * 3 +  // trans + rot + scale.
-      sizeof(uint8_t) * 3 * num_outdated;
+      sizeof(uint32_t) * max_tracks * 3 +  // Local indices.
+      sizeof(uint8_t) * 3 * num_outdated +
+      sizeof(uint8_t) * num_outdated;  // Compacted mask.
 
   // Allocates all at once.
   memory::Allocator* allocator = memory::default_allocator();
@@ -2539,11 +3933,16 @@ void SamplingJob::Context::Resize(int _max_tracks) {
   translations_cache_.entries = fill_span<uint32_t>(buffer, max_tracks);
   rotations_cache_.entries = fill_span<uint32_t>(buffer, max_tracks);
   scales_cache_.entries = fill_span<uint32_t>(buffer, max_tracks);
+  translations_cache_.locals = fill_span<uint32_t>(buffer, max_tracks);
+  rotations_cache_.locals = fill_span<uint32_t>(buffer, max_tracks);
+  scales_cache_.locals = fill_span<uint32_t>(buffer, max_tracks);
 
   translations_cache_.outdated = fill_span<byte>(buffer, num_outdated);
   rotations_cache_.outdated = fill_span<byte>(buffer, num_outdated);
   scales_cache_.outdated = fill_span<byte>(buffer, num_outdated);
 
+  keyed_mask_ = fill_span<byte>(buffer, num_outdated);
+
   assert(buffer.empty());
 }
 
@@ -2552,12 +3951,38 @@ float SamplingJob::Context::Step(const Animation& _animation, float _ratio) {
   if (animation_ != &_animation) {
     Invalidate();
     animation_ = &_animation;
+    if (translations_tangents_.empty() &&
+        (!_animation.translations_tangents().empty() ||
+         !_animation.rotations_tangents().empty() ||
+         !_animation.scales_tangents().empty())) {
+      AllocateTangents();
+    }
   }
   const float previous_ratio = ratio_;
   ratio_ = _ratio;
   return previous_ratio;
 }
 
+void SamplingJob::Context::AllocateTangents() {
+  using internal::TangentSoaFloat3;
+  using internal::TangentSoaQuaternion;
+
+  const size_t max_soa_tracks = static_cast<size_t>(max_soa_tracks_);
+  const size_t size = sizeof(TangentSoaFloat3) * max_soa_tracks +
+                      sizeof(TangentSoaQuaternion) * max_soa_tracks +
+                      sizeof(TangentSoaFloat3) * max_soa_tracks;
+  memory::Allocator* allocator = memory::default_allocator();
+  span<byte> buffer = {
+      static_cast<byte*>(allocator->Allocate(size, alignof(TangentSoaFloat3))),
+      size};
+  static_assert(alignof(TangentSoaFloat3) >= alignof(TangentSoaQuaternion),
+                "Must serve larger alignment values first)");
+  translations_tangents_ = fill_span<TangentSoaFloat3>(buffer, max_soa_tracks);
+  rotations_tangents_ = fill_span<TangentSoaQuaternion>(buffer, max_soa_tracks);
+  scales_tangents_ = fill_span<TangentSoaFloat3>(buffer, max_soa_tracks);
+  assert(buffer.empty());
+}
+
 void SamplingJob::Context::Invalidate() {
   animation_ = nullptr;
   ratio_ = 0.f;
@@ -2611,11 +4036,12 @@ void SamplingJob::Context::Invalidate() {
 namespace ozz {
 namespace animation {
 
-Skeleton::Skeleton() {}
+Skeleton::Skeleton() : ordering_(kDepthFirst) {}
 
 Skeleton::Skeleton(Skeleton&& _other) { *this = std::move(_other); }
 
 Skeleton& Skeleton::operator=(Skeleton&& _other) {
+  std::swap(ordering_, _other.ordering_);
   std::swap(joint_rest_poses_, _other.joint_rest_poses_);
   std::swap(joint_parents_, _other.joint_parents_);
   std::swap(joint_names_, _other.joint_names_);
@@ -2677,6 +4103,7 @@ void Skeleton::Deallocate() {
   joint_rest_poses_ = {};
   joint_names_ = {};
   joint_parents_ = {};
+  ordering_ = kDepthFirst;
 }
 
 void Skeleton::Save(ozz::io::OArchive& _archive) const {
@@ -2698,13 +4125,14 @@ void Skeleton::Save(ozz::io::OArchive& _archive) const {
   _archive << ozz::io::MakeArray(joint_names_[0], chars_count);
   _archive << ozz::io::MakeArray(joint_parents_);
   _archive << ozz::io::MakeArray(joint_rest_poses_);
+  _archive << static_cast<uint8_t>(ordering_);
 }
 
 void Skeleton::Load(ozz::io::IArchive& _archive, uint32_t _version) {
   // Deallocate skeleton in case it was already used before.
   Deallocate();
 
-  if (_version != 2) {
+  if (_version < 2 || _version > 3) {
     log::Err() << "Unsupported Skeleton version " << _version << "."
                << std::endl;
     return;
@@ -2735,6 +4163,13 @@ void Skeleton::Load(ozz::io::IArchive& _archive, uint32_t _version) {
 
   _archive >> ozz::io::MakeArray(joint_parents_);
   _archive >> ozz::io::MakeArray(joint_rest_poses_);
+
+  // Version 2 skeletons are always depth-first.
+  if (_version >= 3) {
+    uint8_t ordering;
+    _archive >> ordering;
+    ordering_ = static_cast<Ordering>(ordering);
+  }
 }
 }  // namespace animation
 }  // namespace ozz
@@ -2789,6 +4224,18 @@ int FindJoint(const Skeleton& _skeleton, const char* _name) {
   return -1;
 }
 
+void SetAncestorBits(const Skeleton& _skeleton, const span<byte>& _bits) {
+  // Parents are always before their children, so a single reverse traversal
+  // propagates bits up to the roots.
+  const span<const int16_t>& parents = _skeleton.joint_parents();
+  for (int i = _skeleton.num_joints() - 1; i >= 0; --i) {
+    const int parent = parents[i];
+    if (parent != Skeleton::kNoParent && TestJointBit(_bits, i)) {
+      SetJointBit(_bits, parent);
+    }
+  }
+}
+
 // Unpacks skeleton rest pose stored in soa format by the skeleton.
 ozz::math::Transform GetJointLocalRestPose(const Skeleton& _skeleton,
                                            int _joint) {
@@ -347,6 +347,85 @@ math::Float3 LerpScale(const math::Float3& _a, const math::Float3& _b,
   return math::Lerp(_a, _b, _alpha);
 }
 
+namespace {
+// Computes cubic Hermite basis functions at _alpha.
+void HermiteBasis(float _alpha, float _basis[4]) {
+  const float alpha2 = _alpha * _alpha;
+  const float alpha3 = alpha2 * _alpha;
+  _basis[1] = 3.f * alpha2 - 2.f * alpha3;
+  _basis[0] = 1.f - _basis[1];
+  _basis[2] = alpha3 - 2.f * alpha2 + _alpha;
+  _basis[3] = alpha3 - alpha2;
+}
+
+// Computes the slope from _a to _b, aka Catmull-Rom tangent. Returns 0 if
+// keys are at the same time, as a track's single key is its own previous and
+// next key.
+template <typename _Value>
+_Value Slope(const _Value& _a, float _a_time, const _Value& _b, float _b_time) {
+  const float interval = _b_time - _a_time;
+  if (interval <= 0.f) {
+    return _a * 0.f;
+  }
+  return (_b + -_a) * (1.f / interval);
+}
+}  // namespace
+
+// Hermite interpolation methods must match the ones used by the sampling job.
+math::Float3 HermiteTranslation(const math::Float3& _a, const math::Float3& _ta,
+                                const math::Float3& _b, const math::Float3& _tb,
+                                float _alpha) {
+  float basis[4];
+  HermiteBasis(_alpha, basis);
+  return _a * basis[0] + _b * basis[1] + _ta * basis[2] + _tb * basis[3];
+}
+
+// Like LerpRotation, takes the shortest path between _a and _b. Quaternions
+// are interpolated component-wise and then normalized.
+math::Quaternion HermiteRotation(const math::Quaternion& _a,
+                                 const math::Quaternion& _ta,
+                                 const math::Quaternion& _b,
+                                 const math::Quaternion& _tb, float _alpha) {
+  const float dot = _a.x * _b.x + _a.y * _b.y + _a.z * _b.z + _a.w * _b.w;
+  const float sign = dot < 0.f ? -1.f : 1.f;
+  float basis[4];
+  HermiteBasis(_alpha, basis);
+  return math::Normalize(_a * basis[0] + _b * (basis[1] * sign) +
+                         _ta * basis[2] + _tb * (basis[3] * sign));
+}
+
+math::Float3 HermiteScale(const math::Float3& _a, const math::Float3& _ta,
+                          const math::Float3& _b, const math::Float3& _tb,
+                          float _alpha) {
+  return HermiteTranslation(_a, _ta, _b, _tb, _alpha);
+}
+
+math::Float3 TangentTranslation(const RawAnimation::TranslationKey& _prev,
+                                const RawAnimation::TranslationKey& _key,
+                                const RawAnimation::TranslationKey& _next) {
+  (void)_key;
+  return Slope(_prev.value, _prev.time, _next.value, _next.time);
+}
+
+math::Quaternion TangentRotation(const RawAnimation::RotationKey& _prev,
+                                 const RawAnimation::RotationKey& _key,
+                                 const RawAnimation::RotationKey& _next) {
+  // Aligns neighbours to _key hemisphere, so the tangent takes the shortest
+  // path.
+  const math::Quaternion prev =
+      Dot(_prev.value, _key.value) < 0.f ? -_prev.value : _prev.value;
+  const math::Quaternion next =
+      Dot(_next.value, _key.value) < 0.f ? -_next.value : _next.value;
+  return Slope(prev, _prev.time, next, _next.time);
+}
+
+math::Float3 TangentScale(const RawAnimation::ScaleKey& _prev,
+                          const RawAnimation::ScaleKey& _key,
+                          const RawAnimation::ScaleKey& _next) {
+  (void)_key;
+  return Slope(_prev.value, _prev.time, _next.value, _next.time);
+}
+
 namespace {
 
 // The next functions are used to sample a RawAnimation. This feature is not
@@ -599,6 +678,13 @@ struct QuaternionKey {
   static constexpr float kfScale = 1.f * kiScale;
 };
 
+// Defines the tangent key frame type of rotations, used by cubic Hermite
+// spline animations. Quaternion tangents aren't normalized, so the 4
+// components are stored as half precision floats.
+struct Float4Key {
+  uint16_t values[4];
+};
+
 // Endianness independent load and store
 inline void pack(int _largest, int _sign, const int _cpnt[3],
                  QuaternionKey* _key) {
@@ -622,11 +708,183 @@ inline void unpack(const QuaternionKey& _key, int& _biggest, int& _sign,
   _cpnt[2] = _key.values[2] >> 1;
 }
 
+// Variable bit-rate quantization of a keyed SoA track of float3 (translations
+// and scales). Keyframes of each of the 4 tracks are stored consecutively in a
+// bit stream. Each component is quantized on the same number of bits within
+// the track range, so that value = min + quantized * scale.
+struct Float3Quantization {
+  float min[3][4];
+  float scale[3][4];
+
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range [0,kMaxBits]. A
+  // keyframe is made of 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMaxBits = 16;
+};
+
+// Variable bit-rate quantization of a keyed SoA track of quaternions.
+// Keyframes use QuaternionKey bit layout (largest component index, sign, then
+// the 3 smallest components), with a number of bits per component chosen per
+// track.
+struct QuaternionQuantization {
+  // Bit offset of the first keyframe of each track in the stream.
+  uint32_t offset[4];
+
+  // Number of bits per component of each track, in range
+  // [kMinBits,QuaternionKey::kBits]. A keyframe is made of 3 + 3 * bits bits.
+  uint32_t bits[4];
+
+  static constexpr int kMinBits = 4;
+};
+
 }  // namespace internal
 }  // namespace animation
 }  // namespace ozz
 #endif  // OZZ_ANIMATION_RUNTIME_ANIMATION_KEYFRAME_H_
 
+// Includes internal include file animation/offline/decimate.h
+
+//----------------------------------------------------------------------------//
+//                                                                            //
+// ozz-animation is hosted at http://github.com/guillaumeblanc/ozz-animation  //
+// and distributed under the MIT License (MIT).                               //
+//                                                                            //
+// Copyright (c) Guillaume Blanc                                              //
+//                                                                            //
+// Permission is hereby granted, free of charge, to any person obtaining a    //
+// copy of this software and associated documentation files (the "Software"), //
+// to deal in the Software without restriction, including without limitation  //
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,   //
+// and/or sell copies of the Software, and to permit persons to whom the      //
+// Software is furnished to do so, subject to the following conditions:       //
+//                                                                            //
+// The above copyright notice and this permission notice shall be included in //
+// all copies or substantial portions of the Software.                        //
+//                                                                            //
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR //
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,   //
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL    //
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER //
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING    //
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER        //
+// DEALINGS IN THE SOFTWARE.                                                  //
+//                                                                            //
+//----------------------------------------------------------------------------//
+
+#ifndef OZZ_ANIMATION_OFFLINE_DECIMATE_H_
+#define OZZ_ANIMATION_OFFLINE_DECIMATE_H_
+
+#ifndef OZZ_INCLUDE_PRIVATE_HEADER
+#error "This header is private, it cannot be included from public headers."
+#endif  // OZZ_INCLUDE_PRIVATE_HEADER
+
+#include "ozz/base/containers/stack.h"
+#include "ozz/base/containers/vector.h"
+
+#include <cassert>
+
+namespace ozz {
+namespace animation {
+namespace offline {
+
+// Decimation algorithm based on Ramer-Douglas-Peucker.
+// https://en.wikipedia.org/wiki/Ramer%E2%80%93Douglas%E2%80%93Peucker_algorithm
+// _Track must have std::vector interface.
+// Adapter must have the following interface:
+// struct Adapter {
+//  bool Decimable(const Key&) const;
+//  Key Lerp(const Key& _left, const Key& _right, const Key& _ref) const;
+//  float Distance(const Key& _a, const Key& _b) const;
+// };
+template <typename _Track, typename _Adapter>
+void Decimate(const _Track& _src, const _Adapter& _adapter, float _tolerance,
+              _Track* _dest) {
+  // Early out if not enough data.
+  if (_src.size() < 2) {
+    *_dest = _src;
+    return;
+  }
+
+  // Stack of segments to process.
+  typedef std::pair<size_t, size_t> Segment;
+  ozz::stack<Segment> segments;
+
+  // Bit vector of all points to included.
+  ozz::vector<bool> included(_src.size(), false);
+
+  // Pushes segment made from first and last points.
+  segments.push(Segment(0, _src.size() - 1));
+  included[0] = true;
+  included[_src.size() - 1] = true;
+
+  // Empties segments stack.
+  while (!segments.empty()) {
+    // Pops next segment to process.
+    const Segment segment = segments.top();
+    segments.pop();
+
+    // Looks for the furthest point from the segment.
+    float max = -1.f;
+    size_t candidate = segment.first;
+    typename _Track::const_reference left = _src[segment.first];
+    typename _Track::const_reference right = _src[segment.second];
+    for (size_t i = segment.first + 1; i < segment.second; ++i) {
+      assert(!included[i] && "Included points should be processed once only.");
+      typename _Track::const_reference test = _src[i];
+      if (!_adapter.Decimable(test)) {
+        candidate = i;
+        break;
+      } else {
+        const float distance =
+            _adapter.Distance(_adapter.Lerp(left, right, test), test);
+        if (distance > _tolerance && distance > max) {
+          max = distance;
+          candidate = i;
+        }
+      }
+    }
+
+    // If found, include the point and pushes the 2 new segments (before and
+    // after the new point).
+    if (candidate != segment.first) {
+      included[candidate] = true;
+      if (candidate - segment.first > 1) {
+        segments.push(Segment(segment.first, candidate));
+      }
+      if (segment.second - candidate > 1) {
+        segments.push(Segment(candidate, segment.second));
+      }
+    }
+  }
+
+  // Copy all included points.
+  _dest->clear();
+  for (size_t i = 0; i < _src.size(); ++i) {
+    if (included[i]) {
+      _dest->push_back(_src[i]);
+    }
+  }
+
+  // Removes last key if constant.
+  if (_dest->size() > 1) {
+    typename _Track::const_iterator end = _dest->end();
+    typename _Track::const_reference last = *(--end);
+    typename _Track::const_reference penultimate = *(--end);
+    const float distance = _adapter.Distance(penultimate, last);
+    if (_adapter.Decimable(last) && distance <= _tolerance) {
+      _dest->pop_back();
+    }
+  }
+}
+}  // namespace offline
+}  // namespace animation
+}  // namespace ozz
+#endif  // OZZ_ANIMATION_OFFLINE_DECIMATE_H_
+
 
 namespace ozz {
 namespace animation {
@@ -635,15 +893,30 @@ namespace {
 
 template <typename _Key>
 struct SortingKey {
+  typedef typename _Key::Value Value;
   uint16_t track;
   float prev_key_time;
   _Key key;
+  Value tangent;  // Only used by cubic Hermite splines, per time unit.
 };
 
 typedef SortingKey<RawAnimation::TranslationKey> SortingTranslationKey;
 typedef SortingKey<RawAnimation::RotationKey> SortingQuaternionKey;
 typedef SortingKey<RawAnimation::ScaleKey> SortingScaleKey;
 
+// Tangent of keys copied from the raw animation, before ComputeTangents sets
+// spline ones.
+template <typename _Value>
+_Value ZeroTangent();
+template <>
+math::Float3 ZeroTangent() {
+  return math::Float3::zero();
+}
+template <>
+math::Quaternion ZeroTangent() {
+  return math::Quaternion(0.f, 0.f, 0.f, 0.f);
+}
+
 // Keyframe sorting. Stores first by time and then track number.
 template <typename _Key>
 bool SortingKeyLess(const _Key& _left, const _Key& _right) {
@@ -658,7 +931,8 @@ void PushBackIdentityKey(uint16_t _track, float _time, _DestTrack* _dest) {
   if (!_dest->empty() && _dest->back().track == _track) {
     prev_time = _dest->back().key.time;
   }
-  const DestKey key = {_track, prev_time, {_time, _SrcKey::identity()}};
+  const DestKey key = {_track, prev_time, {_time, _SrcKey::identity()},
+                       ZeroTangent<typename DestKey::Value>()};
   _dest->push_back(key);
 }
 
@@ -669,6 +943,8 @@ void CopyRaw(const _SrcTrack& _src, uint16_t _track, float _duration,
              _DestTrack* _dest) {
   typedef typename _SrcTrack::value_type SrcKey;
   typedef typename _DestTrack::value_type DestKey;
+  const typename DestKey::Value tangent =
+      ZeroTangent<typename DestKey::Value>();
 
   if (_src.size() == 0) {  // Adds 2 new keys.
     PushBackIdentityKey<SrcKey, _DestTrack>(_track, 0.f, _dest);
@@ -676,26 +952,29 @@ void CopyRaw(const _SrcTrack& _src, uint16_t _track, float _duration,
   } else if (_src.size() == 1) {  // Adds 1 new key.
     const SrcKey& raw_key = _src.front();
     assert(raw_key.time >= 0 && raw_key.time <= _duration);
-    const DestKey first = {_track, -1.f, {0.f, raw_key.value}};
+    const DestKey first = {_track, -1.f, {0.f, raw_key.value}, tangent};
     _dest->push_back(first);
-    const DestKey last = {_track, 0.f, {_duration, raw_key.value}};
+    const DestKey last = {_track, 0.f, {_duration, raw_key.value}, tangent};
     _dest->push_back(last);
   } else {  // Copies all keys, and fixes up first and last keys.
     float prev_time = -1.f;
     if (_src.front().time != 0.f) {  // Needs a key at t = 0.f.
-      const DestKey first = {_track, prev_time, {0.f, _src.front().value}};
+      const DestKey first = {_track, prev_time, {0.f, _src.front().value},
+                             tangent};
       _dest->push_back(first);
       prev_time = 0.f;
     }
     for (size_t k = 0; k < _src.size(); ++k) {  // Copies all keys.
       const SrcKey& raw_key = _src[k];
       assert(raw_key.time >= 0 && raw_key.time <= _duration);
-      const DestKey key = {_track, prev_time, {raw_key.time, raw_key.value}};
+      const DestKey key = {_track, prev_time, {raw_key.time, raw_key.value},
+                           tangent};
       _dest->push_back(key);
       prev_time = raw_key.time;
     }
     if (_src.back().time - _duration != 0.f) {  // Needs a key at t = _duration.
-      const DestKey last = {_track, prev_time, {_duration, _src.back().value}};
+      const DestKey last = {_track, prev_time,
+                            {_duration, _src.back().value}, tangent};
       _dest->push_back(last);
     }
   }
@@ -703,9 +982,37 @@ void CopyRaw(const _SrcTrack& _src, uint16_t _track, float _duration,
          _dest->back().key.time - _duration == 0.f);
 }
 
-template <typename _SortingKey, class _Lerp, class _Compare>
+// Computes the key injected in the middle of _a and _b keys of a track, when
+// they're too far from each other.
+template <typename _SortingKey>
+struct Splitter {
+  typedef typename _SortingKey::Value Value;
+  _SortingKey operator()(const _SortingKey& _a, const _SortingKey& _b) const {
+    _SortingKey key = {_a.track,
+                       _a.key.time,
+                       {(_a.key.time + _b.key.time) * .5f, _a.key.value},
+                       _a.tangent};
+    if (spline) {
+      const float interval = _b.key.time - _a.key.time;
+      key.key.value = hermite(_a.key.value, _a.tangent * interval,
+                              _b.key.value, _b.tangent * interval, .5f);
+      // Derivative of the spline at its middle.
+      key.tangent = (_b.key.value + -_a.key.value) * (1.5f / interval) +
+                    (_a.tangent + _b.tangent) * -.25f;
+    } else {
+      key.key.value = lerp(_a.key.value, _b.key.value, .5f);
+    }
+    return key;
+  }
+  Value (*lerp)(const Value&, const Value&, float);
+  Value (*hermite)(const Value&, const Value&, const Value&, const Value&,
+                   float);
+  bool spline;
+};
+
+template <typename _SortingKey, class _Split, class _Compare>
 void Sort(ozz::vector<_SortingKey>& _src, size_t _num_tracks,
-          const _Lerp& _lerp, const _Compare& _comp) {
+          const _Split& _split, const _Compare& _comp) {
   // Sorts whole vector
   std::sort(_src.begin(), _src.end(), _comp);
 
@@ -735,11 +1042,7 @@ void Sort(ozz::vector<_SortingKey>& _src, size_t _num_tracks,
         const _SortingKey penultimate = _src[previous.second];
 
         // Prepares new key to insert.
-        const _SortingKey insert = {
-            track,
-            penultimate.key.time,
-            {(penultimate.key.time + last.key.time) * .5f,
-             _lerp(penultimate.key.value, last.key.value, .5f)}};
+        const _SortingKey insert = _split(penultimate, last);
 
         // Removes previous.first key that is changing and needs to be resorted.
         _src.erase(_src.begin() + previous.first);
@@ -786,15 +1089,16 @@ uint16_t TimePointToIndex(const span<const float>& _timepoints, float _time) {
   return static_cast<uint16_t>(distance);
 }
 
+// Fills keyframes controllers and compresses keyframes values. _dest is empty
+// for variable bit-rate keyframes, in which case only controllers are filled.
 template <typename _SortingKey, typename _DestKey, typename _Compressor>
 void Compress(const span<const float>& _timepoints,
               const span<_SortingKey>& _src, size_t _num_tracks,
               const span<_DestKey> _dest, const Animation::KeyframesCtrl& _base,
               const _Compressor& _compressor) {
-  ozz::vector<_DestKey*> previouses(_num_tracks);
+  ozz::vector<ptrdiff_t> previouses(_num_tracks, -1);
   for (size_t i = 0; i < _src.size(); ++i) {
     const _SortingKey& src = _src[i];
-    _DestKey& dest_key = _dest[i];
 
     // Ratio
     const uint16_t ratio = TimePointToIndex(_timepoints, src.key.time);
@@ -806,16 +1110,19 @@ void Compress(const span<const float>& _timepoints,
     }
 
     // Previous
+    const ptrdiff_t previous = previouses[src.track];
     const ptrdiff_t diff =
-        previouses[src.track] ? &dest_key - previouses[src.track] : 0;
+        previous >= 0 ? static_cast<ptrdiff_t>(i) - previous : 0;
     assert(diff < ozz::animation::internal::kMaxPreviousOffset);
     _base.previouses[i] = static_cast<uint16_t>(diff);
 
     // Value
-    _compressor(src.key.value, &dest_key);
+    if (!_dest.empty()) {
+      _compressor(src.key.value, &_dest[i]);
+    }
 
     // Stores track position
-    previouses[src.track] = &dest_key;
+    previouses[src.track] = static_cast<ptrdiff_t>(i);
   }
 }
 
@@ -831,35 +1138,45 @@ bool LessAbs(float _left, float _right) {
   return std::abs(_left) < std::abs(_right);
 }
 
-// Compresses quaternion to ozz::animation::RotationKey format.
-// The 3 smallest components of the quaternion are quantized to x bits
+// Components of the quaternion that are stored, depending on the largest one.
+const int kQuaternionMapping[4][3] = {
+    {1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}};
+
+// Quantizes quaternion to ozz::animation::RotationKey format.
+// The 3 smallest components of the quaternion are quantized to _bits bits
 // integers, while the largest is recomputed thanks to quaternion
 // normalization property (x^2+y^2+z^2+w^2 = 1). Because the 3 components are
 // the 3 smallest, their value cannot be greater than sqrt(2)/2. Thus
 // quantization quality is improved by pre-multiplying each componenent by
 // sqrt(2).
-void CompressQuaternion(const ozz::math::Quaternion& _src,
-                        ozz::animation::internal::QuaternionKey* _dest) {
+void QuantizeQuaternion(const ozz::math::Quaternion& _src, int _bits,
+                        int* _largest, int* _sign, int _cpnt[3]) {
   // Finds the largest quaternion component.
   const float quat[4] = {_src.x, _src.y, _src.z, _src.w};
   const ptrdiff_t largest = std::max_element(quat, quat + 4, LessAbs) - quat;
   assert(largest <= 3);
+  *_largest = static_cast<int>(largest);
+  *_sign = quat[largest] < 0.f;
 
   // Quantize the 3 smallest components on x bits signed integers.
-  const float kScale = internal::QuaternionKey::kfScale / math::kSqrt2;
+  const int iscale = (1 << _bits) - 1;
+  const float kScale = static_cast<float>(iscale) / math::kSqrt2;
   const float kOffset = -math::kSqrt2_2;
-  const int kMapping[4][3] = {{1, 2, 3}, {0, 2, 3}, {0, 1, 3}, {0, 1, 2}};
-  const int* map = kMapping[largest];
-  const int cpnt[3] = {
-      math::Min(static_cast<int>((quat[map[0]] - kOffset) * kScale + .5f),
-                internal::QuaternionKey::kiScale),
-      math::Min(static_cast<int>((quat[map[1]] - kOffset) * kScale + .5f),
-                internal::QuaternionKey::kiScale),
-      math::Min(static_cast<int>((quat[map[2]] - kOffset) * kScale + .5f),
-                internal::QuaternionKey::kiScale)};
-
-  pack(static_cast<int>(largest), quat[largest] < 0.f, cpnt, _dest);
-}  // namespace
+  const int* map = kQuaternionMapping[largest];
+  for (int i = 0; i < 3; ++i) {
+    _cpnt[i] = math::Min(
+        static_cast<int>((quat[map[i]] - kOffset) * kScale + .5f), iscale);
+  }
+}
+
+// Compresses quaternion to ozz::animation::RotationKey format.
+void CompressQuaternion(const ozz::math::Quaternion& _src,
+                        ozz::animation::internal::QuaternionKey* _dest) {
+  int largest, sign, cpnt[3];
+  QuantizeQuaternion(_src, internal::QuaternionKey::kBits, &largest, &sign,
+                     cpnt);
+  pack(largest, sign, cpnt, _dest);
+}
 
 // Normalize quaternions. Fixes-up successive opposite quaternions that would
 // fail to take the shortest path during the normalized-lerp. Note that keys
@@ -891,6 +1208,138 @@ void FixupQuaternions(ozz::vector<SortingQuaternionKey>* _src) {
   }
 }
 
+// Computes keyframes tangents for cubic Hermite splines. Note that keys are
+// still sorted per-track at that point, so a key's neighbours are the previous
+// and next keys of the same track.
+template <typename _SortingKey, typename _Tangent>
+void ComputeTangents(ozz::vector<_SortingKey>* _src, const _Tangent& _tangent) {
+  for (size_t i = 0; i < _src->size(); ++i) {
+    _SortingKey& src = _src->at(i);
+    const bool first = i == 0 || _src->at(i - 1).track != src.track;
+    const bool last =
+        i + 1 == _src->size() || _src->at(i + 1).track != src.track;
+    src.tangent = _tangent(first ? src.key : _src->at(i - 1).key, src.key,
+                           last ? src.key : _src->at(i + 1).key);
+  }
+}
+
+// Tangents are stored as half floats, clamped to half finite range.
+uint16_t CompressTangent(float _value) {
+  const float kMaxHalf = 65504.f;
+  return math::FloatToHalf(math::Clamp(-kMaxHalf, _value, kMaxHalf));
+}
+
+void CompressTangent(const math::Float3& _src, internal::Float3Key* _dest) {
+  _dest->values[0] = CompressTangent(_src.x);
+  _dest->values[1] = CompressTangent(_src.y);
+  _dest->values[2] = CompressTangent(_src.z);
+}
+
+void CompressTangent(const math::Quaternion& _src, internal::Float4Key* _dest) {
+  _dest->values[0] = CompressTangent(_src.x);
+  _dest->values[1] = CompressTangent(_src.y);
+  _dest->values[2] = CompressTangent(_src.z);
+  _dest->values[3] = CompressTangent(_src.w);
+}
+
+// Copies sorted keys tangents to _dest, converted to derivatives relative to
+// the animation ratio.
+template <typename _SortingKey, typename _DestKey>
+void CompressTangents(const span<_SortingKey>& _src, float _duration,
+                      const span<_DestKey>& _dest) {
+  assert(_dest.empty() || _dest.size() == _src.size());
+  for (size_t i = 0; i < _dest.size(); ++i) {
+    CompressTangent(_src[i].tangent * _duration, &_dest[i]);
+  }
+}
+
+// Error between 2 translations or scales.
+float Float3Error(const math::Float3& _a, const math::Float3& _b) {
+  return Length(_a - _b);
+}
+
+// Angle between 2 rotations, computed in double precision as acos is
+// ill-conditioned close to 1.
+float RotationError(const math::Quaternion& _a, const math::Quaternion& _b) {
+  const double cos_half_angle =
+      std::abs(static_cast<double>(_a.x) * _b.x +
+               static_cast<double>(_a.y) * _b.y +
+               static_cast<double>(_a.z) * _b.z +
+               static_cast<double>(_a.w) * _b.w) /
+      std::sqrt(static_cast<double>(_b.x) * _b.x +
+                static_cast<double>(_b.y) * _b.y +
+                static_cast<double>(_b.z) * _b.z +
+                static_cast<double>(_b.w) * _b.w);
+  return static_cast<float>(2. * std::acos(std::min(1., cos_half_angle)));
+}
+
+// Decimation adapter for cubic Hermite splines. Tangents are computed from the
+// dense source keys, so they don't depend on decimated keys and segments can
+// be processed independently.
+template <typename _SortingKey>
+class SplineAdapter {
+ public:
+  typedef typename _SortingKey::Value Value;
+  typedef Value (*Hermite)(const Value&, const Value&, const Value&,
+                           const Value&, float);
+  typedef float (*Error)(const Value&, const Value&);
+
+  SplineAdapter(Hermite _hermite, Error _error, float _duration)
+      : hermite_(_hermite), error_(_error), duration_(_duration) {}
+
+  // Last key must remain at t = duration.
+  bool Decimable(const _SortingKey& _key) const {
+    return _key.key.time != duration_;
+  }
+  _SortingKey Lerp(const _SortingKey& _left, const _SortingKey& _right,
+                   const _SortingKey& _ref) const {
+    const float interval = _right.key.time - _left.key.time;
+    const float alpha = (_ref.key.time - _left.key.time) / interval;
+    assert(alpha >= 0.f && alpha <= 1.f);
+    _SortingKey key = _ref;
+    key.key.value =
+        hermite_(_left.key.value, _left.tangent * interval, _right.key.value,
+                 _right.tangent * interval, alpha);
+    return key;
+  }
+  float Distance(const _SortingKey& _a, const _SortingKey& _b) const {
+    return error_(_a.key.value, _b.key.value);
+  }
+
+ private:
+  Hermite hermite_;
+  Error error_;
+  float duration_;
+};
+
+// Removes keys that cubic Hermite splines reconstruct within keyed tracks
+// _tolerances. Keys must still be sorted per-track.
+template <typename _SortingKey>
+void FitSplines(ozz::vector<_SortingKey>* _src,
+                const ozz::vector<float>& _tolerances,
+                const SplineAdapter<_SortingKey>& _adapter) {
+  ozz::vector<_SortingKey> fitted, track, decimated;
+  fitted.reserve(_src->size());
+  for (size_t begin = 0; begin < _src->size(); begin += track.size()) {
+    const uint16_t index = _src->at(begin).track;
+    size_t end = begin;
+    while (end < _src->size() && _src->at(end).track == index) {
+      ++end;
+    }
+    track.assign(_src->begin() + begin, _src->begin() + end);
+    Decimate(track, _adapter, _tolerances[index], &decimated);
+
+    // Previous key times change as keys were removed.
+    float prev_time = -1.f;
+    for (_SortingKey& key : decimated) {
+      key.prev_key_time = prev_time;
+      prev_time = key.key.time;
+    }
+    fitted.insert(fitted.end(), decimated.begin(), decimated.end());
+  }
+  _src->swap(fitted);
+}
+
 ozz::vector<float> BuildTimePoints(
     ozz::vector<SortingTranslationKey>& _translations,
     ozz::vector<SortingQuaternionKey>& _rotations,
@@ -919,15 +1368,18 @@ struct BuilderIFrame {
   size_t last;
 };
 
+// Variable bit-rate iframes (_locals is true) also store the index of each
+// entry within its track.
 template <typename _SortingKey>
 BuilderIFrame BuildIFrame(const ozz::span<_SortingKey>& _src, float _time,
-                          size_t _num_soa_tracks) {
+                          size_t _num_soa_tracks, bool _locals) {
   BuilderIFrame iframe;
 
   // Initialize vector with initial cached keys at t=0. Due to sorting, they
   // are the 2nd set keyframes, hence starting from _num_soa_tracks.
   const uint32_t num_entries = static_cast<uint32_t>(_num_soa_tracks);
   ozz::vector<uint32_t> entries(num_entries);
+  ozz::vector<uint32_t> counts(num_entries, 0);
 
   // The loop can end as soon as it finds a key greater that _time. It
   // will mean that all the keys lower than _time have been processed, meaning
@@ -936,15 +1388,27 @@ BuilderIFrame BuildIFrame(const ozz::span<_SortingKey>& _src, float _time,
        i < end && _src[i].prev_key_time <= _time; ++i) {
     // Stores the last key found for this track.
     entries[_src[i].track] = static_cast<uint32_t>(i);
+    ++counts[_src[i].track];
     iframe.last = i;
   }
   assert(iframe.last >= _num_soa_tracks * 2 - 1);
 
+  // Local index of the last key found for each track.
+  ozz::vector<uint32_t> locals;
+  if (_locals) {
+    for (const uint32_t count : counts) {
+      locals.push_back(count - 1);
+    }
+  }
+
   // Compress buffer.
-  const size_t worst_size = ozz::ComputeGV4WorstBufferSize(make_span(entries));
+  const size_t worst_size =
+      ozz::ComputeGV4WorstBufferSize(make_span(entries)) +
+      ozz::ComputeGV4WorstBufferSize(make_span(locals));
   iframe.entries.resize(worst_size);
   auto remain =
       ozz::EncodeGV4Stream(make_span(entries), make_span(iframe.entries));
+  remain = ozz::EncodeGV4Stream(make_span(locals), remain);
   iframe.entries.resize(iframe.entries.size() - remain.size_bytes());
 
   return iframe;
@@ -961,7 +1425,7 @@ struct BuilderIFrames {
 template <typename _SortingKey>
 BuilderIFrames BuildIFrames(const ozz::span<_SortingKey>& _src,
                             size_t _num_soa_tracks, float _interval,
-                            float _duration) {
+                            float _duration, bool _locals) {
   BuilderIFrames iframes;
   if (_num_soa_tracks == 0 || _interval <= 0.f) {
     return iframes;
@@ -970,7 +1434,7 @@ BuilderIFrames BuildIFrames(const ozz::span<_SortingKey>& _src,
   const size_t iframes_divs = static_cast<size_t>(_duration / _interval);
   for (size_t i = 0; i < iframes_divs; ++i) {
     const float time = _duration * (i + 1) / iframes_divs;
-    const auto& iframe = BuildIFrame(_src, time, _num_soa_tracks);
+    const auto& iframe = BuildIFrame(_src, time, _num_soa_tracks, _locals);
 
     // Don't need to add an iframe for the first set of keyframes.
     if (iframe.last <= _num_soa_tracks * 2 - 1) {
@@ -998,6 +1462,356 @@ BuilderIFrames BuildIFrames(const ozz::span<_SortingKey>& _src,
   return iframes;
 }
 
+// Constant SoA tracks of a transformation type.
+struct BuilderConstants {
+  bool constant(size_t _soa_track) const {
+    return !flags.empty() && (flags[_soa_track / 8] & (1 << (_soa_track & 7)));
+  }
+
+  // See Animation::Constants.
+  ozz::vector<byte> flags;
+  ozz::vector<float> values;
+  uint16_t num_keyed_soa_tracks = 0;
+
+  // Keyed track index of each track, only valid for non constant SoA tracks.
+  ozz::vector<uint16_t> keyed;
+};
+
+// Tests if a raw track keeps the same value for the whole animation.
+template <typename _SrcTrack>
+bool IsConstant(const _SrcTrack& _src) {
+  for (size_t k = 1; k < _src.size(); ++k) {
+    if (!(_src[k].value == _src.front().value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Stores lane _lane of a SoA constant value.
+void StoreConstant(const math::Float3& _value, size_t _lane, float* _soa) {
+  _soa[0 + _lane] = _value.x;
+  _soa[4 + _lane] = _value.y;
+  _soa[8 + _lane] = _value.z;
+}
+
+void StoreConstant(const math::Quaternion& _value, size_t _lane, float* _soa) {
+  // Normalizes the same way as keyframes, see FixupQuaternions.
+  math::Quaternion normalized =
+      NormalizeSafe(_value, math::Quaternion::identity());
+  if (normalized.w < 0.f) {
+    normalized = -normalized;
+  }
+  _soa[0 + _lane] = normalized.x;
+  _soa[4 + _lane] = normalized.y;
+  _soa[8 + _lane] = normalized.z;
+  _soa[12 + _lane] = normalized.w;
+}
+
+// Finds SoA tracks whose 4 tracks are constant. SoA padding tracks are
+// constant identity.
+template <typename _SrcTrack>
+BuilderConstants BuildConstants(const RawAnimation& _input,
+                                _SrcTrack RawAnimation::JointTrack::*_channel,
+                                size_t _num_soa_tracks, size_t _size) {
+  typedef typename _SrcTrack::value_type SrcKey;
+  const size_t num_tracks = _input.tracks.size();
+
+  BuilderConstants constants;
+  constants.flags.resize((_num_soa_tracks + 7) / 8, 0);
+  constants.keyed.resize(_num_soa_tracks * 4, 0);
+  for (size_t i = 0; i < _num_soa_tracks; ++i) {
+    bool constant = true;
+    for (size_t j = i * 4; j < i * 4 + 4 && j < num_tracks; ++j) {
+      constant &= IsConstant(_input.tracks[j].*_channel);
+    }
+
+    if (!constant) {
+      for (size_t j = 0; j < 4; ++j) {
+        constants.keyed[i * 4 + j] =
+            static_cast<uint16_t>(constants.num_keyed_soa_tracks * 4 + j);
+      }
+      ++constants.num_keyed_soa_tracks;
+      continue;
+    }
+
+    constants.flags[i / 8] |= 1 << (i & 7);
+    constants.values.resize(constants.values.size() + _size);
+    float* soa = constants.values.data() + constants.values.size() - _size;
+    for (size_t j = 0; j < 4; ++j) {
+      const size_t track = i * 4 + j;
+      const bool keyed =
+          track < num_tracks && !(_input.tracks[track].*_channel).empty();
+      StoreConstant(keyed ? (_input.tracks[track].*_channel).front().value
+                          : SrcKey::identity(),
+                    j, soa);
+    }
+  }
+
+  // No flag is needed if no SoA track is constant.
+  if (constants.num_keyed_soa_tracks == _num_soa_tracks) {
+    constants.flags.clear();
+  }
+  return constants;
+}
+
+// Copies keyed tracks from a RawAnimation to the sorting structure, using
+// keyed tracks indices.
+template <typename _SrcTrack, typename _DestTrack>
+void CopyKeyed(const RawAnimation& _input,
+               _SrcTrack RawAnimation::JointTrack::*_channel,
+               const BuilderConstants& _constants, float _duration,
+               _DestTrack* _dest) {
+  typedef typename _SrcTrack::value_type SrcKey;
+  if (_constants.num_keyed_soa_tracks == 0) {
+    return;  // Flags might have been cleared, see scales.
+  }
+  const size_t num_tracks = _input.tracks.size();
+  for (size_t i = 0; i < _constants.keyed.size(); ++i) {
+    if (_constants.constant(i / 4)) {
+      continue;
+    }
+    const uint16_t keyed = _constants.keyed[i];
+    if (i < num_tracks) {
+      CopyRaw(_input.tracks[i].*_channel, keyed, _duration, _dest);
+    } else {
+      // Add enough identity keys to match soa requirements.
+      PushBackIdentityKey<SrcKey>(keyed, 0.f, _dest);
+      PushBackIdentityKey<SrcKey>(keyed, _duration, _dest);
+    }
+  }
+}
+
+void CopyConstants(const BuilderConstants& _src, Animation::Constants& _dest) {
+  assert(_dest.flags.size() == _src.flags.size());
+  std::copy(_src.flags.begin(), _src.flags.end(), _dest.flags.begin());
+  assert(_dest.values.size() == _src.values.size());
+  std::copy(_src.values.begin(), _src.values.end(), _dest.values.begin());
+  _dest.num_keyed_soa_tracks = _src.num_keyed_soa_tracks;
+}
+
+// Appends bits to a stream, starting from the least significant bit of each
+// byte.
+class BitWriter {
+ public:
+  BitWriter() : size_(0) {}
+
+  void Push(uint64_t _value, uint32_t _bits) {
+    for (uint32_t i = 0; i < _bits; ++i, ++size_) {
+      if (size_ % 8 == 0) {
+        bytes_.push_back(0);
+      }
+      bytes_.back() |= static_cast<byte>(((_value >> i) & 1) << (size_ % 8));
+    }
+  }
+
+  // Number of bits written so far.
+  uint32_t size() const { return size_; }
+
+  // Returns the stream, padded so that 64 bits can be read from any bit.
+  ozz::vector<byte> Finalize() const {
+    ozz::vector<byte> stream = bytes_;
+    stream.resize(stream.size() + sizeof(uint64_t), 0);
+    return stream;
+  }
+
+ private:
+  ozz::vector<byte> bytes_;
+  uint32_t size_;
+};
+
+// Variable bit-rate keyframes of a transformation type.
+template <typename _Quantization>
+struct BuilderQuantization {
+  ozz::vector<_Quantization> tracks;
+  ozz::vector<byte> stream;
+};
+
+// Gathers sorted keyframes values per track, in time order.
+template <typename _Value, typename _SortingKey>
+ozz::vector<ozz::vector<_Value>> GatherTracks(
+    const ozz::vector<_SortingKey>& _src, size_t _num_tracks) {
+  ozz::vector<ozz::vector<_Value>> tracks(_num_tracks);
+  for (const _SortingKey& key : _src) {
+    tracks[key.track].push_back(key.key.value);
+  }
+  return tracks;
+}
+
+// Gets tolerances of keyed tracks. SoA padding tracks are constant, they're
+// quantized without error whatever the tolerance.
+ozz::vector<float> KeyedTolerances(
+    const ozz::vector<AnimationBuilder::Tolerance>& _tolerances,
+    float AnimationBuilder::Tolerance::*_channel,
+    const BuilderConstants& _constants) {
+  ozz::vector<float> tolerances(_constants.num_keyed_soa_tracks * 4,
+                                std::numeric_limits<float>::max());
+  for (size_t i = 0; i < _tolerances.size(); ++i) {
+    if (_constants.num_keyed_soa_tracks != 0 && !_constants.constant(i / 4)) {
+      tolerances[_constants.keyed[i]] = _tolerances[i].*_channel;
+    }
+  }
+  return tolerances;
+}
+
+// Quantizes _value in range [_min,_min+_scale*(2^_bits-1)].
+int QuantizeFloat(float _value, float _min, float _scale, uint32_t _bits) {
+  if (_scale == 0.f) {
+    return 0;
+  }
+  const int max = (1 << _bits) - 1;
+  return math::Clamp(0, static_cast<int>((_value - _min) / _scale + .5f), max);
+}
+
+float QuantizationScale(float _extent, uint32_t _bits) {
+  return _bits == 0 ? 0.f : _extent / static_cast<float>((1 << _bits) - 1);
+}
+
+// Finds the number of bits that allows to quantize all _values within
+// _tolerance.
+uint32_t Float3Bits(const ozz::vector<math::Float3>& _values,
+                    const math::Float3& _min, const math::Float3& _extent,
+                    float _tolerance) {
+  uint32_t bits = 0;
+  for (; bits < internal::Float3Quantization::kMaxBits; ++bits) {
+    const math::Float3 scale(QuantizationScale(_extent.x, bits),
+                             QuantizationScale(_extent.y, bits),
+                             QuantizationScale(_extent.z, bits));
+    float error = 0.f;
+    for (const math::Float3& value : _values) {
+      const math::Float3 quantized(
+          _min.x + QuantizeFloat(value.x, _min.x, scale.x, bits) * scale.x,
+          _min.y + QuantizeFloat(value.y, _min.y, scale.y, bits) * scale.y,
+          _min.z + QuantizeFloat(value.z, _min.z, scale.z, bits) * scale.z);
+      error = math::Max(error, Length(quantized - value));
+    }
+    if (error <= _tolerance) {
+      break;
+    }
+  }
+  return bits;
+}
+
+BuilderQuantization<internal::Float3Quantization> QuantizeFloat3(
+    const ozz::vector<ozz::vector<math::Float3>>& _tracks,
+    const ozz::vector<float>& _tolerances) {
+  BuilderQuantization<internal::Float3Quantization> quantization;
+  quantization.tracks.resize(_tracks.size() / 4);
+  BitWriter writer;
+  for (size_t i = 0; i < _tracks.size(); ++i) {
+    const ozz::vector<math::Float3>& values = _tracks[i];
+    assert(values.size() >= 2);
+
+    // Finds track range and required precision.
+    math::Float3 min = values.front(), max = values.front();
+    for (const math::Float3& value : values) {
+      min = Min(min, value);
+      max = Max(max, value);
+    }
+    const math::Float3 extent = max - min;
+    const uint32_t bits = Float3Bits(values, min, extent, _tolerances[i]);
+    const float mins[3] = {min.x, min.y, min.z};
+    const float scales[3] = {QuantizationScale(extent.x, bits),
+                             QuantizationScale(extent.y, bits),
+                             QuantizationScale(extent.z, bits)};
+
+    // Fills SoA track quantization.
+    internal::Float3Quantization& track = quantization.tracks[i / 4];
+    const size_t lane = i % 4;
+    for (int c = 0; c < 3; ++c) {
+      track.min[c][lane] = mins[c];
+      track.scale[c][lane] = scales[c];
+    }
+    track.offset[lane] = writer.size();
+    track.bits[lane] = bits;
+
+    // Writes keyframes.
+    for (const math::Float3& value : values) {
+      const float cpnts[3] = {value.x, value.y, value.z};
+      for (int c = 0; c < 3; ++c) {
+        writer.Push(QuantizeFloat(cpnts[c], mins[c], scales[c], bits), bits);
+      }
+    }
+  }
+  quantization.stream = writer.Finalize();
+  return quantization;
+}
+
+// Restores a quaternion quantized with QuantizeQuaternion.
+math::Quaternion DequantizeQuaternion(int _largest, int _sign,
+                                      const int _cpnt[3], uint32_t _bits) {
+  const float scale = math::kSqrt2 / static_cast<float>((1 << _bits) - 1);
+  float quat[4];
+  float dot = 0.f;
+  for (int i = 0; i < 3; ++i) {
+    const float cpnt = _cpnt[i] * scale - math::kSqrt2_2;
+    quat[kQuaternionMapping[_largest][i]] = cpnt;
+    dot += cpnt * cpnt;
+  }
+  const float largest = std::sqrt(math::Max(0.f, 1.f - dot));
+  quat[_largest] = _sign ? -largest : largest;
+  return math::Quaternion(quat[0], quat[1], quat[2], quat[3]);
+}
+
+// Finds the number of bits that allows to quantize all _values within
+// _tolerance angle.
+uint32_t QuaternionBits(const ozz::vector<math::Quaternion>& _values,
+                        float _tolerance) {
+  uint32_t bits = internal::QuaternionQuantization::kMinBits;
+  for (; bits < internal::QuaternionKey::kBits; ++bits) {
+    float error = 0.f;
+    for (const math::Quaternion& value : _values) {
+      int largest, sign, cpnt[3];
+      QuantizeQuaternion(value, bits, &largest, &sign, cpnt);
+      const math::Quaternion quantized =
+          DequantizeQuaternion(largest, sign, cpnt, bits);
+      error = math::Max(error, RotationError(value, quantized));
+    }
+    if (error <= _tolerance) {
+      break;
+    }
+  }
+  return bits;
+}
+
+BuilderQuantization<internal::QuaternionQuantization> QuantizeQuaternion(
+    const ozz::vector<ozz::vector<math::Quaternion>>& _tracks,
+    const ozz::vector<float>& _tolerances) {
+  BuilderQuantization<internal::QuaternionQuantization> quantization;
+  quantization.tracks.resize(_tracks.size() / 4);
+  BitWriter writer;
+  for (size_t i = 0; i < _tracks.size(); ++i) {
+    const ozz::vector<math::Quaternion>& values = _tracks[i];
+    const uint32_t bits = QuaternionBits(values, _tolerances[i]);
+
+    // Fills SoA track quantization.
+    internal::QuaternionQuantization& track = quantization.tracks[i / 4];
+    track.offset[i % 4] = writer.size();
+    track.bits[i % 4] = bits;
+
+    // Writes keyframes, with QuaternionKey bit layout.
+    for (const math::Quaternion& value : values) {
+      int largest, sign, cpnt[3];
+      QuantizeQuaternion(value, bits, &largest, &sign, cpnt);
+      writer.Push(static_cast<uint64_t>(largest), 2);
+      writer.Push(static_cast<uint64_t>(sign), 1);
+      for (int c = 0; c < 3; ++c) {
+        writer.Push(static_cast<uint64_t>(cpnt[c]), bits);
+      }
+    }
+  }
+  quantization.stream = writer.Finalize();
+  return quantization;
+}
+
+template <typename _Src, typename _Dest>
+void CopyQuantization(const BuilderQuantization<_Src>& _src, _Dest& _dest) {
+  assert(_dest.tracks.size() == _src.tracks.size());
+  std::copy(_src.tracks.begin(), _src.tracks.end(), _dest.tracks.begin());
+  assert(_dest.stream.size() == _src.stream.size());
+  std::copy(_src.stream.begin(), _src.stream.end(), _dest.stream.begin());
+}
+
 void CopyIFrames(const BuilderIFrames& _src, Animation::KeyframesCtrl& _dest) {
   assert(_dest.iframe_entries.size() == _src.entries.size());
   std::copy(_src.entries.begin(), _src.entries.end(),
@@ -1019,6 +1833,12 @@ unique_ptr<Animation> AnimationBuilder::operator()(
     return nullptr;
   }
 
+  // Variable bit-rate quantization requires a tolerance per track.
+  const bool variable = !tolerances.empty();
+  if (variable && tolerances.size() != _input.tracks.size()) {
+    return nullptr;
+  }
+
   // Everything is fine, allocates and fills the animation.
   // Nothing can fail now.
   unique_ptr<Animation> animation = make_unique<Animation>();
@@ -1038,6 +1858,33 @@ unique_ptr<Animation> AnimationBuilder::operator()(
   animation->num_tracks_ = num_tracks;
   const uint16_t num_soa_tracks = Align(num_tracks, 4);
 
+  // Finds constant SoA tracks. They're stored once in constant tables, and
+  // have no keyframe.
+  const BuilderConstants translation_constants =
+      BuildConstants(_input, &RawAnimation::JointTrack::translations,
+                     num_soa_tracks / 4, Animation::kFloat3ConstantSize);
+  const BuilderConstants rotation_constants =
+      BuildConstants(_input, &RawAnimation::JointTrack::rotations,
+                     num_soa_tracks / 4, Animation::kQuaternionConstantSize);
+  BuilderConstants scale_constants =
+      BuildConstants(_input, &RawAnimation::JointTrack::scales,
+                     num_soa_tracks / 4, Animation::kFloat3ConstantSize);
+
+  // Scale data isn't stored at all if all scales are 1.
+  if (scale_constants.num_keyed_soa_tracks == 0 &&
+      std::all_of(scale_constants.values.begin(), scale_constants.values.end(),
+                  [](float _v) { return _v == 1.f; })) {
+    scale_constants.flags.clear();
+    scale_constants.values.clear();
+  }
+
+  // Number of keyed tracks, including soa padding.
+  const uint16_t num_keyed_translations =
+      translation_constants.num_keyed_soa_tracks * 4;
+  const uint16_t num_keyed_rotations =
+      rotation_constants.num_keyed_soa_tracks * 4;
+  const uint16_t num_keyed_scales = scale_constants.num_keyed_soa_tracks * 4;
+
   // Declares and preallocates tracks to sort.
   size_t translations = 0, rotations = 0, scales = 0;
   for (uint16_t i = 0; i < num_tracks; ++i) {
@@ -1053,38 +1900,53 @@ unique_ptr<Animation> AnimationBuilder::operator()(
   ozz::vector<SortingScaleKey> sorting_scales;
   sorting_scales.reserve(scales);
 
-  // Filters RawAnimation keys and copies them to the output sorting structure.
-  uint16_t i = 0;
-  for (; i < num_tracks; ++i) {
-    const RawAnimation::JointTrack& raw_track = _input.tracks[i];
-    CopyRaw(raw_track.translations, i, duration, &sorting_translations);
-    CopyRaw(raw_track.rotations, i, duration, &sorting_rotations);
-    CopyRaw(raw_track.scales, i, duration, &sorting_scales);
-  }
-
-  // Add enough identity keys to match soa requirements.
-  for (; i < num_soa_tracks; ++i) {
-    typedef RawAnimation::TranslationKey SrcTKey;
-    PushBackIdentityKey<SrcTKey>(i, 0.f, &sorting_translations);
-    PushBackIdentityKey<SrcTKey>(i, duration, &sorting_translations);
+  // Filters RawAnimation keys of keyed tracks and copies them to the output
+  // sorting structure.
+  CopyKeyed(_input, &RawAnimation::JointTrack::translations,
+            translation_constants, duration, &sorting_translations);
+  CopyKeyed(_input, &RawAnimation::JointTrack::rotations, rotation_constants,
+            duration, &sorting_rotations);
+  CopyKeyed(_input, &RawAnimation::JointTrack::scales, scale_constants,
+            duration, &sorting_scales);
 
-    typedef RawAnimation::RotationKey SrcRKey;
-    PushBackIdentityKey<SrcRKey>(i, 0.f, &sorting_rotations);
-    PushBackIdentityKey<SrcRKey>(i, duration, &sorting_rotations);
+  FixupQuaternions(&sorting_rotations);
 
-    typedef RawAnimation::ScaleKey SrcSKey;
-    PushBackIdentityKey<SrcSKey>(i, 0.f, &sorting_scales);
-    PushBackIdentityKey<SrcSKey>(i, duration, &sorting_scales);
+  // Spline tangents are computed on all keys, before fitting.
+  if (spline) {
+    ComputeTangents(&sorting_translations, &TangentTranslation);
+    ComputeTangents(&sorting_rotations, &TangentRotation);
+    ComputeTangents(&sorting_scales, &TangentScale);
+    if (variable) {
+      FitSplines(&sorting_translations,
+                 KeyedTolerances(tolerances, &Tolerance::translation,
+                                 translation_constants),
+                 SplineAdapter<SortingTranslationKey>(
+                     &HermiteTranslation, &Float3Error, duration));
+      FitSplines(&sorting_rotations,
+                 KeyedTolerances(tolerances, &Tolerance::rotation,
+                                 rotation_constants),
+                 SplineAdapter<SortingQuaternionKey>(
+                     &HermiteRotation, &RotationError, duration));
+      FitSplines(&sorting_scales,
+                 KeyedTolerances(tolerances, &Tolerance::scale,
+                                 scale_constants),
+                 SplineAdapter<SortingScaleKey>(&HermiteScale, &Float3Error,
+                                                duration));
+    }
   }
 
-  FixupQuaternions(&sorting_rotations);
-
   // Sort animation keys to favor cache coherency.
-  Sort(sorting_translations, num_soa_tracks, &LerpTranslation,
+  const Splitter<SortingTranslationKey> translation_splitter = {
+      &LerpTranslation, &HermiteTranslation, spline};
+  Sort(sorting_translations, num_keyed_translations, translation_splitter,
        &SortingKeyLess<SortingTranslationKey>);
-  Sort(sorting_rotations, num_soa_tracks, &LerpRotation,
+  const Splitter<SortingQuaternionKey> rotation_splitter = {
+      &LerpRotation, &HermiteRotation, spline};
+  Sort(sorting_rotations, num_keyed_rotations, rotation_splitter,
        &SortingKeyLess<SortingQuaternionKey>);
-  Sort(sorting_scales, num_soa_tracks, &LerpScale,
+  const Splitter<SortingScaleKey> scale_splitter = {&LerpScale, &HermiteScale,
+                                                    spline};
+  Sort(sorting_scales, num_keyed_scales, scale_splitter,
        &SortingKeyLess<SortingScaleKey>);
 
   // Get all timepoints. Shall be done on sorting keys as time points might have
@@ -1106,12 +1968,32 @@ unique_ptr<Animation> AnimationBuilder::operator()(
 
   // Build cache snaphots/iframes.
   const auto& translation_ss =
-      BuildIFrames(make_span(sorting_translations), num_soa_tracks,
-                   iframe_interval, duration);
-  const auto& rotation_ss = BuildIFrames(
-      make_span(sorting_rotations), num_soa_tracks, iframe_interval, duration);
-  const auto& scale_ss = BuildIFrames(make_span(sorting_scales), num_soa_tracks,
-                                      iframe_interval, duration);
+      BuildIFrames(make_span(sorting_translations), num_keyed_translations,
+                   iframe_interval, duration, variable);
+  const auto& rotation_ss =
+      BuildIFrames(make_span(sorting_rotations), num_keyed_rotations,
+                   iframe_interval, duration, variable);
+  const auto& scale_ss =
+      BuildIFrames(make_span(sorting_scales), num_keyed_scales, iframe_interval,
+                   duration, variable);
+
+  // Quantizes variable bit-rate keyframes values.
+  BuilderQuantization<internal::Float3Quantization> translation_quantization;
+  BuilderQuantization<internal::QuaternionQuantization> rotation_quantization;
+  BuilderQuantization<internal::Float3Quantization> scale_quantization;
+  if (variable) {
+    translation_quantization = QuantizeFloat3(
+        GatherTracks<math::Float3>(sorting_translations,
+                                   num_keyed_translations),
+        KeyedTolerances(tolerances, &Tolerance::translation,
+                        translation_constants));
+    rotation_quantization = QuantizeQuaternion(
+        GatherTracks<math::Quaternion>(sorting_rotations, num_keyed_rotations),
+        KeyedTolerances(tolerances, &Tolerance::rotation, rotation_constants));
+    scale_quantization = QuantizeFloat3(
+        GatherTracks<math::Float3>(sorting_scales, num_keyed_scales),
+        KeyedTolerances(tolerances, &Tolerance::scale, scale_constants));
+  }
 
   // Allocate animation members.
   const Animation::AllocateParams params{
@@ -1122,24 +2004,53 @@ unique_ptr<Animation> AnimationBuilder::operator()(
       sorting_scales.size(),
       {translation_ss.entries.size(), translation_ss.desc.size()},
       {rotation_ss.entries.size(), rotation_ss.desc.size()},
-      {scale_ss.entries.size(), scale_ss.desc.size()}};
+      {scale_ss.entries.size(), scale_ss.desc.size()},
+      {translation_constants.flags.size(), translation_constants.values.size()},
+      {rotation_constants.flags.size(), rotation_constants.values.size()},
+      {scale_constants.flags.size(), scale_constants.values.size()},
+      {translation_quantization.tracks.size(),
+       translation_quantization.stream.size()},
+      {rotation_quantization.tracks.size(),
+       rotation_quantization.stream.size()},
+      {scale_quantization.tracks.size(), scale_quantization.stream.size()},
+      spline ? sorting_translations.size() : 0,
+      spline ? sorting_rotations.size() : 0,
+      spline ? sorting_scales.size() : 0};
   animation->Allocate(params);
 
   CopyIFrames(translation_ss, animation->translations_ctrl_);
   CopyIFrames(rotation_ss, animation->rotations_ctrl_);
   CopyIFrames(scale_ss, animation->scales_ctrl_);
 
-  // Copy sorted keys to final animation.
+  CopyConstants(translation_constants, animation->translations_constants_);
+  CopyConstants(rotation_constants, animation->rotations_constants_);
+  CopyConstants(scale_constants, animation->scales_constants_);
+
+  CopyQuantization(translation_quantization,
+                   animation->translations_quantization_);
+  CopyQuantization(rotation_quantization, animation->rotations_quantization_);
+  CopyQuantization(scale_quantization, animation->scales_quantization_);
+
+  // Copy sorted keys to final animation. Fixed precision values are empty if
+  // keyframes are variable bit-rate.
   Compress(make_span(time_points), make_span(sorting_translations),
-           num_soa_tracks, make_span(animation->translations_values_),
+           num_keyed_translations, make_span(animation->translations_values_),
            animation->translations_ctrl_, &CompressFloat3);
-  Compress(make_span(time_points), make_span(sorting_rotations), num_soa_tracks,
-           make_span(animation->rotations_values_), animation->rotations_ctrl_,
-           &CompressQuaternion);
-  Compress(make_span(time_points), make_span(sorting_scales), num_soa_tracks,
+  Compress(make_span(time_points), make_span(sorting_rotations),
+           num_keyed_rotations, make_span(animation->rotations_values_),
+           animation->rotations_ctrl_, &CompressQuaternion);
+  Compress(make_span(time_points), make_span(sorting_scales), num_keyed_scales,
            make_span(animation->scales_values_), animation->scales_ctrl_,
            &CompressFloat3);
 
+  // Tangents are empty if keyframes are linearly interpolated.
+  CompressTangents(make_span(sorting_translations), duration,
+                   animation->translations_tangents_);
+  CompressTangents(make_span(sorting_rotations), duration,
+                   animation->rotations_tangents_);
+  CompressTangents(make_span(sorting_scales), duration,
+                   animation->scales_tangents_);
+
   // Converts timepoints to ratio and copy to animation. Must be done once
   // indices have been set.
   CopyTimePoints(make_span(time_points), inv_duration, animation->timepoints_);
@@ -1187,6 +2098,7 @@ unique_ptr<Animation> AnimationBuilder::operator()(
 #include "ozz/animation/offline/animation_optimizer.h"
 
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <functional>
 
@@ -1594,6 +2506,42 @@ bool AnimationOptimizer::operator()(const RawAnimation& _input,
   // Output animation is always valid though.
   return _output->Validate();
 }
+
+bool AnimationOptimizer::ComputeTolerances(
+    const RawAnimation& _input, const Skeleton& _skeleton,
+    ozz::vector<AnimationBuilder::Tolerance>* _tolerances) const {
+  if (!_tolerances) {
+    return false;
+  }
+  _tolerances->clear();
+
+  // Validates animation and skeleton.
+  const int num_tracks = _input.num_tracks();
+  if (!_input.Validate() || num_tracks != _skeleton.num_joints()) {
+    return false;
+  }
+
+  // Uses the same hierarchical specs as decimation.
+  const HierarchyBuilder hierarchy(&_input, &_skeleton, this);
+
+  _tolerances->resize(num_tracks);
+  for (int i = 0; i < num_tracks; ++i) {
+    const float joint_length = hierarchy.specs[i].length;
+    const int parent = _skeleton.joint_parents()[i];
+    const float parent_scale =
+        (parent != Skeleton::kNoParent) ? hierarchy.specs[parent].scale : 1.f;
+    const float tolerance = hierarchy.specs[i].tolerance;
+
+    // Solves adapters distance functions for each transformation type unit.
+    AnimationBuilder::Tolerance& output = _tolerances->at(i);
+    output.translation = tolerance / parent_scale;
+    // RotationAdapter distance is 2 * sin(angle / 2) * length.
+    output.rotation =
+        2.f * std::asin(math::Min(1.f, tolerance / (2.f * joint_length)));
+    output.scale = tolerance / joint_length;
+  }
+  return true;
+}
 }  // namespace offline
 }  // namespace animation
 }  // namespace ozz
@@ -1953,6 +2901,7 @@ struct Extern<animation::offline::RawSkeleton::Joint> {
 
 #include "ozz/animation/offline/skeleton_builder.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "ozz/animation/offline/raw_skeleton.h"
@@ -1994,6 +2943,37 @@ struct JointLister {
   // Array of joints in the traversed DAG order.
   ozz::vector<Joint> linear_joints;
 };
+
+// Sorts depth-first listed joints by depth. The sort is stable, so siblings
+// stay next to each other, in the order of their parents.
+void SortBreadthFirst(ozz::vector<JointLister::Joint>* _joints) {
+  const size_t num_joints = _joints->size();
+  ozz::vector<int> depths(num_joints);
+  ozz::vector<int16_t> order(num_joints);
+  for (size_t i = 0; i < num_joints; ++i) {
+    const int16_t parent = (*_joints)[i].parent;
+    depths[i] = parent == Skeleton::kNoParent ? 0 : depths[parent] + 1;
+    order[i] = static_cast<int16_t>(i);
+  }
+  std::stable_sort(
+      order.begin(), order.end(),
+      [&depths](int16_t _a, int16_t _b) { return depths[_a] < depths[_b]; });
+
+  // Remaps parent indices to the new order.
+  ozz::vector<int16_t> remap(num_joints);
+  for (size_t i = 0; i < num_joints; ++i) {
+    remap[order[i]] = static_cast<int16_t>(i);
+  }
+  ozz::vector<JointLister::Joint> sorted(num_joints);
+  for (size_t i = 0; i < num_joints; ++i) {
+    const JointLister::Joint& joint = (*_joints)[order[i]];
+    sorted[i].joint = joint.joint;
+    sorted[i].parent = joint.parent == Skeleton::kNoParent
+                           ? joint.parent
+                           : remap[joint.parent];
+  }
+  _joints->swap(sorted);
+}
 }  // namespace
 
 // Validates the RawSkeleton and fills a Skeleton.
@@ -2018,6 +2998,10 @@ unique_ptr<ozz::animation::Skeleton> SkeletonBuilder::operator()(
   JointLister lister(num_joints);
   IterateJointsDF<JointLister&>(_raw_skeleton, lister);
   assert(static_cast<int>(lister.linear_joints.size()) == num_joints);
+  if (breadth_first) {
+    SortBreadthFirst(&lister.linear_joints);
+    skeleton->ordering_ = Skeleton::kBreadthFirst;
+  }
 
   // Computes name's buffer size.
   size_t chars_size = 0;
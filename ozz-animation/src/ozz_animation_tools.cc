@@ -1947,6 +1947,10 @@ bool SanitizeSkeletonImport(Json::Value& _root, bool _all_options) {
       _root, "enable", true,
       "Imports (from source data file) and writes skeleton output file.");
   MakeDefault(_root, "raw", false, "Outputs raw skeleton.");
+  MakeDefault(_root, "breadth_first", false,
+              "Stores joints in breadth-first order, which is faster to "
+              "convert to model-space. Animations must be imported with the "
+              "resulting skeleton.");
   MakeDefaultObject(
       _root, "types",
       "Define nodes types that should be considered as skeleton joints.");
@@ -2576,6 +2580,7 @@ bool ImportSkeleton(const Json::Value& _config, OzzImporter* _importer,
     // Builds runtime skeleton.
     ozz::log::Log() << "Builds runtime skeleton." << std::endl;
     SkeletonBuilder builder;
+    builder.breadth_first = import_config["breadth_first"].asBool();
     skeleton = builder(raw_skeleton);
     if (!skeleton) {
       ozz::log::Err() << "Failed to build runtime skeleton." << std::endl;
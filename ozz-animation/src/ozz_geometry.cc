@@ -34,6 +34,7 @@
 #include <cassert>
 #include <stdio.h>
 
+#include "ozz/base/maths/simd_float3x4.h"
 #include "ozz/base/maths/simd_math.h"
 
 namespace ozz {
@@ -56,8 +57,15 @@ bool SkinningJob::Validate() const {
   bool valid = true;
   // Checks influences bounds.
   valid &= influences_count > 0;
-  // Checks joints matrices, required.
-  valid &= !joint_matrices.empty();
+  // Checks joints matrices, required. Float4x4 and Float3x4 matrices can't be
+  // mixed.
+  if (joint_matrices3x4.empty()) {
+    valid &= !joint_matrices.empty();
+    valid &= joint_inverse_transpose_matrices3x4.empty();
+  } else {
+    valid &= joint_matrices.empty();
+    valid &= joint_inverse_transpose_matrices.empty();
+  }
 
   // Prepares local variables used to compute buffer size.
   const int vertex_count_minus_1 = vertex_count > 0 ? vertex_count - 1 : 0;
@@ -119,11 +127,71 @@ bool SkinningJob::Validate() const {
 // To cope with the error prone aspect of implementing every function, we
 // define a skeleton code (SKINNING_FN) for the skinning loop, which internally
 // calls MACRO that are shared or specialized according to skinning variants.
+// Skinning functions are templates of the joint matrix type (Float4x4 or
+// Float3x4). The helpers below are overloaded for both types.
+
+namespace {
+template <typename _Matrix>
+span<const _Matrix> JointMatrices(const SkinningJob& _job);
+
+template <>
+span<const math::Float4x4> JointMatrices<math::Float4x4>(
+    const SkinningJob& _job) {
+  return _job.joint_matrices;
+}
+
+template <>
+span<const math::Float3x4> JointMatrices<math::Float3x4>(
+    const SkinningJob& _job) {
+  return _job.joint_matrices3x4;
+}
+
+template <typename _Matrix>
+span<const _Matrix> JointInverseTransposeMatrices(const SkinningJob& _job);
+
+template <>
+span<const math::Float4x4> JointInverseTransposeMatrices<math::Float4x4>(
+    const SkinningJob& _job) {
+  return _job.joint_inverse_transpose_matrices;
+}
+
+template <>
+span<const math::Float3x4> JointInverseTransposeMatrices<math::Float3x4>(
+    const SkinningJob& _job) {
+  return _job.joint_inverse_transpose_matrices3x4;
+}
+
+// Multiplies all matrix components by the splat weight _w.
+OZZ_INLINE math::Float4x4 Weight(const math::Float4x4& _m,
+                                 math::_SimdFloat4 _w) {
+  return math::ColumnMultiply(_m, _w);
+}
+
+OZZ_INLINE math::Float3x4 Weight(const math::Float3x4& _m,
+                                 math::_SimdFloat4 _w) {
+  return math::RowMultiply(_m, _w);
+}
+
+// Returns the column major matrix used to transform points and vectors. A
+// Float3x4 is transposed only once per vertex, after blending. Translation w
+// component is left to 0 as it's not used.
+OZZ_INLINE const math::Float4x4& Columns(const math::Float4x4& _m) {
+  return _m;
+}
+
+OZZ_INLINE math::Float4x4 Columns(const math::Float3x4& _m) {
+  math::Float4x4 ret;
+  math::Transpose3x4(_m.rows, ret.cols);
+  return ret;
+}
+}  // namespace
 
 // Defines the skeleton code for the per vertex skinning loop.
 #define SKINNING_FN(_type, _it, _inf)                                        \
+  template <typename _Matrix>                                                \
   void SKINNING_FN_NAME(_type, _it, _inf)(const SkinningJob& _job) {         \
-    ASSERT_##_type() ASSERT_##_it() INIT_##_type() INIT_W##_inf()            \
+    ASSERT_##_type() ASSERT_##_it() INIT_##_type() INIT_##_it()              \
+        INIT_W##_inf()                                                       \
         const int loops = _job.vertex_count - 1;                             \
     for (int i = 0; i < loops; ++i) {                                        \
       PREPARE_##_inf##_INNER(_it) TRANSFORM_##_type##_INNER() NEXT_##_type() \
@@ -150,12 +218,14 @@ bool SkinningJob::Validate() const {
 
 #define ASSERT_NOIT()
 
-#define ASSERT_IT() assert(!_job.joint_inverse_transpose_matrices.empty());
+#define ASSERT_IT() \
+  assert(!JointInverseTransposeMatrices<_Matrix>(_job).empty());
 
 // Implements loop initializations for positions, ...
-#define INIT_P()                                              \
-  const uint16_t* joint_indices = _job.joint_indices.begin(); \
-  const float* in_positions = _job.in_positions.begin();      \
+#define INIT_P()                                                     \
+  const span<const _Matrix> matrices = JointMatrices<_Matrix>(_job); \
+  const uint16_t* joint_indices = _job.joint_indices.begin();        \
+  const float* in_positions = _job.in_positions.begin();             \
   float* out_positions = _job.out_positions.begin();
 
 #define INIT_PN()                                    \
@@ -168,6 +238,13 @@ bool SkinningJob::Validate() const {
   const float* in_tangents = _job.in_tangents.begin(); \
   float* out_tangents = _job.out_tangents.begin();
 
+// Implements loop initializations for inverse transpose matrices.
+#define INIT_NOIT()
+
+#define INIT_IT()                         \
+  const span<const _Matrix> it_matrices = \
+      JointInverseTransposeMatrices<_Matrix>(_job);
+
 // Implements loop initializations for weights.
 // Note that if the number of influences per vertex is 1, then there's no weight
 // as it's implicitly 1.
@@ -220,9 +297,9 @@ bool SkinningJob::Validate() const {
 // remaining data to use more optimized SIMD load functions. At the opposite,
 // _OUTER functions restrict access to data that are sure to be readable from
 // the buffer.
-#define PREPARE_1_INNER(_it)                                 \
-  const uint16_t i0 = joint_indices[0];                      \
-  const math::Float4x4& transform = _job.joint_matrices[i0]; \
+#define PREPARE_1_INNER(_it)                               \
+  const uint16_t i0 = joint_indices[0];                    \
+  const math::Float4x4& transform = Columns(matrices[i0]); \
   PREPARE_##_it##_1()
 
 #define PREPARE_1_OUTER(_it) PREPARE_1_INNER(_it)
@@ -233,53 +310,50 @@ bool SkinningJob::Validate() const {
 
 #define PREPARE_NOIT_1() PREPARE_NOIT()
 
-#define PREPARE_IT_1()                 \
-  const math::Float4x4& it_transform = \
-      _job.joint_inverse_transpose_matrices[i0];
+#define PREPARE_IT_1() \
+  const math::Float4x4& it_transform = Columns(it_matrices[i0]);
 
 #define PREPARE_2_INNER(_it)                                                   \
   const math::SimdFloat4 w0 = math::simd_float4::Load1PtrU(joint_weights + 0); \
   const uint16_t i0 = joint_indices[0];                                        \
   const uint16_t i1 = joint_indices[1];                                        \
-  const math::Float4x4& m0 = _job.joint_matrices[i0];                          \
-  const math::Float4x4& m1 = _job.joint_matrices[i1];                          \
+  const _Matrix& m0 = matrices[i0];                                            \
+  const _Matrix& m1 = matrices[i1];                                            \
   const math::SimdFloat4 w1 = one - w0;                                        \
   const math::Float4x4 transform =                                             \
-      math::ColumnMultiply(m0, w0) + math::ColumnMultiply(m1, w1);             \
+      Columns(Weight(m0, w0) + Weight(m1, w1));                                \
   PREPARE_##_it##_2()
 
 #define PREPARE_NOIT_2() PREPARE_NOIT()
 
-#define PREPARE_IT_2()                                                    \
-  const math::Float4x4& mit0 = _job.joint_inverse_transpose_matrices[i0]; \
-  const math::Float4x4& mit1 = _job.joint_inverse_transpose_matrices[i1]; \
-  const math::Float4x4 it_transform =                                     \
-      math::ColumnMultiply(mit0, w0) + math::ColumnMultiply(mit1, w1);
+#define PREPARE_IT_2()                   \
+  const _Matrix& mit0 = it_matrices[i0]; \
+  const _Matrix& mit1 = it_matrices[i1]; \
+  const math::Float4x4 it_transform =    \
+      Columns(Weight(mit0, w0) + Weight(mit1, w1));
 
 #define PREPARE_2_OUTER(_it) PREPARE_2_INNER(_it)
 
-#define PREPARE_3_CONCAT(_it)                                     \
-  const uint16_t i0 = joint_indices[0];                           \
-  const uint16_t i1 = joint_indices[1];                           \
-  const uint16_t i2 = joint_indices[2];                           \
-  const math::Float4x4& m0 = _job.joint_matrices[i0];             \
-  const math::Float4x4& m1 = _job.joint_matrices[i1];             \
-  const math::Float4x4& m2 = _job.joint_matrices[i2];             \
-  const math::SimdFloat4 w2 = one - (w0 + w1);                    \
-  const math::Float4x4 transform = math::ColumnMultiply(m0, w0) + \
-                                   math::ColumnMultiply(m1, w1) + \
-                                   math::ColumnMultiply(m2, w2);  \
+#define PREPARE_3_CONCAT(_it)                                    \
+  const uint16_t i0 = joint_indices[0];                          \
+  const uint16_t i1 = joint_indices[1];                          \
+  const uint16_t i2 = joint_indices[2];                          \
+  const _Matrix& m0 = matrices[i0];                              \
+  const _Matrix& m1 = matrices[i1];                              \
+  const _Matrix& m2 = matrices[i2];                              \
+  const math::SimdFloat4 w2 = one - (w0 + w1);                   \
+  const math::Float4x4 transform =                               \
+      Columns(Weight(m0, w0) + Weight(m1, w1) + Weight(m2, w2)); \
   PREPARE_##_it##_3()
 
 #define PREPARE_NOIT_3() PREPARE_NOIT()
 
-#define PREPARE_IT_3()                                                    \
-  const math::Float4x4& mit0 = _job.joint_inverse_transpose_matrices[i0]; \
-  const math::Float4x4& mit1 = _job.joint_inverse_transpose_matrices[i1]; \
-  const math::Float4x4& mit2 = _job.joint_inverse_transpose_matrices[i2]; \
-  const math::Float4x4 it_transform = math::ColumnMultiply(mit0, w0) +    \
-                                      math::ColumnMultiply(mit1, w1) +    \
-                                      math::ColumnMultiply(mit2, w2);
+#define PREPARE_IT_3()                   \
+  const _Matrix& mit0 = it_matrices[i0]; \
+  const _Matrix& mit1 = it_matrices[i1]; \
+  const _Matrix& mit2 = it_matrices[i2]; \
+  const math::Float4x4 it_transform =    \
+      Columns(Weight(mit0, w0) + Weight(mit1, w1) + Weight(mit2, w2));
 
 #define PREPARE_3_INNER(_it)                                             \
   const math::SimdFloat4 w = math::simd_float4::LoadPtrU(joint_weights); \
@@ -292,31 +366,31 @@ bool SkinningJob::Validate() const {
   const math::SimdFloat4 w1 = math::simd_float4::Load1PtrU(joint_weights + 1); \
   PREPARE_3_CONCAT(_it)
 
-#define PREPARE_4_CONCAT(_it)                                       \
-  const uint16_t i0 = joint_indices[0];                             \
-  const uint16_t i1 = joint_indices[1];                             \
-  const uint16_t i2 = joint_indices[2];                             \
-  const uint16_t i3 = joint_indices[3];                             \
-  const math::Float4x4& m0 = _job.joint_matrices[i0];               \
-  const math::Float4x4& m1 = _job.joint_matrices[i1];               \
-  const math::Float4x4& m2 = _job.joint_matrices[i2];               \
-  const math::Float4x4& m3 = _job.joint_matrices[i3];               \
-  const math::SimdFloat4 w3 = one - (w0 + w1 + w2);                 \
-  const math::Float4x4 transform =                                  \
-      math::ColumnMultiply(m0, w0) + math::ColumnMultiply(m1, w1) + \
-      math::ColumnMultiply(m2, w2) + math::ColumnMultiply(m3, w3);  \
+#define PREPARE_4_CONCAT(_it)                                    \
+  const uint16_t i0 = joint_indices[0];                          \
+  const uint16_t i1 = joint_indices[1];                          \
+  const uint16_t i2 = joint_indices[2];                          \
+  const uint16_t i3 = joint_indices[3];                          \
+  const _Matrix& m0 = matrices[i0];                              \
+  const _Matrix& m1 = matrices[i1];                              \
+  const _Matrix& m2 = matrices[i2];                              \
+  const _Matrix& m3 = matrices[i3];                              \
+  const math::SimdFloat4 w3 = one - (w0 + w1 + w2);              \
+  const math::Float4x4 transform =                               \
+      Columns(Weight(m0, w0) + Weight(m1, w1) + Weight(m2, w2) + \
+              Weight(m3, w3));                                   \
   PREPARE_##_it##_4()
 
 #define PREPARE_NOIT_4() PREPARE_NOIT()
 
-#define PREPARE_IT_4()                                                    \
-  const math::Float4x4& mit0 = _job.joint_inverse_transpose_matrices[i0]; \
-  const math::Float4x4& mit1 = _job.joint_inverse_transpose_matrices[i1]; \
-  const math::Float4x4& mit2 = _job.joint_inverse_transpose_matrices[i2]; \
-  const math::Float4x4& mit3 = _job.joint_inverse_transpose_matrices[i3]; \
-  const math::Float4x4 it_transform =                                     \
-      math::ColumnMultiply(mit0, w0) + math::ColumnMultiply(mit1, w1) +   \
-      math::ColumnMultiply(mit2, w2) + math::ColumnMultiply(mit3, w3);
+#define PREPARE_IT_4()                                                 \
+  const _Matrix& mit0 = it_matrices[i0];                               \
+  const _Matrix& mit1 = it_matrices[i1];                               \
+  const _Matrix& mit2 = it_matrices[i2];                               \
+  const _Matrix& mit3 = it_matrices[i3];                               \
+  const math::Float4x4 it_transform =                                  \
+      Columns(Weight(mit0, w0) + Weight(mit1, w1) + Weight(mit2, w2) + \
+              Weight(mit3, w3));
 
 #define PREPARE_4_INNER(_it)                                             \
   const math::SimdFloat4 w = math::simd_float4::LoadPtrU(joint_weights); \
@@ -331,48 +405,40 @@ bool SkinningJob::Validate() const {
   const math::SimdFloat4 w2 = math::simd_float4::Load1PtrU(joint_weights + 2); \
   PREPARE_4_CONCAT(_it)
 
-#define PREPARE_NOIT_N()                                                     \
-  math::SimdFloat4 wsum = math::simd_float4::Load1PtrU(joint_weights + 0);   \
-  math::Float4x4 transform =                                                 \
-      math::ColumnMultiply(_job.joint_matrices[joint_indices[0]], wsum);     \
-  const int last = _job.influences_count - 1;                                \
-  for (int j = 1; j < last; ++j) {                                           \
-    const math::SimdFloat4 w =                                               \
-        math::simd_float4::Load1PtrU(joint_weights + j);                     \
-    wsum = wsum + w;                                                         \
-    transform = transform + math::ColumnMultiply(                            \
-                                _job.joint_matrices[joint_indices[j]], w);   \
-  }                                                                          \
-  transform =                                                                \
-      transform + math::ColumnMultiply(                                      \
-                      _job.joint_matrices[joint_indices[last]], one - wsum); \
+#define PREPARE_NOIT_N()                                                   \
+  math::SimdFloat4 wsum = math::simd_float4::Load1PtrU(joint_weights + 0); \
+  _Matrix blended = Weight(matrices[joint_indices[0]], wsum);              \
+  const int last = _job.influences_count - 1;                              \
+  for (int j = 1; j < last; ++j) {                                         \
+    const math::SimdFloat4 w =                                             \
+        math::simd_float4::Load1PtrU(joint_weights + j);                   \
+    wsum = wsum + w;                                                       \
+    blended = blended + Weight(matrices[joint_indices[j]], w);             \
+  }                                                                        \
+  blended = blended + Weight(matrices[joint_indices[last]], one - wsum);   \
+  const math::Float4x4& transform = Columns(blended);                      \
   PREPARE_NOIT()
 
-#define PREPARE_IT_N()                                                        \
-  math::SimdFloat4 wsum = math::simd_float4::Load1PtrU(joint_weights + 0);    \
-  const uint16_t i0 = joint_indices[0];                                       \
-  math::Float4x4 transform =                                                  \
-      math::ColumnMultiply(_job.joint_matrices[i0], wsum);                    \
-  math::Float4x4 it_transform =                                               \
-      math::ColumnMultiply(_job.joint_inverse_transpose_matrices[i0], wsum);  \
-  const int last = _job.influences_count - 1;                                 \
-  for (int j = 1; j < last; ++j) {                                            \
-    const uint16_t ij = joint_indices[j];                                     \
-    const math::SimdFloat4 w =                                                \
-        math::simd_float4::Load1PtrU(joint_weights + j);                      \
-    wsum = wsum + w;                                                          \
-    transform = transform + math::ColumnMultiply(_job.joint_matrices[ij], w); \
-    it_transform =                                                            \
-        it_transform +                                                        \
-        math::ColumnMultiply(_job.joint_inverse_transpose_matrices[ij], w);   \
-  }                                                                           \
-  const math::SimdFloat4 wlast = one - wsum;                                  \
-  const int ilast = joint_indices[last];                                      \
-  transform =                                                                 \
-      transform + math::ColumnMultiply(_job.joint_matrices[ilast], wlast);    \
-  it_transform =                                                              \
-      it_transform + math::ColumnMultiply(                                    \
-                         _job.joint_inverse_transpose_matrices[ilast], wlast);
+#define PREPARE_IT_N()                                                     \
+  math::SimdFloat4 wsum = math::simd_float4::Load1PtrU(joint_weights + 0); \
+  const uint16_t i0 = joint_indices[0];                                    \
+  _Matrix blended = Weight(matrices[i0], wsum);                            \
+  _Matrix it_blended = Weight(it_matrices[i0], wsum);                      \
+  const int last = _job.influences_count - 1;                              \
+  for (int j = 1; j < last; ++j) {                                         \
+    const uint16_t ij = joint_indices[j];                                  \
+    const math::SimdFloat4 w =                                             \
+        math::simd_float4::Load1PtrU(joint_weights + j);                   \
+    wsum = wsum + w;                                                       \
+    blended = blended + Weight(matrices[ij], w);                           \
+    it_blended = it_blended + Weight(it_matrices[ij], w);                  \
+  }                                                                        \
+  const math::SimdFloat4 wlast = one - wsum;                               \
+  const int ilast = joint_indices[last];                                   \
+  blended = blended + Weight(matrices[ilast], wlast);                      \
+  it_blended = it_blended + Weight(it_matrices[ilast], wlast);             \
+  const math::Float4x4& transform = Columns(blended);                      \
+  const math::Float4x4& it_transform = Columns(it_blended);
 
 #define PREPARE_N_INNER(_it) PREPARE_##_it##_N()
 
@@ -444,31 +510,59 @@ SKINNING_FN(PNT, IT, N)
 // Defines a matrix of skinning function pointers. This matrix will then be
 // indexed according to skinning jobs parameters.
 typedef void (*SkiningFct)(const SkinningJob&);
-static const SkiningFct kSkinningFct[2][5][3] = {
-    {
-        {&SKINNING_FN_NAME(P, NOIT, 1), &SKINNING_FN_NAME(PN, NOIT, 1),
-         &SKINNING_FN_NAME(PNT, NOIT, 1)},
-        {&SKINNING_FN_NAME(P, NOIT, 2), &SKINNING_FN_NAME(PN, NOIT, 2),
-         &SKINNING_FN_NAME(PNT, NOIT, 2)},
-        {&SKINNING_FN_NAME(P, NOIT, 3), &SKINNING_FN_NAME(PN, NOIT, 3),
-         &SKINNING_FN_NAME(PNT, NOIT, 3)},
-        {&SKINNING_FN_NAME(P, NOIT, 4), &SKINNING_FN_NAME(PN, NOIT, 4),
-         &SKINNING_FN_NAME(PNT, NOIT, 4)},
-        {&SKINNING_FN_NAME(P, NOIT, N), &SKINNING_FN_NAME(PN, NOIT, N),
-         &SKINNING_FN_NAME(PNT, NOIT, N)},
-    },
-    {
-        {&SKINNING_FN_NAME(P, NOIT, 1), &SKINNING_FN_NAME(PN, IT, 1),
-         &SKINNING_FN_NAME(PNT, IT, 1)},
-        {&SKINNING_FN_NAME(P, NOIT, 2), &SKINNING_FN_NAME(PN, IT, 2),
-         &SKINNING_FN_NAME(PNT, IT, 2)},
-        {&SKINNING_FN_NAME(P, NOIT, 3), &SKINNING_FN_NAME(PN, IT, 3),
-         &SKINNING_FN_NAME(PNT, IT, 3)},
-        {&SKINNING_FN_NAME(P, NOIT, 4), &SKINNING_FN_NAME(PN, IT, 4),
-         &SKINNING_FN_NAME(PNT, IT, 4)},
-        {&SKINNING_FN_NAME(P, NOIT, N), &SKINNING_FN_NAME(PN, IT, N),
-         &SKINNING_FN_NAME(PNT, IT, N)},
-    }};
+
+template <typename _Matrix>
+void RunSkinning(const SkinningJob& _job) {
+  static const SkiningFct kSkinningFct[2][5][3] = {
+      {
+          {&SKINNING_FN_NAME(P, NOIT, 1)<_Matrix>,
+           &SKINNING_FN_NAME(PN, NOIT, 1)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, NOIT, 1)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, 2)<_Matrix>,
+           &SKINNING_FN_NAME(PN, NOIT, 2)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, NOIT, 2)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, 3)<_Matrix>,
+           &SKINNING_FN_NAME(PN, NOIT, 3)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, NOIT, 3)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, 4)<_Matrix>,
+           &SKINNING_FN_NAME(PN, NOIT, 4)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, NOIT, 4)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, N)<_Matrix>,
+           &SKINNING_FN_NAME(PN, NOIT, N)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, NOIT, N)<_Matrix>},
+      },
+      {
+          {&SKINNING_FN_NAME(P, NOIT, 1)<_Matrix>,
+           &SKINNING_FN_NAME(PN, IT, 1)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, IT, 1)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, 2)<_Matrix>,
+           &SKINNING_FN_NAME(PN, IT, 2)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, IT, 2)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, 3)<_Matrix>,
+           &SKINNING_FN_NAME(PN, IT, 3)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, IT, 3)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, 4)<_Matrix>,
+           &SKINNING_FN_NAME(PN, IT, 4)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, IT, 4)<_Matrix>},
+          {&SKINNING_FN_NAME(P, NOIT, N)<_Matrix>,
+           &SKINNING_FN_NAME(PN, IT, N)<_Matrix>,
+           &SKINNING_FN_NAME(PNT, IT, N)<_Matrix>},
+      }};
+
+  // Find skinning function index.
+  const size_t it = !JointInverseTransposeMatrices<_Matrix>(_job).empty();
+  assert(it < OZZ_ARRAY_SIZE(kSkinningFct));
+  const size_t inf = static_cast<size_t>(_job.influences_count) >
+                             OZZ_ARRAY_SIZE(kSkinningFct[0])
+                         ? OZZ_ARRAY_SIZE(kSkinningFct[0]) - 1
+                         : _job.influences_count - 1;
+  assert(inf < OZZ_ARRAY_SIZE(kSkinningFct[0]));
+  const size_t fct = !_job.in_normals.empty() + !_job.in_tangents.empty();
+  assert(fct < OZZ_ARRAY_SIZE(kSkinningFct[0][0]));
+
+  // Calls skinning function. Cannot fail because job is valid.
+  kSkinningFct[it][inf][fct](_job);
+}
 
 // Implements job Run function.
 bool SkinningJob::Run() const {
@@ -483,19 +577,11 @@ bool SkinningJob::Run() const {
     return true;
   }
 
-  // Find skinning function index.
-  const size_t it = !joint_inverse_transpose_matrices.empty();
-  assert(it < OZZ_ARRAY_SIZE(kSkinningFct));
-  const size_t inf =
-      static_cast<size_t>(influences_count) > OZZ_ARRAY_SIZE(kSkinningFct[0])
-          ? OZZ_ARRAY_SIZE(kSkinningFct[0]) - 1
-          : influences_count - 1;
-  assert(inf < OZZ_ARRAY_SIZE(kSkinningFct[0]));
-  const size_t fct = !in_normals.empty() + !in_tangents.empty();
-  assert(fct < OZZ_ARRAY_SIZE(kSkinningFct[0][0]));
-
-  // Calls skinning function. Cannot fail because job is valid.
-  kSkinningFct[it][inf][fct](*this);
+  if (joint_matrices3x4.empty()) {
+    RunSkinning<math::Float4x4>(*this);
+  } else {
+    RunSkinning<math::Float3x4>(*this);
+  }
 
   return true;
 }